@@ -1,220 +1,1047 @@
-/** @addtogroup IS25LP080D_driver
-  * @{
-*/
-
-/**
-  *******************************************************************************
-  * @file           : IS25LP080D_driver.c
-  * @author         : Massimo Casoni
-  * @date           : 29/11/2024
-  * @brief          : IS25LP080D serial memory driver
-  ********************************************************************************
-*/
-
-#include "utilities.h"  
-#include "spi.h"
-#include "gpio.h"
-#include "e_emulator.h"
-#include "stm32_assert.h"
-#include "swtimer.h"
-#include "IS25LP080D_driver.h"
-
-
-// Define IS25LP080D commands
-#define CMD_READ             0x03
-#define CMD_WRITE_ENABLE     0x06
-#define CMD_PAGE_PROGRAM     0x02
-#define CMD_SECTOR_ERASE     0x20
-#define CMD_BLOCK_ERASE      0xD8
-#define CMD_READ_STATUS      0x05
-#define CMD_WRITE_DISABLE    0x04
-
-
-#define IS25LP080D_SPI_LINE             SPI1_ID     // SPI line for the memory
-#define IS25LP080D_ERROR                -5          // Memory (LFS) error code 
-#define IS25LP080D_BUSY_TIMEOUT_MSEC    2000        // Memory busy timeout (mSec)
-
-
-static int IS25LP080D_WaitWhileBusy(uint8_t memOpcode);
-/* static void DelayNOP(uint32_t cycles); */
-
-
-void IS25LP080D_Init(void) 
-{
-    SPIn_Init(IS25LP080D_SPI_LINE);
-}
-
-
-int IS25LP080D_Read(const void *context, uint32_t addr, void *buffer, uint32_t size) 
-{
-    assert_param(buffer);
-    assert_param(addr < 0x100000); 
-    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)
-    NOT_USED(context);
-
-    uint8_t cmd[4] = {CMD_READ, ((split32_t)addr).b[SPLIT_T2], ((split32_t)addr).b[SPLIT_T1], ((split32_t)addr).b[SPLIT_T0]};
-
-    SPI_CS_Enable(SPI1_ID);
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd))) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    if (!SPI_Receive(IS25LP080D_SPI_LINE, buffer, size))
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    SPI_CS_Disable(SPI1_ID);
-    return 0;
-}
-
-
-int IS25LP080D_Program(const void *context, uint32_t addr, const void *buffer, uint32_t size) 
-{
-    assert_param(buffer);
-    assert_param(addr < 0x100000); 
-    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)
-    NOT_USED(context);
-
-    uint8_t cmd[4] = {CMD_PAGE_PROGRAM, ((split32_t)addr).b[SPLIT_T2], ((split32_t)addr).b[SPLIT_T1], ((split32_t)addr).b[SPLIT_T0]};
-    uint8_t wren = CMD_WRITE_ENABLE;
-
-    /* Enable write */
-    SPI_CS_Enable(SPI1_ID);
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, &wren, 1)) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    SPI_CS_Disable(SPI1_ID);
-    /* Send program command */
-    SPI_CS_Enable(SPI1_ID);
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd))) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, (void *)buffer, size)) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    SPI_CS_Disable(SPI1_ID);
-    /* Wait for completion, and return result */
-    return (IS25LP080D_WaitWhileBusy(CMD_PAGE_PROGRAM)); 
-}
-
-
-int IS25LP080D_Erase(const void *context, uint32_t addr, uint32_t size) 
-{
-    assert_param(addr < 0x100000); 
-    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)    
-    NOT_USED(context);
-
-    uint8_t cmd[4] = {0, ((split32_t)addr).b[SPLIT_T2], ((split32_t)addr).b[SPLIT_T1], ((split32_t)addr).b[SPLIT_T0]};
-    uint8_t wren = CMD_WRITE_ENABLE;
-
-    // Determine command based on size
-    if (size == 4096) 
-    {
-        cmd[0] = CMD_SECTOR_ERASE;
-    } else if (size == 65536) 
-    {
-        cmd[0] = CMD_BLOCK_ERASE;
-    } 
-    else 
-    {
-        return IS25LP080D_ERROR; // Unsupported size
-    }
-    // Enable write
-    SPI_CS_Enable(SPI1_ID);
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, &wren, 1)) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    SPI_CS_Disable(SPI1_ID);
-    // Send erase command
-    SPI_CS_Enable(SPI1_ID);
-    if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd))) 
-    {
-        SPI_CS_Disable(SPI1_ID);
-        return IS25LP080D_ERROR;
-    }
-    SPI_CS_Disable(SPI1_ID);
-    // Wait for completion, and return result
-    return (IS25LP080D_WaitWhileBusy(cmd[0]));
-}
-
-
-int IS25LP080D_Sync(const void *context) 
-{
-    NOT_USED(context);
-
-    return 0; // No action needed for blocking operations
-}
-
-
-/**
-  * @brief Waits while the memory is busy.
-  * @param memOpcode The memory operation code.
-  * 
-  * This function waits while the memory is busy performing an operation.
-  * 
-  * @return 0 if the memory is ready, a negative number if an error occurred.
-  */
-static int IS25LP080D_WaitWhileBusy(uint8_t memOpcode) 
-{
-    uint8_t status = 0;
-    uint8_t cmd = CMD_READ_STATUS;
-    swtimer_t busyTimeout;
-
-    LoadSWTimer(&busyTimeout);
-    do 
-    {
-        if (SWTimerTimeout(&busyTimeout, IS25LP080D_BUSY_TIMEOUT_MSEC, mSec, NULL)) 
-        {
-            RTT_Printf(RTT_EC_IS25LP080D_TIMEOUT, memOpcode);
-            ManageEventError(EC_IS25LP080D_TIMEOUT, true, memOpcode);
-            return IS25LP080D_ERROR;
-        }
-        SPI_CS_Enable(SPI1_ID);
-        if (!SPI_Transmit(IS25LP080D_SPI_LINE, &cmd, 1))
-        {
-            SPI_CS_Disable(SPI1_ID);
-            return IS25LP080D_ERROR;
-        }
-        if (!SPI_Receive(IS25LP080D_SPI_LINE, &status, 1)) 
-        {
-            SPI_CS_Disable(SPI1_ID);
-            return IS25LP080D_ERROR;
-        }
-        SPI_CS_Disable(SPI1_ID);
-    } while (status & 0x01);    // WIP bit is set
-    return 0;   // Success
-}
-
-
-/**
- * @brief Delays execution for a specified number of cycles using NOP instructions.
- *
- * This function introduces a delay by executing a specified number of NOP (No Operation) 
- * instructions. The delay duration is about 6.25 nSec multiplied by the number of cycles.
- *
- * @param cycles The number of NOP (6.25 nSec) cycles to delay.
- */
-/*
-static void DelayNOP(uint32_t cycles) 
-{
-    while (cycles--) 
-    {
-        __asm__("NOP");
-    }
-}
-*/
-
-/**
-  * @}
-*/
- 
+/** @addtogroup IS25LP080D_driver
+  * @{
+*/
+
+/**
+  *******************************************************************************
+  * @file           : IS25LP080D_driver.c
+  * @author         : Massimo Casoni
+  * @date           : 29/11/2024
+  * @brief          : IS25LP080D serial memory driver
+  ********************************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "utilities.h"  
+#include "spi.h"
+#include "gpio.h"
+#include "e_emulator.h"
+#include "stm32_assert.h"
+#include "swtimer.h"
+#include "IS25LP080D_driver.h"
+
+
+// Define IS25LP080D commands
+#define CMD_READ             0x03
+#define CMD_FAST_READ        0x0B
+#define CMD_WRITE_ENABLE     0x06
+#define CMD_PAGE_PROGRAM     0x02
+#define CMD_SECTOR_ERASE     0x20
+#define CMD_BLOCK32_ERASE    0x52
+#define CMD_BLOCK_ERASE      0xD8
+#define CMD_READ_STATUS      0x05
+#define CMD_WRITE_DISABLE    0x04
+#define CMD_RESET_ENABLE     0x66
+#define CMD_RESET            0x99
+#define CMD_READ_SFDP        0x5A
+
+
+// Status register bits
+#define STATUS_WIP           0x01
+#define STATUS_WEL           0x02
+
+
+#define IS25LP080D_SPI_LINE             SPI1_ID     // SPI line for the memory
+#define IS25LP080D_ERROR                -5          // Memory (LFS) error code 
+#define IS25LP080D_PAGE_SIZE            256u        // Page program size
+#define IS25LP080D_GLITCH              -1000       // Impossible status (internal code, recovered by IS25LP080D_Recover)
+#define IS25LP080D_BUSY_TIMEOUT_MSEC    2000        // Memory busy timeout (mSec)
+#define IS25LP080D_RESET_TIMEOUT_MSEC   10          // Memory ready timeout after a software reset (mSec)
+#define IS25LP080D_GLITCH_POLLS         3u          // Consecutive impossible status reads to detect a glitch
+#define IS25LP080D_RETRY_MAX            2u          // Retries of an operation after a glitch recovery
+#define IS25LP080D_SFDP_SIZE            64u         // SFDP data read to verify the SPI clock (header + basic table)
+#define IS25LP080D_SFDP_SIGNATURE       0x50444653u // SFDP header signature ("SFDP")
+#define IS25LP080D_CLOCK_CHECKS         4u          // SFDP reads verified at each SPI clock step
+#define IS25LP080D_VCC_MV               3300u       // Supply voltage (energy estimate)
+#define IS25LP080D_SCK_KHZ              50000u      // SPI clock (energy estimate of the transfers)
+#define IS25LP080D_READ_UA              8000u       // Active read current, datasheet typical (uA)
+#define IS25LP080D_WRITE_UA             12000u      // Program/erase current, datasheet typical (uA)
+#define IS25LP080D_PROG_USEC            200u        // Page program time, datasheet typical (uSec)
+#define IS25LP080D_ERASE_USEC           70000u      // Sector erase time, datasheet typical (uSec)
+#define IS25LP080D_BLOCK32_USEC         140000u     // 32K block erase time, datasheet typical (uSec)
+#define IS25LP080D_BLOCK_USEC           170000u     // 64K block erase time, datasheet typical (uSec)
+#define IS25LP080D_SLOW_PROG_MSEC       2           // Page program slower than the datasheet max (0.8 mSec)
+#define IS25LP080D_SLOW_ERASE_MSEC      300         // Sector erase slower than the datasheet max (300 mSec)
+#define IS25LP080D_SLOW_BLOCK32_MSEC    500         // 32K block erase slower than the datasheet max (500 mSec)
+#define IS25LP080D_SLOW_BLOCK_MSEC      1000        // Block erase slower than the datasheet max (1000 mSec)
+#define IS25LP080D_SLOW_FACTOR          2u          // Sector slower than the memory average by this factor
+#define IS25LP080D_AVG_SHIFT            3u          // Sector moving averages weight (1/8 to the new sample)
+#define IS25LP080D_AVG_ALL_SHIFT        6u          // Memory moving averages weight (1/64 to the new sample, long term reference)
+
+
+static uint32_t IS25LP080D_eraseCount[IS25LP080D_SECTOR_COUNT];   // Erases per sector
+static IS25LP080D_timing_t IS25LP080D_timing[IS25LP080D_SECTOR_COUNT];     // Program/erase durations per sector (averages << IS25LP080D_AVG_SHIFT)
+static IS25LP080D_timing_t IS25LP080D_timingAll;                  // Program/erase durations of the whole memory (averages << IS25LP080D_AVG_ALL_SHIFT)
+static uint8_t IS25LP080D_slow[IS25LP080D_SECTOR_COUNT / 8u];     // Sectors with an operation slower than the datasheet max
+static uint32_t IS25LP080D_busChunk;                              // Max data bytes per chip select assertion (0 = no split)
+static IS25LP080D_busHook_t IS25LP080D_busHook;                   // SPI bus arbitration hook
+static uint32_t IS25LP080D_busHold;                               // Max bytes transferred in a chip select assertion
+static uint32_t IS25LP080D_resets;                                // Software resets (glitch or timeout recoveries)
+static bool IS25LP080D_readCont;                                  // Continuation of sequential reads enabled
+static bool IS25LP080D_readOpen;                                  // Read in progress (chip select asserted)
+static uint32_t IS25LP080D_readNext;                              // Address of the next byte of the read in progress
+static uint32_t IS25LP080D_readHeld;                              // Bytes transferred by the read in progress
+static bool IS25LP080D_eraseDefer;                                // Sector erases queued until IS25LP080D_EraseFlush
+static uint8_t IS25LP080D_erasePending[IS25LP080D_SECTOR_COUNT / 8u];     // Queued sector erases
+static uint32_t IS25LP080D_erasePendingNum;                       // Number of queued sector erases
+static IS25LP080D_clockHook_t IS25LP080D_clockHook;               // SPI clock step setting (NULL = fixed clock)
+static uint32_t IS25LP080D_clockMax;                              // Fastest SPI clock step to try
+static uint32_t IS25LP080D_clockStep;                             // SPI clock step in use
+static uint8_t IS25LP080D_sfdp[IS25LP080D_SFDP_SIZE];             // SFDP data read at the conservative clock (reference)
+static IS25LP080D_energy_t IS25LP080D_energy;                     // Operation counts for the energy estimate
+static IS25LP080D_trace_t *IS25LP080D_trace;                      // Transactions trace ring buffer (NULL = no trace)
+static uint32_t IS25LP080D_traceNum;                              // Records of the trace ring buffer
+static uint32_t IS25LP080D_traceCount;                            // Records written since the trace start
+static IS25LP080D_traceClock_t IS25LP080D_traceClock;             // Trace time stamps (uSec)
+static IS25LP080D_trace_t IS25LP080D_traceCur;                    // Transaction in progress (chip select asserted)
+
+
+static int IS25LP080D_WaitWhileBusy(uint8_t memOpcode, uint32_t *polls, bool *slow);
+static void IS25LP080D_TimingUpdate(uint32_t *avg, uint32_t *max, uint32_t polls, uint32_t shift);
+static void IS25LP080D_Select(uint8_t memOpcode, uint32_t addr);
+static const char *IS25LP080D_TraceName(uint8_t memOpcode);
+static int IS25LP080D_Execute(uint8_t memOpcode, uint32_t addr, uint8_t const *data, uint32_t size, uint32_t *polls, bool *slow);
+static int IS25LP080D_Command(uint8_t memOpcode, uint32_t addr, uint8_t const *data, uint32_t size, uint32_t *polls, bool *slow);
+static int IS25LP080D_ReadStatus(uint8_t *status);
+static int IS25LP080D_Recover(void);
+static int IS25LP080D_EraseNow(uint32_t addr, uint32_t size);
+static bool IS25LP080D_ErasePending(uint32_t addr, uint32_t size);
+static bool IS25LP080D_EraseRange(uint32_t sector, uint32_t num);
+static int IS25LP080D_ReadSfdp(uint8_t *buffer);
+static bool IS25LP080D_ClockVerify(void);
+static void IS25LP080D_Deselect(uint32_t bytes);
+/* static void DelayNOP(uint32_t cycles); */
+
+
+void IS25LP080D_Init(void) 
+{
+    SPIn_Init(IS25LP080D_SPI_LINE);
+    if (IS25LP080D_clockHook)
+    {
+        (void)IS25LP080D_ClockTune();
+    }
+}
+
+
+int IS25LP080D_Read(const void *context, uint32_t addr, void *buffer, uint32_t size) 
+{
+    assert_param(buffer);
+    assert_param(addr < 0x100000); 
+    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)
+    NOT_USED(context);
+
+    uint8_t *data = (uint8_t *)buffer;
+    uint32_t chunk;
+    bool cont = (IS25LP080D_readCont) && (IS25LP080D_busChunk == 0u) && (IS25LP080D_busHook == NULL);
+
+    // Queued erases of the sectors to read are executed first
+    if (IS25LP080D_ErasePending(addr, size))
+    {
+        (void)IS25LP080D_EraseFlush();
+        if (IS25LP080D_ErasePending(addr, size))
+        {
+            return IS25LP080D_ERROR;    // Sector not erased (still queued)
+        }
+    }
+    // A sequential read continues the one in progress: no new read command
+    if ((IS25LP080D_readOpen) && (addr == IS25LP080D_readNext) && (size > 0u))
+    {
+        if (!SPI_Receive(IS25LP080D_SPI_LINE, data, size))
+        {
+            IS25LP080D_ReadStop();
+            return IS25LP080D_ERROR;
+        }
+        IS25LP080D_readNext += size;
+        IS25LP080D_readHeld += size;
+        return 0;
+    }
+    IS25LP080D_ReadStop();
+    // Long reads are split in chunks, each one with its own read command, to bound the bus hold.
+    // FAST READ (dummy byte after the address) has the SFDP read timing: the clock validated by
+    // IS25LP080D_ClockTune/IS25LP080D_ClockCheck is the one of the data reads (READ is 50 MHz max)
+    while (size > 0u)
+    {
+        uint8_t cmd[5] = {CMD_FAST_READ, ((split32_t)addr).b[SPLIT_T2], ((split32_t)addr).b[SPLIT_T1], ((split32_t)addr).b[SPLIT_T0], 0x00};
+
+        chunk = ((IS25LP080D_busChunk != 0u) && (size > IS25LP080D_busChunk)) ? IS25LP080D_busChunk : size;
+        IS25LP080D_Select(CMD_FAST_READ, addr);
+        if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd))) 
+        {
+            IS25LP080D_Deselect(sizeof(cmd));
+            return IS25LP080D_ERROR;
+        }
+        if (!SPI_Receive(IS25LP080D_SPI_LINE, data, chunk))
+        {
+            IS25LP080D_Deselect(sizeof(cmd) + chunk);
+            return IS25LP080D_ERROR;
+        }
+        if (cont)
+        {
+            // Chip select left asserted, closed by IS25LP080D_ReadStop (no chunks here)
+            IS25LP080D_readOpen = true;
+            IS25LP080D_readNext = addr + chunk;
+            IS25LP080D_readHeld = sizeof(cmd) + chunk;
+        }
+        else
+        {
+            IS25LP080D_Deselect(sizeof(cmd) + chunk);
+        }
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+
+int IS25LP080D_Program(const void *context, uint32_t addr, const void *buffer, uint32_t size) 
+{
+    assert_param(buffer);
+    assert_param(addr < 0x100000); 
+    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)
+    NOT_USED(context);
+
+    uint8_t const *data = (uint8_t const *)buffer;
+    uint32_t sector;
+    uint32_t chunk;
+    uint32_t polls;
+    bool slow;
+    int err = 0;
+
+    // Queued erases of the sectors to program are executed first
+    if (IS25LP080D_ErasePending(addr, size))
+    {
+        (void)IS25LP080D_EraseFlush();
+        if (IS25LP080D_ErasePending(addr, size))
+        {
+            return IS25LP080D_ERROR;    // Sector not erased (still queued): never program over old data
+        }
+    }
+    // Programs are split at the page boundaries and in chunks, to bound the bus hold
+    while ((size > 0u) && (err == 0))
+    {
+        chunk = IS25LP080D_PAGE_SIZE - (addr % IS25LP080D_PAGE_SIZE);
+        chunk = ((IS25LP080D_busChunk != 0u) && (chunk > IS25LP080D_busChunk)) ? IS25LP080D_busChunk : chunk;
+        chunk = (chunk > size) ? size : chunk;
+        // Send the program command, wait for completion, and record the program time
+        err = IS25LP080D_Execute(CMD_PAGE_PROGRAM, addr, data, chunk, &polls, &slow);
+        if (err == 0)
+        {
+            IS25LP080D_energy.programs++;
+            sector = addr / IS25LP080D_SECTOR_SIZE;
+            IS25LP080D_TimingUpdate(&(IS25LP080D_timing[sector].progAvg), &(IS25LP080D_timing[sector].progMax), polls, IS25LP080D_AVG_SHIFT);
+            IS25LP080D_TimingUpdate(&(IS25LP080D_timingAll.progAvg), &(IS25LP080D_timingAll.progMax), polls, IS25LP080D_AVG_ALL_SHIFT);
+            IS25LP080D_slow[sector / 8u] |= (uint8_t)((slow) ? (1u << (sector % 8u)) : 0u);
+        }
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return err;
+}
+
+
+int IS25LP080D_Erase(const void *context, uint32_t addr, uint32_t size) 
+{
+    assert_param(addr < 0x100000); 
+    assert_param(size <= 0x100000); // 8 Mbit memory (1 MByte)    
+    NOT_USED(context);
+
+    uint32_t sector;
+
+    if ((IS25LP080D_eraseDefer) && (size == IS25LP080D_SECTOR_SIZE))
+    {
+        // Queued, merged with the adjacent sectors by IS25LP080D_EraseFlush
+        sector = addr / IS25LP080D_SECTOR_SIZE;
+        if ((IS25LP080D_erasePending[sector / 8u] & (1u << (sector % 8u))) == 0u)
+        {
+            IS25LP080D_erasePending[sector / 8u] |= (uint8_t)(1u << (sector % 8u));
+            IS25LP080D_erasePendingNum++;
+        }
+        return 0;
+    }
+    if (IS25LP080D_ErasePending(addr, size))
+    {
+        // Queued erases of other sectors are executed first (same order as requested)
+        (void)IS25LP080D_EraseFlush();
+    }
+    return IS25LP080D_EraseNow(addr, size);
+}
+
+
+int IS25LP080D_Sync(const void *context) 
+{
+    NOT_USED(context);
+
+    IS25LP080D_ReadStop();
+    return IS25LP080D_EraseFlush(); // No other action needed for blocking operations
+}
+
+
+void IS25LP080D_SetEraseDeferral(bool enable)
+{
+    IS25LP080D_eraseDefer = enable;
+}
+
+
+int IS25LP080D_EraseFlush(void)
+{
+    uint32_t sector = 0u;
+    uint32_t pending = IS25LP080D_erasePendingNum;
+    uint32_t num;
+    int retVal = 0;
+    int err;
+
+    while ((pending > 0u) && (sector < IS25LP080D_SECTOR_COUNT))
+    {
+        if ((IS25LP080D_erasePending[sector / 8u] & (1u << (sector % 8u))) == 0u)
+        {
+            sector++;
+            continue;
+        }
+        // Aligned runs of queued sectors are merged into a 64K or 32K block erase
+        num = (((sector % 16u) == 0u) && (IS25LP080D_EraseRange(sector, 16u))) ? 16u :
+              ((((sector % 8u) == 0u) && (IS25LP080D_EraseRange(sector, 8u))) ? 8u : 1u);
+        err = IS25LP080D_EraseNow(sector * IS25LP080D_SECTOR_SIZE, num * IS25LP080D_SECTOR_SIZE);
+        pending -= num;
+        if (err)
+        {
+            // LFS was told these sectors are erased: they stay queued (retried by the next flush, and
+            // any read or program of them fails until they are erased)
+            retVal = (retVal) ? retVal : err;
+            sector += num;
+            continue;
+        }
+        for ( ; num > 0u ; num--, sector++)
+        {
+            IS25LP080D_erasePending[sector / 8u] &= (uint8_t)~(1u << (sector % 8u));
+            IS25LP080D_erasePendingNum--;
+        }
+    }
+    return retVal;
+}
+
+
+void IS25LP080D_SetReadContinuation(bool enable)
+{
+    IS25LP080D_ReadStop();
+    IS25LP080D_readCont = enable;
+}
+
+
+void IS25LP080D_ReadStop(void)
+{
+    if (IS25LP080D_readOpen)
+    {
+        IS25LP080D_readOpen = false;
+        IS25LP080D_Deselect(IS25LP080D_readHeld);
+    }
+}
+
+
+uint32_t IS25LP080D_GetEraseCount(uint32_t sector)
+{
+    assert_param(sector < IS25LP080D_SECTOR_COUNT);
+
+    return IS25LP080D_eraseCount[sector];
+}
+
+
+void IS25LP080D_SetEraseCount(uint32_t sector, uint32_t count)
+{
+    assert_param(sector < IS25LP080D_SECTOR_COUNT);
+
+    IS25LP080D_eraseCount[sector] = count;
+}
+
+
+void IS25LP080D_GetTiming(uint32_t sector, IS25LP080D_timing_t *timing)
+{
+    assert_param(timing);
+    assert_param((sector < IS25LP080D_SECTOR_COUNT) || (sector == IS25LP080D_SECTOR_ALL));
+
+    uint32_t shift = (sector == IS25LP080D_SECTOR_ALL) ? IS25LP080D_AVG_ALL_SHIFT : IS25LP080D_AVG_SHIFT;
+
+    *timing = (sector == IS25LP080D_SECTOR_ALL) ? IS25LP080D_timingAll : IS25LP080D_timing[sector];
+    timing->progAvg >>= shift;
+    timing->eraseAvg >>= shift;
+}
+
+
+bool IS25LP080D_IsSlowSector(uint32_t sector)
+{
+    assert_param(sector < IS25LP080D_SECTOR_COUNT);
+
+    if (IS25LP080D_slow[sector / 8u] & (1u << (sector % 8u)))
+    {
+        return true;
+    }
+    // Trend: sector average well above the memory average
+    return (((IS25LP080D_timing[sector].eraseAvg >> IS25LP080D_AVG_SHIFT) > (IS25LP080D_SLOW_FACTOR * (IS25LP080D_timingAll.eraseAvg >> IS25LP080D_AVG_ALL_SHIFT))) ||
+            ((IS25LP080D_timing[sector].progAvg >> IS25LP080D_AVG_SHIFT) > (IS25LP080D_SLOW_FACTOR * (IS25LP080D_timingAll.progAvg >> IS25LP080D_AVG_ALL_SHIFT))));
+}
+
+
+void IS25LP080D_SetBusSharing(uint32_t maxChunk, IS25LP080D_busHook_t hook)
+{
+    IS25LP080D_ReadStop();
+    IS25LP080D_busChunk = maxChunk;
+    IS25LP080D_busHook = hook;
+}
+
+
+void IS25LP080D_SetClockTuning(IS25LP080D_clockHook_t hook, uint32_t maxStep)
+{
+    IS25LP080D_clockHook = hook;
+    IS25LP080D_clockMax = maxStep;
+    IS25LP080D_clockStep = 0u;
+}
+
+
+int IS25LP080D_ClockTune(void)
+{
+    uint32_t step;
+
+    if (IS25LP080D_clockHook == NULL)
+    {
+        return IS25LP080D_ERROR;
+    }
+    // Reference SFDP data at the conservative clock
+    IS25LP080D_clockStep = 0u;
+    (void)IS25LP080D_clockHook(0u);
+    if ((IS25LP080D_ReadSfdp(IS25LP080D_sfdp) != 0) ||
+        ((IS25LP080D_sfdp[0] | (IS25LP080D_sfdp[1] << 8) | (IS25LP080D_sfdp[2] << 16) | ((uint32_t)IS25LP080D_sfdp[3] << 24)) != IS25LP080D_SFDP_SIGNATURE))
+    {
+        memset(IS25LP080D_sfdp, 0, sizeof(IS25LP080D_sfdp));
+        return IS25LP080D_ERROR;
+    }
+    // Faster steps up to the first failure, then one step below it
+    for (step = 1u ; step <= IS25LP080D_clockMax ; step++)
+    {
+        if ((!IS25LP080D_clockHook(step)) || (!IS25LP080D_ClockVerify()))
+        {
+            break;
+        }
+        IS25LP080D_clockStep = step;
+    }
+    (void)IS25LP080D_clockHook(IS25LP080D_clockStep);
+    return 0;
+}
+
+
+int IS25LP080D_ClockCheck(void)
+{
+    if (IS25LP080D_clockHook == NULL)
+    {
+        return 0;   // Fixed clock
+    }
+    // Steps down until the SFDP data is read correctly
+    while (!IS25LP080D_ClockVerify())
+    {
+        if (IS25LP080D_clockStep == 0u)
+        {
+            return IS25LP080D_ERROR;
+        }
+        IS25LP080D_clockStep--;
+        (void)IS25LP080D_clockHook(IS25LP080D_clockStep);
+    }
+    return 0;
+}
+
+
+uint32_t IS25LP080D_GetClockStep(void)
+{
+    return IS25LP080D_clockStep;
+}
+
+
+void IS25LP080D_GetEnergy(IS25LP080D_energy_t *energy, bool reset)
+{
+    assert_param(energy);
+
+    // mV * uA * uSec = fJ
+    uint64_t bus = ((uint64_t)IS25LP080D_energy.busBytes * IS25LP080D_VCC_MV * IS25LP080D_READ_UA * 8000u) / IS25LP080D_SCK_KHZ;
+    uint64_t prog = (uint64_t)IS25LP080D_energy.programs * IS25LP080D_VCC_MV * IS25LP080D_WRITE_UA * IS25LP080D_PROG_USEC;
+    uint64_t erase = (((uint64_t)IS25LP080D_energy.erases[0] * IS25LP080D_ERASE_USEC) + ((uint64_t)IS25LP080D_energy.erases[1] * IS25LP080D_BLOCK32_USEC) +
+                      ((uint64_t)IS25LP080D_energy.erases[2] * IS25LP080D_BLOCK_USEC)) * IS25LP080D_VCC_MV * IS25LP080D_WRITE_UA;
+
+    *energy = IS25LP080D_energy;
+    energy->busUj = (uint32_t)(bus / 1000000000u);
+    energy->programUj = (uint32_t)(prog / 1000000000u);
+    energy->eraseUj = (uint32_t)(erase / 1000000000u);
+    energy->totalUj = (uint32_t)((bus + prog + erase) / 1000000000u);
+    energy->timeUs = (uint32_t)((((uint64_t)IS25LP080D_energy.busBytes * 8000u) / IS25LP080D_SCK_KHZ) + 
+                                ((uint64_t)IS25LP080D_energy.programs * IS25LP080D_PROG_USEC) + 
+                                ((uint64_t)IS25LP080D_energy.erases[0] * IS25LP080D_ERASE_USEC) + 
+                                ((uint64_t)IS25LP080D_energy.erases[1] * IS25LP080D_BLOCK32_USEC) + 
+                                ((uint64_t)IS25LP080D_energy.erases[2] * IS25LP080D_BLOCK_USEC));
+    if (reset)
+    {
+        memset(&IS25LP080D_energy, 0, sizeof(IS25LP080D_energy));
+    }
+}
+
+
+void IS25LP080D_SetTrace(IS25LP080D_trace_t *buffer, uint32_t num, IS25LP080D_traceClock_t clock)
+{
+    assert_param((buffer == NULL) || ((num > 0u) && (clock != NULL)));
+
+    IS25LP080D_ReadStop();
+    IS25LP080D_trace = buffer;
+    IS25LP080D_traceNum = num;
+    IS25LP080D_traceCount = 0u;
+    IS25LP080D_traceClock = clock;
+}
+
+
+uint32_t IS25LP080D_TraceBegin(void)
+{
+    return (IS25LP080D_trace) ? IS25LP080D_traceClock() : 0u;
+}
+
+
+void IS25LP080D_TraceEnd(const char *name, uint32_t start)
+{
+    if (IS25LP080D_trace)
+    {
+        IS25LP080D_trace_t *rec = &(IS25LP080D_trace[IS25LP080D_traceCount % IS25LP080D_traceNum]);
+
+        rec->name = name;
+        rec->start = start;
+        rec->end = IS25LP080D_traceClock();
+        rec->addr = IS25LP080D_SPAN_ADDR;
+        rec->bytes = 0u;
+        IS25LP080D_traceCount++;
+    }
+}
+
+
+uint32_t IS25LP080D_TraceExport(char *buffer, uint32_t size, uint32_t *index)
+{
+    assert_param(buffer);
+    assert_param(index);
+
+    IS25LP080D_trace_t const *rec;
+    uint32_t len = 0u;
+    int res;
+
+    if ((IS25LP080D_trace == NULL) || (size == 0u))
+    {
+        return 0u;
+    }
+    if ((IS25LP080D_traceCount - *index) > IS25LP080D_traceNum)
+    {
+        *index = IS25LP080D_traceCount - IS25LP080D_traceNum;  // Oldest record still in the ring buffer
+    }
+    buffer[0] = '\0';
+    for ( ; *index < IS25LP080D_traceCount ; (*index)++)
+    {
+        rec = &(IS25LP080D_trace[*index % IS25LP080D_traceNum]);
+        if (rec->addr == IS25LP080D_SPAN_ADDR)
+        {
+            res = snprintf(&(buffer[len]), size - len, "{\"name\":\"%s\",\"cat\":\"lfs\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%lu},\n",
+                           rec->name, (unsigned long)rec->start, (unsigned long)(rec->end - rec->start));
+        }
+        else
+        {
+            res = snprintf(&(buffer[len]), size - len, "{\"name\":\"%s\",\"cat\":\"spi\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%lu,"
+                           "\"args\":{\"addr\":\"0x%06lX\",\"bytes\":%lu}},\n",
+                           rec->name, (unsigned long)rec->start, (unsigned long)(rec->end - rec->start), (unsigned long)rec->addr, (unsigned long)rec->bytes);
+        }
+        if ((res < 0) || ((uint32_t)res >= (size - len)))
+        {
+            buffer[len] = '\0';     // No room for this event: exported by the next call
+            break;
+        }
+        len += (uint32_t)res;
+    }
+    return len;
+}
+
+
+uint32_t IS25LP080D_GetResetCount(void)
+{
+    return IS25LP080D_resets;
+}
+
+
+uint32_t IS25LP080D_GetMaxBusHold(bool reset)
+{
+    uint32_t hold = IS25LP080D_busHold;
+
+    if (reset)
+    {
+        IS25LP080D_busHold = 0u;
+    }
+    return hold;
+}
+
+
+/**
+  * @brief Executes a program or erase operation, recovering from bus glitches.
+  * @param memOpcode The memory operation code.
+  * @param addr The memory address.
+  * @param data The data to program (NULL for erases).
+  * @param size The number of bytes to program (0 for erases).
+  * @param polls The number of status polls (operation duration).
+  * @param slow The operation took longer than the datasheet maximum.
+  * 
+  * When the memory returns an impossible status, it is reset and the operation is sent again,
+  * up to IS25LP080D_RETRY_MAX times (programming the same data again is harmless on NOR flash).
+  * 
+  * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+  */
+static int IS25LP080D_Execute(uint8_t memOpcode, uint32_t addr, uint8_t const *data, uint32_t size, uint32_t *polls, bool *slow)
+{
+    uint32_t retry = 0u;
+    int err;
+
+    do
+    {
+        err = IS25LP080D_Command(memOpcode, addr, data, size, polls, slow);
+    } while ((err == IS25LP080D_GLITCH) && (IS25LP080D_Recover() == 0) && (retry++ < IS25LP080D_RETRY_MAX));
+    if (err == IS25LP080D_GLITCH)
+    {
+        RTT_Printf(RTT_EC_IS25LP080D_TIMEOUT, memOpcode);
+        ManageEventError(EC_IS25LP080D_TIMEOUT, true, memOpcode);
+        err = IS25LP080D_ERROR;
+    }
+    return err;
+}
+
+
+/**
+  * @brief Sends a program or erase command and waits for its completion.
+  * @param memOpcode The memory operation code.
+  * @param addr The memory address.
+  * @param data The data to program (NULL for erases).
+  * @param size The number of bytes to program (0 for erases).
+  * @param polls The number of status polls (operation duration).
+  * @param slow The operation took longer than the datasheet maximum.
+  * 
+  * @return 0 if the operation was successful, IS25LP080D_GLITCH if the memory returned an
+  *         impossible status, IS25LP080D_ERROR (-5) if another error occurred.
+  */
+static int IS25LP080D_Command(uint8_t memOpcode, uint32_t addr, uint8_t const *data, uint32_t size, uint32_t *polls, bool *slow)
+{
+    uint8_t cmd[4] = {memOpcode, ((split32_t)addr).b[SPLIT_T2], ((split32_t)addr).b[SPLIT_T1], ((split32_t)addr).b[SPLIT_T0]};
+    uint8_t wren = CMD_WRITE_ENABLE;
+
+    // Enable write
+    IS25LP080D_Select(CMD_WRITE_ENABLE, 0u);
+    if (!SPI_Transmit(IS25LP080D_SPI_LINE, &wren, 1)) 
+    {
+        IS25LP080D_Deselect(1);
+        return IS25LP080D_ERROR;
+    }
+    IS25LP080D_Deselect(1);
+    // Send the command (and the data)
+    IS25LP080D_Select(memOpcode, addr);
+    if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd))) 
+    {
+        IS25LP080D_Deselect(sizeof(cmd));
+        return IS25LP080D_ERROR;
+    }
+    if ((size > 0u) && (!SPI_Transmit(IS25LP080D_SPI_LINE, (void *)data, size)))
+    {
+        IS25LP080D_Deselect(sizeof(cmd) + size);
+        return IS25LP080D_ERROR;
+    }
+    IS25LP080D_Deselect(sizeof(cmd) + size);
+    return IS25LP080D_WaitWhileBusy(memOpcode, polls, slow);
+}
+
+
+/**
+  * @brief Waits while the memory is busy.
+  * @param memOpcode The memory operation code.
+  * @param polls The number of status polls (operation duration).
+  * @param slow The operation took longer than the datasheet maximum.
+  * 
+  * This function waits while the memory is busy performing an operation.
+  * A status with all the bits set (no memory on the bus), or busy without the write enable latch
+  * (the command was lost), is impossible during a program/erase: after IS25LP080D_GLITCH_POLLS
+  * consecutive ones the wait is aborted, without waiting for the busy timeout.
+  * 
+  * @return 0 if the memory is ready, IS25LP080D_GLITCH if the status is impossible, a negative
+  *         number if another error occurred.
+  */
+static int IS25LP080D_WaitWhileBusy(uint8_t memOpcode, uint32_t *polls, bool *slow) 
+{
+    uint8_t status = 0;
+    uint32_t glitches = 0u;
+    uint32_t slowMsec = (memOpcode == CMD_PAGE_PROGRAM) ? IS25LP080D_SLOW_PROG_MSEC : 
+                        ((memOpcode == CMD_SECTOR_ERASE) ? IS25LP080D_SLOW_ERASE_MSEC : 
+                        ((memOpcode == CMD_BLOCK32_ERASE) ? IS25LP080D_SLOW_BLOCK32_MSEC : IS25LP080D_SLOW_BLOCK_MSEC));
+    swtimer_t busyTimeout;
+    swtimer_t slowTimeout;
+
+    *polls = 0u;
+    *slow = false;
+    LoadSWTimer(&busyTimeout);
+    LoadSWTimer(&slowTimeout);
+    do 
+    {
+        if ((*slow == false) && (SWTimerTimeout(&slowTimeout, slowMsec, mSec, NULL)))
+        {
+            *slow = true;
+        }
+        if (SWTimerTimeout(&busyTimeout, IS25LP080D_BUSY_TIMEOUT_MSEC, mSec, NULL)) 
+        {
+            RTT_Printf(RTT_EC_IS25LP080D_TIMEOUT, memOpcode);
+            ManageEventError(EC_IS25LP080D_TIMEOUT, true, memOpcode);
+            (void)IS25LP080D_Recover();     // Leave the memory in a known state for the next operations
+            return IS25LP080D_ERROR;
+        }
+        if (IS25LP080D_ReadStatus(&status) != 0)
+        {
+            return IS25LP080D_ERROR;
+        }
+        (*polls)++;
+        glitches = ((status == 0xFF) || ((status & (STATUS_WIP | STATUS_WEL)) == STATUS_WIP)) ? (glitches + 1u) : 0u;
+        if (glitches >= IS25LP080D_GLITCH_POLLS)
+        {
+            return IS25LP080D_GLITCH;
+        }
+    } while (status & STATUS_WIP);  // WIP bit is set
+    return 0;   // Success
+}
+
+
+/**
+  * @brief Reads the memory status register.
+  * @param status The status register.
+  * 
+  * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+  */
+static int IS25LP080D_ReadStatus(uint8_t *status)
+{
+    uint8_t cmd = CMD_READ_STATUS;
+
+    IS25LP080D_Select(CMD_READ_STATUS, 0u);
+    if (!SPI_Transmit(IS25LP080D_SPI_LINE, &cmd, 1))
+    {
+        IS25LP080D_Deselect(1);
+        return IS25LP080D_ERROR;
+    }
+    if (!SPI_Receive(IS25LP080D_SPI_LINE, status, 1)) 
+    {
+        IS25LP080D_Deselect(2);
+        return IS25LP080D_ERROR;
+    }
+    IS25LP080D_Deselect(2);
+    return 0;
+}
+
+
+/**
+  * @brief Recovers the memory from a bus glitch (e.g. a brown-out in the middle of a command).
+  * 
+  * The SPI line is initialized again and the memory is reset (Reset Enable + Reset), which
+  * aborts any operation in progress. The memory must then be ready (not busy, write disabled)
+  * within IS25LP080D_RESET_TIMEOUT_MSEC.
+  * 
+  * @return 0 if the memory is ready, IS25LP080D_ERROR (-5) otherwise.
+  */
+static int IS25LP080D_Recover(void)
+{
+    uint8_t cmd[2] = {CMD_RESET_ENABLE, CMD_RESET};
+    uint8_t status;
+    uint32_t i;
+    swtimer_t readyTimeout;
+
+    IS25LP080D_resets++;
+    SPIn_Init(IS25LP080D_SPI_LINE);
+    if (IS25LP080D_clockHook)
+    {
+        (void)IS25LP080D_clockHook(IS25LP080D_clockStep);   // Tuned clock restored after the line initialization
+    }
+    for (i = 0 ; i < sizeof(cmd) ; i++)
+    {
+        // Each command in its own chip select assertion
+        IS25LP080D_Select(cmd[i], 0u);
+        if (!SPI_Transmit(IS25LP080D_SPI_LINE, &(cmd[i]), 1))
+        {
+            IS25LP080D_Deselect(1);
+            return IS25LP080D_ERROR;
+        }
+        IS25LP080D_Deselect(1);
+    }
+    LoadSWTimer(&readyTimeout);
+    do
+    {
+        if (SWTimerTimeout(&readyTimeout, IS25LP080D_RESET_TIMEOUT_MSEC, mSec, NULL))
+        {
+            return IS25LP080D_ERROR;
+        }
+        if (IS25LP080D_ReadStatus(&status) != 0)
+        {
+            return IS25LP080D_ERROR;
+        }
+    } while ((status == 0xFF) || (status & (STATUS_WIP | STATUS_WEL)));
+    return 0;
+}
+
+
+/**
+  * @brief Updates the moving average and the maximum of an operation duration.
+  * @param avg The moving average, scaled by 2^shift for precision (0 = no samples).
+  * @param max The maximum.
+  * @param polls The operation duration (status polls).
+  * @param shift The weight of the new sample (1 / 2^shift).
+  */
+static void IS25LP080D_TimingUpdate(uint32_t *avg, uint32_t *max, uint32_t polls, uint32_t shift)
+{
+    *avg = (*avg) ? ((*avg) - ((*avg) >> shift) + polls) : (polls << shift);
+    *max = (polls > *max) ? polls : *max;
+}
+
+
+/**
+  * @brief Erases a sector or a block of the memory.
+  * @param addr The memory address.
+  * @param size The number of bytes to erase (sector, 32K or 64K block).
+  * 
+  * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+  */
+static int IS25LP080D_EraseNow(uint32_t addr, uint32_t size)
+{
+    uint8_t opcode;
+    uint32_t sector;
+    uint32_t polls;
+    bool slow;
+    int err;
+
+    // Determine command based on size
+    if (size == 4096) 
+    {
+        opcode = CMD_SECTOR_ERASE;
+    } else if (size == 32768)
+    {
+        opcode = CMD_BLOCK32_ERASE;
+    } else if (size == 65536) 
+    {
+        opcode = CMD_BLOCK_ERASE;
+    } 
+    else 
+    {
+        return IS25LP080D_ERROR; // Unsupported size
+    }
+    // Send the erase command, wait for completion, and count the erased sectors
+    err = IS25LP080D_Execute(opcode, addr, NULL, 0u, &polls, &slow);
+    if (err == 0)
+    {
+        IS25LP080D_energy.erases[(opcode == CMD_SECTOR_ERASE) ? 0 : ((opcode == CMD_BLOCK32_ERASE) ? 1 : 2)]++;
+        // The memory erases the sector/block containing addr
+        for (sector = (addr & ~(size - 1u)) / IS25LP080D_SECTOR_SIZE ; sector < (((addr & ~(size - 1u)) + size) / IS25LP080D_SECTOR_SIZE) ; sector++)
+        {
+            IS25LP080D_eraseCount[sector]++;
+            IS25LP080D_slow[sector / 8u] |= (uint8_t)((slow) ? (1u << (sector % 8u)) : 0u);
+        }
+        if (opcode == CMD_SECTOR_ERASE)
+        {
+            // Block erase times are not comparable with the sector ones: only the slow flag is kept
+            sector = addr / IS25LP080D_SECTOR_SIZE;
+            IS25LP080D_TimingUpdate(&(IS25LP080D_timing[sector].eraseAvg), &(IS25LP080D_timing[sector].eraseMax), polls, IS25LP080D_AVG_SHIFT);
+            IS25LP080D_TimingUpdate(&(IS25LP080D_timingAll.eraseAvg), &(IS25LP080D_timingAll.eraseMax), polls, IS25LP080D_AVG_ALL_SHIFT);
+        }
+    }
+    return err;
+}
+
+
+/**
+  * @brief Reads the SFDP data (header and basic parameter table) of the memory.
+  * @param buffer The buffer (IS25LP080D_SFDP_SIZE bytes).
+  * 
+  * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+  */
+static int IS25LP080D_ReadSfdp(uint8_t *buffer)
+{
+    uint8_t cmd[5] = {CMD_READ_SFDP, 0, 0, 0, 0};  // Address 0, then one dummy byte
+
+    IS25LP080D_Select(CMD_READ_SFDP, 0u);
+    if (!SPI_Transmit(IS25LP080D_SPI_LINE, cmd, sizeof(cmd)))
+    {
+        IS25LP080D_Deselect(sizeof(cmd));
+        return IS25LP080D_ERROR;
+    }
+    if (!SPI_Receive(IS25LP080D_SPI_LINE, buffer, IS25LP080D_SFDP_SIZE))
+    {
+        IS25LP080D_Deselect(sizeof(cmd) + IS25LP080D_SFDP_SIZE);
+        return IS25LP080D_ERROR;
+    }
+    IS25LP080D_Deselect(sizeof(cmd) + IS25LP080D_SFDP_SIZE);
+    return 0;
+}
+
+
+/**
+  * @brief Verifies the reads at the current SPI clock against the reference SFDP data.
+  * 
+  * @return true if IS25LP080D_CLOCK_CHECKS reads match the reference, false otherwise.
+  */
+static bool IS25LP080D_ClockVerify(void)
+{
+    uint8_t data[IS25LP080D_SFDP_SIZE];
+    uint32_t i;
+
+    for (i = 0 ; i < IS25LP080D_CLOCK_CHECKS ; i++)
+    {
+        if ((IS25LP080D_ReadSfdp(data) != 0) || (memcmp(data, IS25LP080D_sfdp, sizeof(data)) != 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+  * @brief Checks if a memory range has queued sector erases.
+  * @param addr The memory address.
+  * @param size The number of bytes.
+  */
+static bool IS25LP080D_ErasePending(uint32_t addr, uint32_t size)
+{
+    uint32_t sector;
+
+    if ((IS25LP080D_erasePendingNum == 0u) || (size == 0u))
+    {
+        return false;
+    }
+    for (sector = addr / IS25LP080D_SECTOR_SIZE ; sector <= ((addr + size - 1u) / IS25LP080D_SECTOR_SIZE) ; sector++)
+    {
+        if (IS25LP080D_erasePending[(sector % IS25LP080D_SECTOR_COUNT) / 8u] & (1u << (sector % 8u)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+  * @brief Checks if a range of sectors has all the erases queued.
+  * @param sector The first sector.
+  * @param num The number of sectors.
+  */
+static bool IS25LP080D_EraseRange(uint32_t sector, uint32_t num)
+{
+    uint32_t i;
+
+    for (i = sector ; i < (sector + num) ; i++)
+    {
+        if ((i >= IS25LP080D_SECTOR_COUNT) || ((IS25LP080D_erasePending[i / 8u] & (1u << (i % 8u))) == 0u))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+  * @brief Acquires the SPI bus (arbitration hook) and selects the memory.
+  * @param memOpcode The memory command (trace).
+  * @param addr The memory address (trace).
+  * 
+  * A continued read in progress is stopped first.
+  */
+static void IS25LP080D_Select(uint8_t memOpcode, uint32_t addr)
+{
+    IS25LP080D_ReadStop();      // Any other command ends the read in progress
+    if (IS25LP080D_trace)
+    {
+        IS25LP080D_traceCur.start = IS25LP080D_traceClock();
+        IS25LP080D_traceCur.addr = addr;
+        IS25LP080D_traceCur.name = IS25LP080D_TraceName(memOpcode);
+    }
+    if (IS25LP080D_busHook)
+    {
+        IS25LP080D_busHook(true);
+    }
+    SPI_CS_Enable(SPI1_ID);
+}
+
+
+/**
+  * @brief Deselects the memory and releases the SPI bus (arbitration hook).
+  * @param bytes The bytes transferred while selected (bus hold measure).
+  */
+static void IS25LP080D_Deselect(uint32_t bytes)
+{
+    SPI_CS_Disable(SPI1_ID);
+    if (IS25LP080D_busHook)
+    {
+        IS25LP080D_busHook(false);
+    }
+    IS25LP080D_busHold = (bytes > IS25LP080D_busHold) ? bytes : IS25LP080D_busHold;
+    IS25LP080D_energy.busBytes += bytes;
+    if (IS25LP080D_trace)
+    {
+        IS25LP080D_trace_t *last = &(IS25LP080D_trace[(IS25LP080D_traceCount + IS25LP080D_traceNum - 1u) % IS25LP080D_traceNum]);
+
+        IS25LP080D_traceCur.end = IS25LP080D_traceClock();
+        IS25LP080D_traceCur.bytes = bytes;
+        if ((IS25LP080D_traceCount > 0u) && (IS25LP080D_traceCur.name == IS25LP080D_TraceName(CMD_READ_STATUS)) && (last->name == IS25LP080D_traceCur.name))
+        {
+            // Consecutive status polls in a single record
+            last->end = IS25LP080D_traceCur.end;
+            last->bytes += bytes;
+        }
+        else
+        {
+            IS25LP080D_trace[IS25LP080D_traceCount % IS25LP080D_traceNum] = IS25LP080D_traceCur;
+            IS25LP080D_traceCount++;
+        }
+    }
+}
+
+
+/**
+  * @brief Returns the trace name of a memory command.
+  */
+static const char *IS25LP080D_TraceName(uint8_t memOpcode)
+{
+    switch (memOpcode)
+    {
+        case CMD_READ:          return "READ";
+        case CMD_FAST_READ:     return "FREAD";
+        case CMD_WRITE_ENABLE:  return "WREN";
+        case CMD_PAGE_PROGRAM:  return "PP";
+        case CMD_SECTOR_ERASE:  return "SE";
+        case CMD_BLOCK32_ERASE: return "BE32";
+        case CMD_BLOCK_ERASE:   return "BE";
+        case CMD_READ_STATUS:   return "RDSR";
+        case CMD_RESET_ENABLE:  return "RSTEN";
+        case CMD_RESET:         return "RST";
+        case CMD_READ_SFDP:     return "RDSFDP";
+        default:                return "CMD";
+    }
+}
+
+
+/**
+ * @brief Delays execution for a specified number of cycles using NOP instructions.
+ *
+ * This function introduces a delay by executing a specified number of NOP (No Operation) 
+ * instructions. The delay duration is about 6.25 nSec multiplied by the number of cycles.
+ *
+ * @param cycles The number of NOP (6.25 nSec) cycles to delay.
+ */
+/*
+static void DelayNOP(uint32_t cycles) 
+{
+    while (cycles--) 
+    {
+        __asm__("NOP");
+    }
+}
+*/
+
+/**
+  * @}
+*/
+ 
@@ -1,100 +1,430 @@
-/** @addtogroup IS25LP080D_driver
-  * @{
-*/
-
-/**
-  *******************************************************************************
-  * @file           : IS25LP080D_driver.h
-  * @author         : Massimo Casoni
-  * @date           : 29/11/2024
-  * @brief          : IS25LP080D serial memory driver header
-  ********************************************************************************
-*/
-
-#ifndef __IS25LP080D_DRIVER_HEADER
-#define __IS25LP080D_DRIVER_HEADER
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#include <stdint.h>
-
-
-/**
- * @brief Initializes the memory.
- * 
- * This function initializes the memory.
- * 
- * @param None
- * @return Nothing
- */
-void IS25LP080D_Init(void);
-
-
-/**
- * @brief Reads data from the memory.
- * 
- * This function reads data from the memory starting from the specified address.
- * 
- * @param context The memory context (not used).
- * @param addr The memory address to start reading from.
- * @param buffer The buffer to store the read data.
- * @param size The number of bytes to read.
- * 
- * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
- */
-int IS25LP080D_Read(const void *context, uint32_t addr, void *buffer, uint32_t size);
-
-
-/**
- * @brief Programs data into the memory.
- * 
- * This function programs data into the memory starting from the specified address.
- * 
- * @param context The memory context (not used).
- * @param addr The memory address to start programming from.
- * @param buffer The buffer containing the data to program.
- * @param size The number of bytes to program.
- * 
- * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
- */
-int IS25LP080D_Program(const void *context, uint32_t addr, const void *buffer, uint32_t size);
-
-
-/**
- * @brief Erases data from the memory.
- * 
- * This function erases data from the memory starting from the specified address.
- * 
- * @param context The memory context (not used).
- * @param addr The memory address to start erasing from.
- * @param size The number of bytes to erase.
- * 
- * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
- */
-int IS25LP080D_Erase(const void *context, uint32_t addr, uint32_t size);
-
-
-/**
- * @brief Synchronizes the memory.
- * 
- * This function synchronizes the memory.
- * 
- * @param context The memory context (not used).
- * 
- * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
- */
-int IS25LP080D_Sync(const void *context);
-
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __IS25LP080D_DRIVER_HEADER */
-
-/**
-  * @}
-*/
+/** @addtogroup IS25LP080D_driver
+  * @{
+*/
+
+/**
+  *******************************************************************************
+  * @file           : IS25LP080D_driver.h
+  * @author         : Massimo Casoni
+  * @date           : 29/11/2024
+  * @brief          : IS25LP080D serial memory driver header
+  ********************************************************************************
+*/
+
+#ifndef __IS25LP080D_DRIVER_HEADER
+#define __IS25LP080D_DRIVER_HEADER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#define IS25LP080D_SECTOR_SIZE          4096u       // Erase sector size
+#define IS25LP080D_SECTOR_COUNT         256u        // Number of sectors (8 Mbit memory)
+#define IS25LP080D_SECTOR_ALL           0xFFFFFFFFu // Whole memory (IS25LP080D_GetTiming)
+#define IS25LP080D_SPAN_ADDR            0xFFFFFFFFu // Trace record of an operation span (IS25LP080D_TraceEnd)
+
+
+typedef struct
+{
+    uint32_t progAvg;                                   // Page program duration, moving average (status polls)
+    uint32_t progMax;                                   // Page program duration, maximum (status polls)
+    uint32_t eraseAvg;                                  // Sector erase duration, moving average (status polls)
+    uint32_t eraseMax;                                  // Sector erase duration, maximum (status polls)
+} IS25LP080D_timing_t;                                  // Program/erase timing statistics
+
+
+typedef struct
+{
+    uint32_t busBytes;                                  // Bytes transferred on the SPI bus
+    uint32_t programs;                                  // Page programs
+    uint32_t erases[3];                                 // Sector, 32K block and 64K block erases
+    uint32_t busUj;                                     // Transfers energy (uJ)
+    uint32_t programUj;                                 // Programs energy (uJ)
+    uint32_t eraseUj;                                   // Erases energy (uJ)
+    uint32_t totalUj;                                   // Total energy (uJ)
+    uint32_t timeUs;                                    // Modeled memory time (uSec): transfers, programs and erases
+} IS25LP080D_energy_t;                                  // Energy estimate
+
+
+typedef struct
+{
+    const char *name;                                   // Memory command (e.g. "PP", "RDSR") or operation span
+    uint32_t start;                                     // Start time (uSec)
+    uint32_t end;                                       // End time (uSec)
+    uint32_t addr;                                      // Memory address (IS25LP080D_SPAN_ADDR for spans)
+    uint32_t bytes;                                     // Bytes transferred (consecutive status polls merged)
+} IS25LP080D_trace_t;                                   // Trace record (chip select assertion)
+
+
+typedef uint32_t (*IS25LP080D_traceClock_t)(void);      // Trace time stamp (uSec, e.g. from a cycle counter)
+typedef void (*IS25LP080D_busHook_t)(bool acquire);     // SPI bus arbitration hook (true = acquire, false = release)
+typedef bool (*IS25LP080D_clockHook_t)(uint32_t step);  // SPI clock setting hook (0 = conservative clock, false = no such step)
+
+
+/**
+ * @brief Initializes the memory.
+ * 
+ * This function initializes the memory, and tunes the SPI clock if enabled
+ * (see IS25LP080D_SetClockTuning).
+ * 
+ * @param None
+ * @return Nothing
+ */
+void IS25LP080D_Init(void);
+
+
+/**
+ * @brief Reads data from the memory.
+ * 
+ * This function reads data from the memory starting from the specified address.
+ * 
+ * @param context The memory context (not used).
+ * @param addr The memory address to start reading from.
+ * @param buffer The buffer to store the read data.
+ * @param size The number of bytes to read.
+ * 
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+ */
+int IS25LP080D_Read(const void *context, uint32_t addr, void *buffer, uint32_t size);
+
+
+/**
+ * @brief Programs data into the memory.
+ * 
+ * This function programs data into the memory starting from the specified address. The data
+ * can cross page boundaries: it is split into one page program per page (the memory would wrap
+ * a page program around inside its 256 bytes page), and in bus sharing chunks.
+ * 
+ * @param context The memory context (not used).
+ * @param addr The memory address to start programming from.
+ * @param buffer The buffer containing the data to program.
+ * @param size The number of bytes to program.
+ * 
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+ */
+int IS25LP080D_Program(const void *context, uint32_t addr, const void *buffer, uint32_t size);
+
+
+/**
+ * @brief Erases data from the memory.
+ * 
+ * This function erases data from the memory starting from the specified address.
+ * When the erase deferral is enabled (see IS25LP080D_SetEraseDeferral), sector erases are only
+ * queued.
+ * 
+ * @param context The memory context (not used).
+ * @param addr The memory address to start erasing from.
+ * @param size The number of bytes to erase (4K sector, 32K or 64K block).
+ * 
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+ */
+int IS25LP080D_Erase(const void *context, uint32_t addr, uint32_t size);
+
+
+/**
+ * @brief Synchronizes the memory.
+ * 
+ * This function synchronizes the memory: the queued erases are executed, and a continued read
+ * in progress is stopped.
+ * 
+ * @param context The memory context (not used).
+ * 
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+ */
+int IS25LP080D_Sync(const void *context);
+
+
+/**
+ * @brief Enables the continuation of sequential reads.
+ * 
+ * When enabled, the chip select is left asserted at the end of a read: if the next read starts
+ * at the following address the memory simply keeps clocking data, without a new read command.
+ * Any other read or command closes the read in progress first.
+ * The continuation is not used while the SPI bus is shared (see IS25LP080D_SetBusSharing):
+ * otherwise, IS25LP080D_ReadStop must be called before other devices use the bus. The cp23lfs
+ * calls stop the read before returning (and before blocking in cp23lfs_file_openwait): the
+ * continuation applies to the reads of one call and the chip select is never left asserted
+ * between two calls.
+ * 
+ * @param enable true to enable the continuation (default disabled).
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetReadContinuation(bool enable);
+
+
+/**
+ * @brief Stops the read in progress.
+ * 
+ * This function releases the chip select left asserted by a continued read (no action if none).
+ * 
+ * @param None
+ * @return Nothing
+ */
+void IS25LP080D_ReadStop(void);
+
+
+/**
+ * @brief Enables the deferral of the sector erases.
+ * 
+ * When enabled, sector erases are queued: the queue is executed before any read or program of
+ * a queued sector, by IS25LP080D_Sync or by IS25LP080D_EraseFlush. The aligned runs of queued
+ * sectors are merged into 32K or 64K block erases (one block erase takes about the time of one
+ * sector erase). Nothing is erased ahead: a sector erased and programmed right after (as LFS
+ * does) is erased alone.
+ * 
+ * @param enable true to enable the deferral (default disabled).
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetEraseDeferral(bool enable);
+
+
+/**
+ * @brief Executes the queued sector erases.
+ * 
+ * The sectors of a failed erase stay queued: the next flush retries them, and a read or program
+ * of one of them fails until it is erased (LFS already considers them erased).
+ * 
+ * @param None
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if an error occurred.
+ */
+int IS25LP080D_EraseFlush(void);
+
+
+/**
+ * @brief Returns the erase count of a sector.
+ * 
+ * The driver counts the completed erases of each sector since start-up (a block erase counts
+ * for all its sectors). The counters are kept in RAM: persistent counts must be restored with
+ * IS25LP080D_SetEraseCount.
+ * 
+ * @param sector The sector (0 to IS25LP080D_SECTOR_COUNT - 1).
+ * 
+ * @return The number of erases of the sector.
+ */
+uint32_t IS25LP080D_GetEraseCount(uint32_t sector);
+
+
+/**
+ * @brief Sets the erase count of a sector.
+ * 
+ * This function restores the persistent erase count of a sector.
+ * 
+ * @param sector The sector (0 to IS25LP080D_SECTOR_COUNT - 1).
+ * @param count The number of erases of the sector.
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetEraseCount(uint32_t sector, uint32_t count);
+
+
+/**
+ * @brief Returns the program and erase timing statistics of a sector.
+ * 
+ * Program and sector erase durations are measured while waiting for the memory, in status polls
+ * (proportional to the time at a given SPI clock). Times grow as the sectors wear.
+ * 
+ * @param sector The sector (0 to IS25LP080D_SECTOR_COUNT - 1), or IS25LP080D_SECTOR_ALL for the whole memory.
+ * @param timing The timing statistics.
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_GetTiming(uint32_t sector, IS25LP080D_timing_t *timing);
+
+
+/**
+ * @brief Checks if a sector is slow (early wear-out warning).
+ * 
+ * A sector is slow when one of its operations took longer than the datasheet maximum (on the way
+ * to the busy timeout), or when its average program or erase time is more than twice the average
+ * of the whole memory.
+ * 
+ * @param sector The sector (0 to IS25LP080D_SECTOR_COUNT - 1).
+ * 
+ * @return true if the sector is slow, false otherwise.
+ */
+bool IS25LP080D_IsSlowSector(uint32_t sector);
+
+
+/**
+ * @brief Enables the SPI clock tuning.
+ * 
+ * The hook sets the SPI line clock (prescaler) to a step: 0 is the conservative clock, higher
+ * steps are faster. It must be set before IS25LP080D_Init, which then tunes the clock
+ * (see IS25LP080D_ClockTune).
+ * 
+ * @param hook The SPI clock setting hook (NULL = fixed clock).
+ * @param maxStep The fastest step to try.
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetClockTuning(IS25LP080D_clockHook_t hook, uint32_t maxStep);
+
+
+/**
+ * @brief Tunes the SPI clock.
+ * 
+ * The SFDP data of the memory is read at the conservative clock as a reference, then the clock
+ * is stepped up while the SFDP reads match the reference: the clock settles one step below the
+ * first failure. The data is read with FAST READ (0x0B), which has the SFDP read timing, so the
+ * clock validated here is the one of the data reads.
+ * 
+ * @param None
+ * @return 0 if the operation was successful, IS25LP080D_ERROR (-5) if the tuning is not enabled
+ *         or the reference could not be read (conservative clock kept).
+ */
+int IS25LP080D_ClockTune(void);
+
+
+/**
+ * @brief Validates the SPI clock again.
+ * 
+ * This function must be called periodically (e.g. when the temperature changes): the SFDP data
+ * is read again and compared with the reference, stepping the clock down until it matches.
+ * 
+ * @param None
+ * @return 0 if the reads are correct, IS25LP080D_ERROR (-5) if they fail at the conservative clock.
+ */
+int IS25LP080D_ClockCheck(void);
+
+
+/**
+ * @brief Returns the SPI clock step in use.
+ * 
+ * @param None
+ * @return The SPI clock step (0 = conservative clock).
+ */
+uint32_t IS25LP080D_GetClockStep(void);
+
+
+/**
+ * @brief Returns the energy estimate of the memory operations.
+ * 
+ * The driver counts the bytes transferred and the program/erase operations: the energy is
+ * estimated with the datasheet typical currents and times (at 3.3 V, 50 MHz SPI clock). Standby
+ * and deep power-down energy are not included, the driver having no time base: the host tests
+ * integrate them over the time of the flash model (sim_energy). Reset the estimate before a workload and read it after to compare
+ * configurations. The modeled time adds up the same typical times: it depends on the workload
+ * only, not on the bus timing of the target.
+ * 
+ * @param energy The operation counts and the energy estimate.
+ * @param reset true to restart the counts.
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_GetEnergy(IS25LP080D_energy_t *energy, bool reset);
+
+
+/**
+ * @brief Starts the trace of the memory transactions.
+ * 
+ * Each chip select assertion (command, address, bytes, start and end time) is recorded in a
+ * ring buffer: the oldest records are overwritten. Consecutive status polls are merged in a
+ * single record.
+ * 
+ * @param buffer The ring buffer (NULL = stop the trace).
+ * @param num The number of records of the buffer.
+ * @param clock The time stamp function.
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetTrace(IS25LP080D_trace_t *buffer, uint32_t num, IS25LP080D_traceClock_t clock);
+
+
+/**
+ * @brief Begins the trace of an operation span (e.g. a file system call).
+ * 
+ * @param None
+ * @return The span start time, for IS25LP080D_TraceEnd.
+ */
+uint32_t IS25LP080D_TraceBegin(void);
+
+
+/**
+ * @brief Ends the trace of an operation span.
+ * 
+ * The span is recorded with the memory transactions: the trace viewer nests them under it.
+ * 
+ * @param name The span name (static string).
+ * @param start The span start time (IS25LP080D_TraceBegin).
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_TraceEnd(const char *name, uint32_t start);
+
+
+/**
+ * @brief Exports the trace in Chrome trace-event format.
+ * 
+ * The records from index are formatted as JSON complete events ("ph":"X", time stamps in uSec),
+ * one per line, until the buffer is full: call it again with the updated index to export the
+ * rest (e.g. over RTT). The output must be preceded by "[" to load it in a trace viewer (the
+ * closing bracket is optional in the trace-event format).
+ * 
+ * @param buffer The text buffer.
+ * @param size The size of the buffer.
+ * @param index The next record to export (0 at the first call), updated.
+ * 
+ * @return The number of characters written (0 when all the records are exported).
+ */
+uint32_t IS25LP080D_TraceExport(char *buffer, uint32_t size, uint32_t *index);
+
+
+/**
+ * @brief Returns the number of memory software resets.
+ * 
+ * The memory is reset when it returns an impossible status during a program/erase (bus glitch,
+ * brown-out in the middle of a command), then the operation is retried, and after a busy timeout.
+ * 
+ * @param None
+ * @return The number of software resets since start-up.
+ */
+uint32_t IS25LP080D_GetResetCount(void);
+
+
+/**
+ * @brief Configures the sharing of the SPI bus with other devices.
+ * 
+ * Long transfers can be split to bound the time the memory holds the bus (and its chip select):
+ * reads are restarted with a new read command every maxChunk bytes, programs are split at the
+ * page boundaries and every maxChunk bytes (each piece is a separate page program, so values
+ * below the 256 bytes page size add program cycles).
+ * The hook is called with true before each chip select assertion (it may wait for the bus) and
+ * with false after each release (other devices may use the bus), status polls included.
+ * 
+ * @param maxChunk The maximum data bytes per chip select assertion (0 = no split).
+ * @param hook The bus arbitration hook (NULL = none).
+ * 
+ * @return Nothing
+ */
+void IS25LP080D_SetBusSharing(uint32_t maxChunk, IS25LP080D_busHook_t hook);
+
+
+/**
+ * @brief Returns the worst-case bus hold of the memory.
+ * 
+ * The hold is the number of bytes clocked in a single chip select assertion (command included):
+ * the hold time is hold * 8 / SPI clock.
+ * 
+ * @param reset true to restart the measure.
+ * 
+ * @return The maximum number of bytes transferred in a chip select assertion.
+ */
+uint32_t IS25LP080D_GetMaxBusHold(bool reset);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IS25LP080D_DRIVER_HEADER */
+
+/**
+  * @}
+*/
  
\ No newline at end of file
@@ -1,89 +1,5415 @@
-/** @addtogroup littlefs
-  * @{
-*/
-
-/**
-  *******************************************************************************
-  * @file           : littlefs.c
-  * @author         : Massimo Casoni
-  * @date           : 30/11/2024
-  * @brief          : littlefs integration module
-  ********************************************************************************
-*/
-
-#include "utilities.h"
-#include "emulator.h"
-#include "littlefs.h"
-#include "stm32_assert.h"
-
-
-#define CP23LFS_FILES_MAX       8u                                  /* Max number of opened files */
-
-
-static cp23lfs_fileStructure_t cp23lsf_file[CP23LFS_FILES_MAX];     /* Files buffer pool */
-
-
-
-static cp23lfs_file_t CP23_InitFileAttribute(void);
-static void CP23_ReleaseFileStructure(cp23lfs_file_t cp23lfs_file);
-
-
-
-static cp23lfs_file_t CP23_GetFileStructure(void)
-{
-    static uint32_t const parOffset[CP23LFS_ATTR_NUM] = {offsetof(cp23lfs_fileStructure_t, dId), offsetof(cp23lfs_fileStructure_t, date), offsetof(cp23lfs_fileStructure_t, time), offsetof(cp23lfs_fileStructure_t, flags), 
-                                                        offsetof(cp23lfs_fileStructure_t, authorization), offsetof(cp23lfs_fileStructure_t, owner), offsetof(cp23lfs_fileStructure_t, company)};
-    static uint32_t const parSize[CP23LFS_ATTR_NUM] = {sizeof(cp23lsf_file[0].dId), sizeof(cp23lsf_file[0].date), sizeof(cp23lsf_file[0].time), sizeof(cp23lsf_file[0].flags), 
-                                                        sizeof(cp23lsf_file[0].authorization), sizeof(cp23lsf_file[0].owner), sizeof(cp23lsf_file[0].company)};
-    cp23lfs_file_t retVal = NULL;   /* Default: not available */
-    uint32_t cnt;
-
-    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
-    {
-        if (cp23lsf_file[cnt].system.allocated == false)
-        {
-            cp23lsf_file[cnt].system.allocated = true;
-            retVal = &(cp23lsf_file[cnt]);
-            retVal->system.allocated = true;
-            break;
-        }
-    }
-    if (retVal)
-    {
-        /* Clear the file structure */
-        for (cnt = 0 ; cnt < (sizeof(cp23lfs_fileStructure_t) / sizeof(uint32_t)) ; cnt++)
-        {
-            *(((uint32_t *)(retVal)) + cnt) = 0u;
-        }
-        for (cnt = 0 ; cnt < (sizeof(cp23lfs_fileStructure_t) % sizeof(uint32_t)) ; cnt++)
-        {
-            *(((uint8_t *)(retVal)) + cnt) = 0u;
-        }
-        /* Init attributes description */
-        for (cnt = 0 ; cnt < CP23LFS_ATTR_NUM ; cnt++)
-        {
-            retVal->system.descr[cnt].type = cnt;
-            retVal->system.descr[cnt].buffer = (void *)(((char *)(retVal)) + parOffset[cnt]);
-            retVal->system.descr[cnt].size = parSize[cnt];
-        }
-        /* Init file configuration */
-        retVal->system.fileCfg.attrs = &(retVal->system.descr[0]);
-        retVal->system.fileCfg.attr_count = CP23LFS_ATTR_NUM;
-        retVal->system.fileCfg.buffer = (void *)(retVal->system.buffer);
-    }
-    return retVal;
-}
-
-
-static void CP23_ReleaseFileStructure(cp23lfs_file_t cp23lfs_file)
-{
-    assert_param(cp23lfs_file);
-
-    cp23lfs_file->system.allocated = false;
-}
-
-
-
-/**
-  * @}
-*/
+/** @addtogroup littlefs
+  * @{
+*/
+
+/**
+  *******************************************************************************
+  * @file           : littlefs.c
+  * @author         : Massimo Casoni
+  * @date           : 30/11/2024
+  * @brief          : littlefs integration module
+  ********************************************************************************
+*/
+
+#include "utilities.h"
+#include "emulator.h"
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "stm32_assert.h"
+
+
+#define CP23LFS_FILES_MAX       8u                                  /* Max number of opened files */
+#define CP23LFS_CACHES_MAX      CP23LFS_FILES_MAX                   /* File caches (shared read-only opens take none) */
+
+#define CP23LFS_BLOCK_SIZE      4096u                               /* Block size (IS25LP080D sector) */
+#define CP23LFS_BLOCK_COUNT     256u                                /* Number of blocks (8 Mbit memory) */
+#define CP23LFS_RW_SIZE         16u                                 /* Minimum read/program size */
+#define CP23LFS_LOOKAHEAD_SIZE  (CP23LFS_BLOCK_COUNT / 8u)          /* Lookahead bitmap size (whole memory) */
+#define CP23LFS_BLOCK_CYCLES    500                                 /* Erase cycles before metadata relocation */
+
+#define CP23LFS_SYS_DIR         "/.cp23"                            /* CP23 system directory (skipped by tree walks) */
+#define CP23LFS_INDEX_DIR       CP23LFS_SYS_DIR "/idx"              /* Secondary indexes directory */
+#define CP23LFS_WEAR_FILE       CP23LFS_SYS_DIR "/wear"             /* Wear table (erase count of each block) */
+#define CP23LFS_WEAR_CHUNK      16u                                 /* Erase counts per wear table read/write */
+#define CP23LFS_WEAR_DELTA      16u                                 /* Free blocks worn more than the least worn + delta are skipped */
+#define CP23LFS_WEAR_KEEP       16u                                 /* Min free blocks left to the allocator when skipping the worn ones */
+#define CP23LFS_WEAR_TMP        CP23LFS_SYS_DIR "/wl.tmp"           /* Copy of the file being relocated by the wear leveling */
+#define CP23LFS_WEAR_COPY       128u                                /* Wear leveling copy chunk */
+#define CP23LFS_INDEX_NAME_LEN  24u                                 /* Index bucket path length ("/.cp23/idx/" + type + 8 hex digits) */
+#define CP23LFS_TREE_DEPTH_MAX  16u                                 /* Max directory depth for tree walks */
+#define CP23LFS_QUERY_ATTR_MAX  32u                                 /* Largest attribute compared by queries */
+#define CP23LFS_SECS_PER_DAY    86400u                              /* Seconds per day */
+#define CP23LFS_STACK_FILL      0xA5u                               /* Stack paint pattern */
+#define CP23LFS_STACK_MARGIN    64u                                 /* Stack left unpainted below the cp23lfs_stack_mark frame */
+#define CP23LFS_LOG_TINDEX      (CP23LFS_ATTR_NUM + 1u)             /* Time index position in the log attributes (after the generation) */
+#define CP23LFS_REMOVE_BATCH    8u                                  /* Files gathered per lfs_remove_files call (LFS_REMOVE_BATCH per commit) */
+
+#define CP23LFS_SYSATTR_STATE   0x80u                               /* Index directory attribute: indexes state */
+#define CP23LFS_SYSATTR_GEN     0x81u                               /* System directory attribute: generation high-water mark */
+#define CP23LFS_GEN_CHUNK       64u                                 /* Generations reserved by each high-water mark update */
+#define CP23LFS_INDEX_CLEAN     0x5Au                               /* Indexes state: consistent with the files */
+#define CP23LFS_INDEX_DIRTY     0x00u                               /* Indexes state: being updated (or stale) */
+
+#define CP23_IDX_UNKNOWN        0u                                  /* Indexes state not read yet */
+#define CP23_IDX_VALID          1u                                  /* Indexes built and consistent */
+#define CP23_IDX_INVALID        2u                                  /* Indexes missing or stale */
+#define CP23_CTZ_NONE           ((lfs_block_t)-1)                   /* No CTZ skip-list (inline or empty file) */
+
+#define CP23_QUOTA_NONE         0xFFu                               /* Entry not charged to any owner group */
+
+#define CP23_PIN_NONE           CP23LFS_PINS_MAX                    /* File not pinned */
+#define CP23_PIN_ATTRS          offsetof(cp23lfs_fileStructure_t, size)     /* Attributes of a pinned file (public part before the size) */
+
+
+typedef int (*CP23_WalkCb_t)(void *data, const char *path, const struct lfs_info *info);
+typedef bool (*CP23_PurgeMatch_t)(const void *data, const char *path);
+
+typedef struct
+{
+    const cp23lfs_qcond_t *cond;                                    /* Query conditions */
+    uint32_t condNum;                                               /* Number of conditions */
+    cp23lfs_query_cb_t cb;                                          /* User callback */
+    void *data;                                                     /* User callback context */
+} CP23_Query_t;
+
+typedef struct
+{
+    uint32_t budget;                                                /* Max blocks to relocate */
+    uint32_t freeMean;                                              /* Average erases of the free blocks */
+    uint32_t freeNum;                                               /* Number of free blocks */
+    uint32_t mean;                                                  /* Average erases of the selected file blocks */
+    uint32_t blocks;                                                /* Blocks of the selected file (0 = none) */
+    char path[CP23LFS_PATH_MAX];                                    /* Selected file */
+} CP23_WearLevel_t;
+
+typedef struct
+{
+    bool used;                                                      /* Waiter slot in use */
+    bool granted;                                                   /* File structure reserved to the waiter */
+    uint8_t priority;                                               /* Waiter priority (higher first) */
+    uint32_t seq;                                                   /* Arrival order (first among equal priorities) */
+} CP23_Waiter_t;
+
+typedef struct
+{
+    bool used;                                                      /* Entry in use */
+    bool stale;                                                     /* File unpinned, removed or not reloaded: freed at its last pinned close */
+    uint8_t users;                                                  /* Pinned opens */
+    uint32_t off;                                                   /* Region in the pin RAM (path, attributes, content) */
+    uint32_t len;                                                   /* Region length */
+    uint32_t size;                                                  /* File size (content at the end of the region) */
+    uint32_t generation;                                            /* File generation */
+} CP23_Pin_t;
+
+typedef struct
+{
+    uint32_t hash;                                                  /* Path hash (0 = free) */
+    uint16_t opens;                                                 /* Read-only opens counted */
+} CP23_PinCand_t;
+
+typedef struct
+{
+    const char *dirPath;                                            /* Parent directory (normalized) */
+    const char * const *names;                                      /* Removed entry names */
+    uint32_t count;                                                 /* Number of removed entries */
+} CP23_PurgeNames_t;
+
+typedef struct
+{
+    lfs_block_t start;                                              /* First block of the window */
+    lfs_block_t next;                                               /* Next window offset to allocate */
+    lfs_block_t size;                                               /* Window size (0 = rescanned by the next allocation) */
+} CP23_Window_t;
+
+typedef struct
+{
+    bool fileCacheUsed[CP23LFS_CACHES_MAX];                         /* File caches in use */
+    int32_t usedBlocks;                                             /* Blocks in use (incremental, reconciled at mount) */
+    uint8_t usedMap[CP23LFS_BLOCK_COUNT / 8u];                      /* Blocks in use: allocated by LFS, freed on commit and remove */
+    uint8_t usedAhead[CP23LFS_LOOKAHEAD_SIZE];                      /* Allocation window bitmap at the last allocation count */
+    CP23_Window_t usedWin;                                          /* Allocation window at the last allocation count */
+    lfs_block_t sysHead;                                            /* Committed CTZ head of the system file open for writing */
+    lfs_size_t sysSize;                                             /* Committed CTZ size of the system file (0 = inline or new) */
+    cp23lfs_quota_t quota[CP23LFS_GROUP_NUM];                       /* Owner groups usage (incremental, reconciled at mount) */
+    uint32_t wearErases;                                            /* Erases since the last wear table save */
+    cp23lfs_rec_t *rec;                                             /* Workload records buffer (NULL = not recording) */
+    uint32_t recNum;                                                /* Records of the buffer */
+    uint32_t recCount;                                              /* Records written */
+    uint32_t recLost;                                               /* Calls not recorded (buffer full) */
+    cp23lfs_recClock_t recClock;                                    /* Records time stamp clock */
+    uint8_t filesUsed;                                              /* File structures in use */
+    uint8_t filesPeak;                                              /* File structures in use, high-water mark */
+    uint8_t dirsUsed;                                               /* Directories open */
+    uint8_t dirsPeak;                                               /* Directories open, high-water mark */
+    uint8_t cachesUsed;                                             /* File caches in use */
+    uint8_t sysUsed;                                                /* System file open */
+    uint8_t cachesPeak;                                             /* File caches in use, high-water mark */
+    CP23_Waiter_t waiter[CP23LFS_WAITERS_MAX];                      /* Opens waiting for a file structure */
+    uint32_t waitSeq;                                               /* Waiters arrival order */
+    uint8_t poolReserved;                                           /* Free file structures reserved to woken waiters */
+    cp23lfs_poolWait_t poolWait;                                    /* Waiter blocking hook (NULL = no wait) */
+    cp23lfs_poolWake_t poolWake;                                    /* Waiter wake up hook */
+    cp23lfs_lock_t lock;                                            /* Integrator file system lock (NULL = calls serialized otherwise) */
+    cp23lfs_lock_t unlock;                                          /* Integrator file system unlock */
+    cp23lfs_pool_t pool;                                            /* File structures pool contention */
+    CP23_Pin_t pinned[CP23LFS_PINS_MAX];                            /* Pinned files */
+    CP23_PinCand_t pinCand[CP23LFS_PINS_MAX];                       /* Files counted for the automatic pinning */
+    uint8_t *pinBuffer;                                             /* Pin RAM (NULL = no pinning) */
+    cp23lfs_pinPolicy_t pinPolicy;                                  /* Pinning policy */
+    cp23lfs_pinStats_t pinStats;                                    /* Pin RAM usage and counters */
+#ifdef CP23LFS_STACK_CHECK
+    uintptr_t stackTop;                                             /* Stack measure start (cp23lfs_stack_mark frame) */
+#endif
+    cp23lfs_clock_t clock;                                          /* Wall clock for new files time stamp */
+    uint32_t genLast;                                               /* Last file generation (high-water mark or highest stored at mount) */
+    uint32_t genMark;                                               /* Generation high-water mark stored in the system directory */
+    uint8_t idxState;                                               /* Secondary indexes state */
+} CP23_State_t;
+
+
+static int CP23_BlockRead(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size);
+static int CP23_BlockProg(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
+static int CP23_BlockErase(const struct lfs_config *c, lfs_block_t block);
+static int CP23_BlockSync(const struct lfs_config *c);
+static bool CP23_DeviceBlank(void);
+
+
+static cp23lfs_fileStructure_t cp23lsf_file[CP23LFS_FILES_MAX];     /* Files buffer pool */
+static uint8_t cp23lfs_fileCache[CP23LFS_CACHES_MAX][CP23LFS_CACHE_SIZE];  /* File caches pool */
+static uint32_t const cp23lfs_attrOffset[CP23LFS_ATTR_NUM] = {offsetof(cp23lfs_fileStructure_t, dId), offsetof(cp23lfs_fileStructure_t, date), offsetof(cp23lfs_fileStructure_t, time), offsetof(cp23lfs_fileStructure_t, flags), 
+                                                        offsetof(cp23lfs_fileStructure_t, authorization), offsetof(cp23lfs_fileStructure_t, owner), offsetof(cp23lfs_fileStructure_t, company), 
+                                                        offsetof(cp23lfs_fileStructure_t, epoch)};    /* Attributes position in the file structure */
+static uint32_t const cp23lfs_attrSize[CP23LFS_ATTR_NUM] = {sizeof(cp23lsf_file[0].dId), sizeof(cp23lsf_file[0].date), sizeof(cp23lsf_file[0].time), sizeof(cp23lsf_file[0].flags), 
+                                                        sizeof(cp23lsf_file[0].authorization), sizeof(cp23lsf_file[0].owner), sizeof(cp23lsf_file[0].company), 
+                                                        sizeof(cp23lsf_file[0].epoch)};   /* Attributes size */
+
+static uint8_t cp23lfs_readBuffer[CP23LFS_CACHE_SIZE];              /* LFS read cache */
+static uint8_t cp23lfs_progBuffer[CP23LFS_CACHE_SIZE];              /* LFS program cache */
+static uint32_t cp23lfs_lookaheadBuffer[CP23LFS_LOOKAHEAD_SIZE / sizeof(uint32_t)];    /* LFS lookahead bitmap */
+
+static lfs_t cp23lfs;                                               /* File system object */
+
+static CP23_State_t cp23lfs_state;                                  /* CP23 state (usage, quotas, recorder, pool, pins, generations) */
+
+static uint8_t cp23lfs_idxBuffer[CP23LFS_CACHE_SIZE];               /* System file cache (index buckets, wear table) */
+static lfs_file_t cp23lfs_idxFile;                                  /* System file object */
+static struct lfs_file_config const cp23lfs_idxCfg = {.buffer = cp23lfs_idxBuffer};  /* System file configuration */
+static const struct lfs_config cp23lfs_cfg =                        /* File system configuration */
+{
+    .context = NULL,
+    .read = CP23_BlockRead,
+    .prog = CP23_BlockProg,
+    .erase = CP23_BlockErase,
+    .sync = CP23_BlockSync,
+    .read_size = CP23LFS_RW_SIZE,
+    .prog_size = CP23LFS_RW_SIZE,
+    .block_size = CP23LFS_BLOCK_SIZE,
+    .block_count = CP23LFS_BLOCK_COUNT,
+    .block_cycles = CP23LFS_BLOCK_CYCLES,
+    .cache_size = CP23LFS_CACHE_SIZE,
+    .lookahead_size = CP23LFS_LOOKAHEAD_SIZE,
+    .read_buffer = cp23lfs_readBuffer,
+    .prog_buffer = cp23lfs_progBuffer,
+    .lookahead_buffer = cp23lfs_lookaheadBuffer,
+};
+
+
+
+static cp23lfs_file_t CP23_InitFileAttribute(void);
+static cp23lfs_file_t CP23_PoolWait(uint32_t timeout, uint8_t priority);
+static uint32_t CP23_PoolAvailable(bool cache);
+static cp23lfs_file_t CP23_FileShare(const char *path);
+static lfs_file_t *CP23_LfsFile(cp23lfs_file_t file);
+static bool CP23_FileShared(cp23lfs_file_t file);
+static void CP23_FileOutdate(const char *path);
+static void CP23_CallEnd(const char *name, uint32_t start);
+static void CP23_ReleaseFileStructure(cp23lfs_file_t cp23lfs_file);
+static int CP23_FileCommit(cp23lfs_file_t file, bool close);
+static void CP23_TimeSync(cp23lfs_file_t file);
+static uint32_t CP23_TimeIndexFind(const cp23lfs_tindexEntry_t entry[], uint32_t num, uint32_t timestamp);
+static int CP23_TimeSyncByPath(const char *path, uint8_t type);
+static uint32_t CP23_TimeToEpoch(const uint8_t *date, const uint8_t *time);
+static void CP23_EpochToTime(uint32_t epoch, uint8_t *date, uint8_t *time);
+static int CP23_TreeWalk(const char *root, CP23_WalkCb_t cb, void *data);
+static int CP23_QueryMatch(const char *path, const cp23lfs_qcond_t cond[], uint32_t condNum);
+static int CP23_QueryWalkCb(void *data, const char *path, const struct lfs_info *info);
+static bool CP23_IndexValid(void);
+static int CP23_IndexSetState(uint8_t state);
+static bool CP23_IndexChanged(const uint32_t oldKey[], const uint32_t newKey[], const char *oldPath, const char *newPath);
+static int CP23_IndexApply(const uint32_t oldKey[], const uint32_t newKey[], const char *oldPath, const char *newPath);
+static int CP23_IndexPurge(CP23_PurgeMatch_t match, const void *data);
+static int CP23_IndexBuildCb(void *data, const char *path, const struct lfs_info *info);
+static void CP23_IndexKeys(cp23lfs_file_t file, uint32_t key[]);
+static int CP23_IndexKeysByPath(const char *path, uint32_t key[]);
+static void CP23_IndexBucket(char *name, uint32_t idx, uint32_t key);
+static int CP23_Mkdir(const char *path);
+static int CP23_BucketAdd(uint32_t idx, uint32_t key, const char *path);
+static int CP23_BucketUpdate(uint32_t idx, uint32_t key, const char *path, const char *newPath);
+static bool CP23_PurgeAll(const void *data, const char *path);
+static bool CP23_PurgeTree(const void *data, const char *path);
+static bool CP23_PurgeNames(const void *data, const char *path);
+static uint32_t CP23_KeyHash(const uint8_t *key, uint32_t size);
+static int CP23_UsedReconcile(void);
+static int CP23_UsedCount(uint8_t used[], int32_t *blocks);
+static int CP23_UsedCountCb(void *data, lfs_block_t block);
+static void CP23_UsedSync(void);
+static void CP23_UsedSnap(void);
+static void CP23_UsedSet(lfs_block_t block, bool used);
+static void CP23_UsedRelease(const uint8_t freed[]);
+static void CP23_UsedCommit(lfs_block_t *head, lfs_size_t size, const lfs_file_t *file);
+static void CP23_UsedEntry(const char *path, uint8_t freed[]);
+static uint32_t CP23_UsedPairs(const char *dirPath, uint8_t pairs[]);
+static void CP23_UsedDropped(const char *dirPath, const uint8_t pairs[], uint32_t num, uint8_t freed[]);
+static lfs_block_t CP23_CtzHead(const lfs_file_t *file);
+static int CP23_CtzGet(const char *path, lfs_block_t *head, lfs_size_t *size);
+static uint32_t CP23_CtzIndex(lfs_size_t size);
+static int CP23_CtzPrev(lfs_block_t *block);
+static int CP23_CtzCollect(lfs_block_t head, lfs_size_t size, lfs_block_t newHead, lfs_size_t newSize, uint8_t set[]);
+static void CP23_QuotaRemoved(const struct lfs_info *info, uint8_t group);
+static uint32_t CP23_FileBlocks(lfs_size_t size);
+static int CP23_QuotaReconcile(void);
+static int CP23_WearLoad(void);
+static int CP23_WearSave(void);
+static int CP23_WearSteer(void);
+static void CP23_WearSkip(void);
+static int CP23_WearFill(lfs_block_t start);
+static CP23_Window_t CP23_Window(const CP23_Window_t *set);
+static bool CP23_WearIsFree(uint32_t off);
+static void CP23_WearMark(uint32_t off);
+static bool CP23_WearAvoid(lfs_block_t block, uint32_t limit);
+static int CP23_WearLevelCb(void *data, const char *path, const struct lfs_info *info);
+static int CP23_WearMove(const char *path);
+static int CP23_WearMoveAttrs(const char *path, uint8_t *scratch);
+static int CP23_CtzWear(lfs_block_t head, lfs_size_t size, uint32_t *sum);
+static bool CP23_FileIsOpen(const char *path);
+static int CP23_WearUsedCb(void *data, lfs_block_t block);
+static int CP23_QuotaReconcileCb(void *data, const char *path, const struct lfs_info *info);
+static int CP23_QuotaCheck(cp23lfs_file_t file, lfs_size_t newSize);
+static uint32_t CP23_QuotaReserved(cp23lfs_file_t file, uint8_t group);
+static void CP23_QuotaCharge(uint8_t group, lfs_size_t size, bool add);
+static int CP23_GenBump(const char *path);
+static int CP23_GenNext(uint32_t *generation);
+static int CP23_GenLoad(void);
+static uint32_t CP23_AttrHash(cp23lfs_file_t file);
+static uint8_t CP23_QuotaGroup(const char *path);
+static bool CP23_PathNormalize(char *dst, const char *src);
+static bool CP23_PathAppend(char *path, const char *name);
+static void CP23_PathParent(char *path);
+static bool CP23_PathIsSys(const char *path);
+static int CP23_DirOpen(lfs_dir_t *dir, const char *path);
+static int CP23_DirClose(lfs_dir_t *dir);
+static int CP23_SysOpen(const char *path, int flags, const struct lfs_file_config *cfg);
+static int CP23_SysClose(void);
+static void CP23_MemPeak(void);
+static int CP23_MapWrite(cp23lfs_map_t *map, uint32_t idx);
+static uint32_t CP23_PinFind(const char *path);
+static int CP23_PinAdd(const char *path);
+static int CP23_PinLoad(uint32_t idx, const char *path);
+static void CP23_PinFree(uint32_t idx);
+static void CP23_PinRelease(uint32_t idx);
+static void CP23_PinRefresh(const char *path);
+static void CP23_PinDrop(const char *path);
+static cp23lfs_file_t CP23_PinOpen(const char *path);
+static void CP23_PinClose(cp23lfs_file_t file);
+static lfs_ssize_t CP23_PinRead(cp23lfs_file_t file, void *buffer, lfs_size_t size);
+static lfs_soff_t CP23_PinSeek(cp23lfs_file_t file, lfs_soff_t off, int whence);
+static void CP23_PinCount(cp23lfs_file_t file);
+static int CP23_Remove(const char *path);
+static int CP23_Rename(const char *oldPath, const char *newPath);
+static int CP23_RemoveFiles(const char *dirPath, const struct lfs_info entry[], const uint8_t group[], uint32_t num, uint32_t *removed);
+static void CP23_Record(uint8_t call, cp23lfs_file_t file, uint32_t hash, uint32_t arg, uint16_t whence);
+static void CP23_ReplayPath(cp23lfs_replayPath_t resolve, uint32_t hash, char *path);
+
+
+
+cp23lfs_errorcode_t CP23Init(void)
+{
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    IS25LP080D_Init();
+    IS25LP080D_SetEraseDeferral(true);                              /* Erases issued back to back merged into block erases */
+    err = lfs_mount(&cp23lfs, &cp23lfs_cfg);
+    if ((err == LFS_ERR_CORRUPT) && CP23_DeviceBlank())
+    {
+        /* First start (no superblock written yet): format and mount again. Any other failure is
+           returned, so that a file system damaged or unreadable for a while is never wiped */
+        err = lfs_format(&cp23lfs, &cp23lfs_cfg);
+        if (err == 0)
+        {
+            err = lfs_mount(&cp23lfs, &cp23lfs_cfg);
+        }
+    }
+    cp23lfs_state.idxState = CP23_IDX_UNKNOWN;
+    cp23lfs_state.genLast = 0u;                                     /* Continued from the stored generations */
+    cp23lfs_state.wearErases = 0u;                                  /* Next wear table save counted from the mount */
+    CP23_PinDrop("");                                               /* Pinned contents of the previous mount (root path) */
+    if (err == 0)
+    {
+        err = CP23_WearLoad();
+    }
+    if (err == 0)
+    {
+        err = CP23_WearSteer();
+    }
+    if (err == 0)
+    {
+        err = CP23_UsedReconcile();
+    }
+    if (err == 0)
+    {
+        err = CP23_QuotaReconcile();
+    }
+    if (err == 0)
+    {
+        err = CP23_GenLoad();
+    }
+    CP23_CallEnd("init", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+lfs_ssize_t cp23lfs_fs_size(void)
+{
+    uint32_t start = IS25LP080D_TraceBegin();
+
+    CP23_UsedSync();
+#ifdef USE_FULL_ASSERT
+    /* Debug builds: check the counter against the traversal */
+    uint8_t used[CP23LFS_BLOCK_COUNT / 8u];
+    int32_t usedBlocks;
+
+    if ((CP23_UsedCount(used, &usedBlocks) == 0) && (usedBlocks != cp23lfs_state.usedBlocks))
+    {
+        LFS_WARN("cp23 used blocks drift %"PRId32, cp23lfs_state.usedBlocks - usedBlocks);
+    }
+#endif
+    CP23_CallEnd("fs size", start);
+    return (lfs_ssize_t)cp23lfs_state.usedBlocks;
+}
+
+
+lfs_ssize_t cp23lfs_fs_free(void)
+{
+    int32_t freeBlocks = (int32_t)CP23LFS_BLOCK_COUNT - (int32_t)cp23lfs_fs_size();
+
+    return (freeBlocks > 0) ? (lfs_ssize_t)freeBlocks : 0;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_fs_reconcile(void)
+{
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    err = CP23_UsedReconcile();
+    err = (err) ? err : CP23_QuotaReconcile();
+    CP23_CallEnd("reconcile", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_wear_sync(void)
+{
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    err = CP23_WearSave();
+    CP23_CallEnd("wear sync", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_wear_level(uint32_t budget, uint32_t *moved)
+{
+    CP23_WearLevel_t wl;
+    cp23lfs_wear_t stats;
+    uint32_t count;
+    uint32_t keep = 0u;
+    uint32_t cnt;
+    uint32_t span;
+    lfs_block_t start = 0u;
+    int err;
+
+    if (moved)
+    {
+        *moved = 0u;
+    }
+    cp23lfs_wear_stats(&stats);
+    if ((stats.max - stats.min) < CP23LFS_WEAR_STATIC)
+    {
+        return CP23LFS_OK;                                          /* Even wear: nothing to do */
+    }
+    span = IS25LP080D_TraceBegin();
+    err = CP23_Remove(CP23LFS_WEAR_TMP);                            /* Left by a reset during a relocation */
+    if ((err) && (err != LFS_ERR_NOENT))
+    {
+        CP23_CallEnd("wear level", span);
+        return CP23LFS_ERRORCODE(err);
+    }
+    /* Wear of the free blocks */
+    err = CP23_WearFill(0u);
+    wl.budget = budget;
+    wl.freeMean = 0u;
+    wl.freeNum = 0u;
+    wl.blocks = 0u;
+    for (cnt = 0 ; (cnt < CP23LFS_BLOCK_COUNT) && (err == 0) ; cnt++)
+    {
+        if (CP23_WearIsFree(cnt))
+        {
+            wl.freeMean += IS25LP080D_GetEraseCount(cnt);
+            wl.freeNum++;
+        }
+    }
+    wl.freeMean /= (wl.freeNum) ? wl.freeNum : 1u;
+    /* Coldest file: least worn blocks compared with the free ones */
+    if (err == 0)
+    {
+        err = CP23_TreeWalk("/", CP23_WearLevelCb, &wl);
+    }
+    if ((err) || (wl.blocks == 0u))
+    {
+        err = (err) ? err : CP23_WearSteer();
+        CP23_CallEnd("wear level", span);
+        return CP23LFS_ERRORCODE(err);
+    }
+    /* Allocate the copy from the most worn free blocks: start from the most worn one,
+       skip the free blocks worn less than the average while enough blocks are left */
+    for (cnt = 0, count = 0u ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        if ((CP23_WearIsFree(cnt)) && (IS25LP080D_GetEraseCount(cnt) >= count))
+        {
+            start = cnt;
+            count = IS25LP080D_GetEraseCount(cnt);
+        }
+    }
+    err = CP23_WearFill(start);
+    for (cnt = 0 ; (cnt < CP23LFS_BLOCK_COUNT) && (err == 0) ; cnt++)
+    {
+        if ((CP23_WearIsFree(cnt)) && (IS25LP080D_GetEraseCount((start + cnt) % CP23LFS_BLOCK_COUNT) >= wl.freeMean))
+        {
+            keep++;
+        }
+    }
+    for (cnt = 0 ; (cnt < CP23LFS_BLOCK_COUNT) && (err == 0) && (keep >= (wl.blocks + CP23LFS_WEAR_KEEP)) ; cnt++)
+    {
+        if (IS25LP080D_GetEraseCount((start + cnt) % CP23LFS_BLOCK_COUNT) < wl.freeMean)
+        {
+            CP23_WearMark(cnt);
+        }
+    }
+    if (err == 0)
+    {
+        err = CP23_WearMove(wl.path);
+    }
+    if ((err == 0) && (moved))
+    {
+        *moved = wl.blocks;
+    }
+    if (err == 0)
+    {
+        err = CP23_WearSteer();                                     /* Back to the least worn blocks */
+    }
+    else
+    {
+        (void)CP23_WearSteer();
+    }
+    CP23_CallEnd("wear level", span);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+void cp23lfs_wear_stats(cp23lfs_wear_t *stats)
+{
+    assert_param(stats);
+
+    uint32_t count;
+    uint32_t cnt;
+
+    stats->min = UINT32_MAX;
+    stats->max = 0u;
+    stats->total = 0u;
+    for (cnt = 0 ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        count = IS25LP080D_GetEraseCount(cnt);
+        stats->min = (count < stats->min) ? count : stats->min;
+        stats->max = (count > stats->max) ? count : stats->max;
+        stats->total += count;
+    }
+    stats->mean = stats->total / CP23LFS_BLOCK_COUNT;
+}
+
+
+void cp23lfs_mem_stats(cp23lfs_mem_t *mem, bool reset)
+{
+    assert_param(mem);
+
+    mem->fileSize = sizeof(cp23lfs_fileStructure_t);
+    mem->filePool = sizeof(cp23lsf_file);
+    mem->caches = sizeof(cp23lfs_readBuffer) + sizeof(cp23lfs_progBuffer) + sizeof(cp23lfs_idxBuffer) + sizeof(cp23lfs_fileCache);
+    mem->lookahead = sizeof(cp23lfs_lookaheadBuffer);
+    mem->lfsState = sizeof(cp23lfs) + sizeof(cp23lfs_idxFile);
+    mem->cp23State = sizeof(cp23lfs_state);
+    mem->total = mem->filePool + mem->caches + mem->lookahead + mem->lfsState + mem->cp23State;
+    mem->dirSize = sizeof(lfs_dir_t);
+    mem->filesMax = CP23LFS_FILES_MAX;
+    mem->filesUsed = cp23lfs_state.filesUsed;
+    mem->filesPeak = cp23lfs_state.filesPeak;
+    mem->dirsUsed = cp23lfs_state.dirsUsed;
+    mem->dirsPeak = cp23lfs_state.dirsPeak;
+    mem->cachesUsed = cp23lfs_state.cachesUsed + cp23lfs_state.sysUsed;
+    mem->cachesPeak = cp23lfs_state.cachesPeak;
+    if (reset)
+    {
+        cp23lfs_state.filesPeak = cp23lfs_state.filesUsed;
+        cp23lfs_state.dirsPeak = cp23lfs_state.dirsUsed;
+        cp23lfs_state.cachesPeak = mem->cachesUsed;
+    }
+}
+
+
+void cp23lfs_pool_wait_set(cp23lfs_poolWait_t wait, cp23lfs_poolWake_t wake)
+{
+    assert_param((wait == NULL) || (wake != NULL));
+
+    cp23lfs_state.poolWait = wait;
+    cp23lfs_state.poolWake = wake;
+}
+
+
+void cp23lfs_lock_set(cp23lfs_lock_t lock, cp23lfs_lock_t unlock)
+{
+    assert_param((lock == NULL) == (unlock == NULL));
+
+    cp23lfs_state.lock = lock;
+    cp23lfs_state.unlock = unlock;
+}
+
+
+void cp23lfs_pool_stats(cp23lfs_pool_t *stats, bool reset)
+{
+    assert_param(stats);
+
+    uint8_t waiters = 0u;
+    uint32_t cnt;
+
+    *stats = cp23lfs_state.pool;
+    if (reset)
+    {
+        for (cnt = 0 ; cnt < CP23LFS_WAITERS_MAX ; cnt++)
+        {
+            waiters += (cp23lfs_state.waiter[cnt].used) ? 1u : 0u;
+        }
+        memset(&cp23lfs_state.pool, 0, sizeof(cp23lfs_state.pool));
+        cp23lfs_state.pool.waitersPeak = waiters;
+    }
+}
+
+
+cp23lfs_errorcode_t cp23lfs_quota_set(uint8_t group, uint32_t limit)
+{
+    if (group >= CP23LFS_GROUP_NUM)
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_INVAL);
+    }
+    cp23lfs_state.quota[group].limit = limit;
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_quota_get(uint8_t group, cp23lfs_quota_t *quota)
+{
+    assert_param(quota);
+
+    if (group >= CP23LFS_GROUP_NUM)
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_INVAL);
+    }
+    *quota = cp23lfs_state.quota[group];
+    return CP23LFS_OK;
+}
+
+
+static cp23lfs_file_t CP23_GetFileStructure(bool cache)
+{
+    cp23lfs_file_t retVal = NULL;   /* Default: not available */
+    uint32_t slot = 0u;
+    uint32_t cnt;
+
+    if (CP23_PoolAvailable(cache) == 0u)
+    {
+        /* The free structures (or caches) are reserved to the woken waiters */
+        return NULL;
+    }
+    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
+    {
+        if (cp23lsf_file[cnt].system.allocated == false)
+        {
+            retVal = &(cp23lsf_file[cnt]);
+            slot = cnt;
+            break;
+        }
+    }
+    if (retVal)
+    {
+        /* Clear the file structure */
+        for (cnt = 0 ; cnt < (sizeof(cp23lfs_fileStructure_t) / sizeof(uint32_t)) ; cnt++)
+        {
+            *(((uint32_t *)(retVal)) + cnt) = 0u;
+        }
+        for (cnt = 0 ; cnt < (sizeof(cp23lfs_fileStructure_t) % sizeof(uint32_t)) ; cnt++)
+        {
+            *(((uint8_t *)(retVal)) + cnt) = 0u;
+        }
+        retVal->system.allocated = true;
+        retVal->system.holder = (uint8_t)slot;
+        cp23lfs_state.filesUsed++;
+        for (cnt = 0 ; (cnt < CP23LFS_CACHES_MAX) && cache ; cnt++)
+        {
+            if (cp23lfs_state.fileCacheUsed[cnt] == false)
+            {
+                cp23lfs_state.fileCacheUsed[cnt] = true;
+                cp23lfs_state.cachesUsed++;
+                retVal->system.buffer = cp23lfs_fileCache[cnt];
+                break;
+            }
+        }
+        CP23_MemPeak();
+        /* Init attributes description */
+        for (cnt = 0 ; cnt < CP23LFS_ATTR_NUM ; cnt++)
+        {
+            retVal->system.descr[cnt].type = cnt;
+            retVal->system.descr[cnt].buffer = (void *)(((char *)(retVal)) + cp23lfs_attrOffset[cnt]);
+            retVal->system.descr[cnt].size = cp23lfs_attrSize[cnt];
+        }
+        retVal->system.descr[CP23LFS_ATTR_NUM].type = CP23LFS_ATTR_GEN;
+        retVal->system.descr[CP23LFS_ATTR_NUM].buffer = &(retVal->system.generation);
+        retVal->system.descr[CP23LFS_ATTR_NUM].size = sizeof(retVal->system.generation);
+        /* Init file configuration */
+        retVal->system.fileCfg.attrs = &(retVal->system.descr[0]);
+        retVal->system.fileCfg.attr_count = CP23LFS_ATTR_NUM + 1u;
+        retVal->system.fileCfg.buffer = (void *)(retVal->system.buffer);
+    }
+    return retVal;
+}
+
+
+static void CP23_ReleaseFileStructure(cp23lfs_file_t cp23lfs_file)
+{
+    assert_param(cp23lfs_file);
+
+    uint32_t best = CP23LFS_WAITERS_MAX;
+    uint32_t cnt;
+
+    if (cp23lfs_file->system.allocated)
+    {
+        /* Released before waking a waiter: the structure is free when it runs */
+        cp23lfs_file->system.allocated = false;
+        cp23lfs_state.filesUsed--;
+        if (cp23lfs_file->system.buffer)
+        {
+            cp23lfs_state.fileCacheUsed[(cp23lfs_file->system.buffer - cp23lfs_fileCache[0]) / CP23LFS_CACHE_SIZE] = false;
+            cp23lfs_state.cachesUsed--;
+        }
+        /* Reserve the structure to the first waiter with the highest priority */
+        for (cnt = 0 ; (cnt < CP23LFS_WAITERS_MAX) && (CP23_PoolAvailable(true) > 0u) ; cnt++)
+        {
+            if (cp23lfs_state.waiter[cnt].used && !cp23lfs_state.waiter[cnt].granted && 
+                ((best == CP23LFS_WAITERS_MAX) || (cp23lfs_state.waiter[cnt].priority > cp23lfs_state.waiter[best].priority) || 
+                 ((cp23lfs_state.waiter[cnt].priority == cp23lfs_state.waiter[best].priority) && 
+                  ((int32_t)(cp23lfs_state.waiter[cnt].seq - cp23lfs_state.waiter[best].seq) < 0))))
+            {
+                best = cnt;
+            }
+        }
+        if (best < CP23LFS_WAITERS_MAX)
+        {
+            cp23lfs_state.waiter[best].granted = true;
+            cp23lfs_state.poolReserved++;
+            cp23lfs_state.poolWake((uint8_t)best);
+        }
+    }
+}
+
+
+cp23lfs_errorcode_t cp23lfs_file_opencfg(cp23lfs_file_t *file, const char *path, int flags)
+{
+    return cp23lfs_file_openwait(file, path, flags, 0u, 0u);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_file_openwait(cp23lfs_file_t *file, const char *path, int flags, uint32_t timeout, uint8_t priority)
+{
+    assert_param(file);
+    assert_param(path);
+
+    cp23lfs_file_t cp23file = (flags == LFS_O_RDONLY) ? CP23_PinOpen(path) : NULL;
+    uint32_t start = IS25LP080D_TraceBegin();
+    struct lfs_info info;
+    lfs_size_t ctzSize;
+    lfs_soff_t size;
+    uint32_t cnt;
+    int err;
+
+    *file = NULL;
+    if ((cp23file == NULL) && (flags == LFS_O_RDONLY))
+    {
+        cp23file = CP23_FileShare(path);
+    }
+    if (cp23file != NULL)
+    {
+        *file = cp23file;
+        CP23_Record(CP23LFS_REC_OPEN, cp23file, CP23_KeyHash((uint8_t const *)(cp23file->system.path), CP23LFS_PATH_MAX), (uint32_t)flags, 0u);
+        CP23_CallEnd("open", start);
+        return CP23LFS_OK;
+    }
+    cp23file = CP23_PoolWait(timeout, priority);
+    if (cp23file == NULL)
+    {
+        CP23_CallEnd("open", start);
+        return CP23LFS_ERRORCODE(LFS_ERR_NOMEM);
+    }
+    if (!CP23_PathNormalize(cp23file->system.path, path))
+    {
+        CP23_ReleaseFileStructure(cp23file);
+        CP23_CallEnd("open", start);
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    cp23file->system.indexed = true;
+    info.size = 0u;
+    cp23file->system.commitHead = CP23_CTZ_NONE;
+    if (flags & (LFS_O_CREAT | LFS_O_TRUNC))
+    {
+        cp23file->system.indexed = (lfs_stat(&cp23lfs, cp23file->system.path, &info) == 0);
+        cp23file->system.created = !(cp23file->system.indexed);
+    }
+    if ((flags & LFS_O_TRUNC) && (info.size > cp23lfs.inline_max))
+    {
+        /* Blocks of the file, freed by the commit of the truncation */
+        (void)CP23_CtzGet(cp23file->system.path, &(cp23file->system.commitHead), &ctzSize);
+    }
+    err = lfs_file_opencfg(&cp23lfs, &(cp23file->system.file), cp23file->system.path, flags, &(cp23file->system.fileCfg));
+    if (err)
+    {
+        CP23_ReleaseFileStructure(cp23file);
+        CP23_CallEnd("open", start);
+        return CP23LFS_ERRORCODE(err);
+    }
+    if ((flags & LFS_O_TRUNC) == 0)
+    {
+        cp23file->system.commitHead = CP23_CtzHead(&(cp23file->system.file));
+    }
+    if ((flags & LFS_O_RDONLY) != LFS_O_RDONLY)
+    {
+        /* Write-only opens do not load the attributes: keep the stored ones instead of clearing them at commit */
+        for (cnt = 0 ; cnt < (CP23LFS_ATTR_NUM + 1u) ; cnt++)
+        {
+            (void)lfs_getattr(&cp23lfs, cp23file->system.path, cp23file->system.descr[cnt].type, 
+                                cp23file->system.descr[cnt].buffer, cp23file->system.descr[cnt].size);
+        }
+    }
+    CP23_IndexKeys(cp23file, cp23file->system.idxKey);
+    cp23file->system.attrHash = CP23_AttrHash(cp23file);
+    cp23file->system.commitGroup = (CP23_PathIsSys(cp23file->system.path)) ? CP23_QUOTA_NONE : LfsOwnerGroup(cp23file->flags);
+    size = lfs_file_size(&cp23lfs, &(cp23file->system.file));
+    cp23file->size = (size > 0) ? (uint32_t)size : 0u;
+    cp23file->system.commitSize = (flags & LFS_O_TRUNC) ? info.size : cp23file->size;
+    if (flags == LFS_O_RDONLY)
+    {
+        CP23_PinCount(cp23file);                                    /* Automatic pinning of the files often read */
+    }
+    *file = cp23file;
+    CP23_Record(CP23LFS_REC_OPEN, cp23file, CP23_KeyHash((uint8_t const *)(cp23file->system.path), CP23LFS_PATH_MAX), (uint32_t)flags, 0u);
+    CP23_CallEnd("open", start);
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_file_close(cp23lfs_file_t file)
+{
+    assert_param(file);
+
+    cp23lfs_file_t holder = &(cp23lsf_file[file->system.holder]);
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err = 0;
+
+    CP23_Record(CP23LFS_REC_CLOSE, file, 0u, 0u, 0u);
+    if (file->system.pin)
+    {
+        CP23_PinClose(file);                                        /* Pinned open: nothing to commit */
+    }
+    else if (holder != file)
+    {
+        /* Shared open: the held file is closed with its last open */
+        CP23_ReleaseFileStructure(file);
+        holder->system.users--;
+        if ((holder->system.users == 0u) && (holder->system.closed))
+        {
+            err = CP23_FileCommit(holder, true);
+            CP23_ReleaseFileStructure(holder);
+        }
+        else if (holder->system.users == 0u)
+        {
+            err = lfs_file_seek(&cp23lfs, &(holder->system.file), (lfs_soff_t)(holder->system.pos), LFS_SEEK_SET);
+            err = (err < 0) ? err : 0;
+        }
+    }
+    else if (file->system.users > 0u)
+    {
+        file->system.closed = true;                                 /* Kept open for the shared opens */
+    }
+    else
+    {
+        err = CP23_FileCommit(file, true);
+        CP23_ReleaseFileStructure(file);
+    }
+    CP23_CallEnd("close", start);                            /* Memory transactions trace span */
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_file_sync(cp23lfs_file_t file)
+{
+    assert_param(file);
+
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    CP23_Record(CP23LFS_REC_SYNC, file, 0u, 0u, 0u);
+    err = ((file->system.pin == 0u) && (file->system.holder == (uint8_t)(file - cp23lsf_file))) ? 
+          CP23_FileCommit(file, false) : 0;                         /* Shared and pinned opens: nothing to commit */
+
+    CP23_CallEnd("sync", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+lfs_ssize_t cp23lfs_file_read(cp23lfs_file_t file, void *buffer, lfs_size_t size)
+{
+    assert_param(file);
+    assert_param(buffer);
+
+    uint32_t start = IS25LP080D_TraceBegin();
+    bool shared = CP23_FileShared(file);
+    lfs_ssize_t res = 0;
+
+    CP23_Record(CP23LFS_REC_READ, file, 0u, size, 0u);
+    if (file->system.pin)
+    {
+        res = CP23_PinRead(file, buffer, size);                     /* Pinned file: no memory access */
+    }
+    else
+    {
+        if (shared)
+        {
+            res = lfs_file_seek(&cp23lfs, CP23_LfsFile(file), (lfs_soff_t)(file->system.pos), LFS_SEEK_SET);
+        }
+        if (res >= 0)
+        {
+            res = lfs_file_read(&cp23lfs, CP23_LfsFile(file), buffer, size);
+        }
+        if (shared)
+        {
+            file->system.pos = (uint32_t)lfs_file_tell(&cp23lfs, CP23_LfsFile(file));
+        }
+    }
+
+    CP23_CallEnd("read", start);
+    return res;
+}
+
+
+lfs_ssize_t cp23lfs_file_write(cp23lfs_file_t file, const void *buffer, lfs_size_t size)
+{
+    assert_param(file);
+    assert_param(buffer);
+
+    lfs_soff_t pos = (CP23_LfsFile(file)->flags & LFS_O_APPEND) ? (lfs_soff_t)file->size : lfs_file_tell(&cp23lfs, CP23_LfsFile(file));
+    lfs_ssize_t res;
+    lfs_soff_t fileSize;
+    uint32_t start;
+
+    CP23_Record(CP23LFS_REC_WRITE, file, 0u, size, 0u);
+    if (file->system.pin)
+    {
+        return LFS_ERR_BADF;                                        /* Pinned opens are read-only */
+    }
+    start = IS25LP080D_TraceBegin();
+    if ((pos >= 0) && ((lfs_size_t)pos + size > file->size))
+    {
+        /* The file grows: check the owner group quota before writing */
+        res = CP23_QuotaCheck(file, (lfs_size_t)pos + size);
+        if (res)
+        {
+            CP23_CallEnd("write", start);
+            return res;
+        }
+    }
+    res = lfs_file_write(&cp23lfs, CP23_LfsFile(file), buffer, size);
+    cp23lsf_file[file->system.holder].system.written = true;
+    fileSize = lfs_file_size(&cp23lfs, CP23_LfsFile(file));
+    file->size = (fileSize > 0) ? (uint32_t)fileSize : 0u;
+    CP23_CallEnd("write", start);
+    return res;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_file_truncate(cp23lfs_file_t file, lfs_size_t size)
+{
+    assert_param(file);
+
+    lfs_soff_t fileSize;
+    uint32_t start;
+    int err = 0;
+
+    CP23_Record(CP23LFS_REC_TRUNCATE, file, 0u, size, 0u);
+    if (file->system.pin)
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_BADF);                     /* Pinned opens are read-only */
+    }
+    start = IS25LP080D_TraceBegin();
+    if (size > file->size)
+    {
+        err = CP23_QuotaCheck(file, size);
+    }
+    if (err == 0)
+    {
+        err = lfs_file_truncate(&cp23lfs, CP23_LfsFile(file), size);
+        cp23lsf_file[file->system.holder].system.written = true;
+    }
+    fileSize = lfs_file_size(&cp23lfs, CP23_LfsFile(file));
+    file->size = (fileSize > 0) ? (uint32_t)fileSize : 0u;
+    CP23_CallEnd("truncate", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+lfs_soff_t cp23lfs_file_seek(cp23lfs_file_t file, lfs_soff_t off, int whence)
+{
+    assert_param(file);
+
+    lfs_soff_t res = 0;
+    uint32_t start;
+
+    CP23_Record(CP23LFS_REC_SEEK, file, 0u, (uint32_t)off, (uint16_t)whence);
+    if (file->system.pin)
+    {
+        return CP23_PinSeek(file, off, whence);
+    }
+    start = IS25LP080D_TraceBegin();
+    if (!CP23_FileShared(file))
+    {
+        res = lfs_file_seek(&cp23lfs, CP23_LfsFile(file), off, whence);
+        CP23_CallEnd("seek", start);
+        return res;
+    }
+    /* Shared open file: seek from the position of this open */
+    if (whence == LFS_SEEK_CUR)
+    {
+        res = lfs_file_seek(&cp23lfs, CP23_LfsFile(file), (lfs_soff_t)(file->system.pos), LFS_SEEK_SET);
+    }
+    if (res >= 0)
+    {
+        res = lfs_file_seek(&cp23lfs, CP23_LfsFile(file), off, whence);
+    }
+    if (res >= 0)
+    {
+        file->system.pos = (uint32_t)res;
+    }
+    CP23_CallEnd("seek", start);
+    return res;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_mkdir(const char *path)
+{
+    assert_param(path);
+
+    char npath[CP23LFS_PATH_MAX];
+    uint32_t start;
+    int err;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    CP23_Record(CP23LFS_REC_MKDIR, NULL, CP23_KeyHash((uint8_t const *)npath, CP23LFS_PATH_MAX), 0u, 0u);
+    err = CP23_Mkdir(npath);
+    CP23_CallEnd("mkdir", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_remove(const char *path)
+{
+    assert_param(path);
+
+    char npath[CP23LFS_PATH_MAX];
+    uint32_t key[CP23LFS_INDEX_NUM];
+    struct lfs_info info;
+    uint8_t group;
+    uint32_t start;
+    bool changed = false;
+    int err = 0;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    CP23_Record(CP23LFS_REC_REMOVE, NULL, CP23_KeyHash((uint8_t const *)npath, CP23LFS_PATH_MAX), 0u, 0u);
+    group = CP23_QuotaGroup(npath);
+    err = lfs_stat(&cp23lfs, npath, &info);
+    if ((err == 0) && (info.type == LFS_TYPE_REG) && (CP23_IndexValid()))
+    {
+        err = CP23_IndexKeysByPath(npath, key);
+        changed = true;
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    if (err == 0)
+    {
+        err = CP23_Remove(npath);
+    }
+    if (err == 0)
+    {
+        CP23_QuotaRemoved(&info, group);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexApply(key, NULL, npath, NULL);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+    }
+    if ((changed) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    CP23_CallEnd("remove", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_rename(const char *oldpath, const char *newpath)
+{
+    assert_param(oldpath);
+    assert_param(newpath);
+
+    char oldNPath[CP23LFS_PATH_MAX];
+    char newNPath[CP23LFS_PATH_MAX];
+    uint32_t key[CP23LFS_INDEX_NUM];
+    uint32_t replacedKey[CP23LFS_INDEX_NUM];
+    struct lfs_info info;
+    struct lfs_info replacedInfo;
+    uint8_t group = CP23_QUOTA_NONE;
+    uint8_t replacedGroup = CP23_QUOTA_NONE;
+    bool changed = false;
+    bool replaced = false;
+    bool exists;
+    bool found;
+    uint32_t start;
+    int err = 0;
+
+    if ((!CP23_PathNormalize(oldNPath, oldpath)) || (!CP23_PathNormalize(newNPath, newpath)))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    CP23_Record(CP23LFS_REC_RENAME, NULL, CP23_KeyHash((uint8_t const *)oldNPath, CP23LFS_PATH_MAX), 
+                CP23_KeyHash((uint8_t const *)newNPath, CP23LFS_PATH_MAX), 0u);
+    exists = (lfs_stat(&cp23lfs, newNPath, &replacedInfo) == 0);
+    found = (lfs_stat(&cp23lfs, oldNPath, &info) == 0);
+    if (exists)
+    {
+        replacedGroup = CP23_QuotaGroup(newNPath);
+    }
+    if ((found) && (info.type == LFS_TYPE_REG))
+    {
+        group = CP23_QuotaGroup(oldNPath);
+    }
+    if ((CP23_IndexValid()) && (found))
+    {
+        if (info.type == LFS_TYPE_DIR)
+        {
+            /* Every path below the directory changes: leave the indexes to cp23lfs_index_build */
+            err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+            cp23lfs_state.idxState = CP23_IDX_INVALID;
+        }
+        else
+        {
+            err = CP23_IndexKeysByPath(oldNPath, key);
+            if ((err == 0) && (exists))
+            {
+                err = CP23_IndexKeysByPath(newNPath, replacedKey);
+                replaced = true;
+            }
+            changed = true;
+        }
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    if (err == 0)
+    {
+        err = CP23_Rename(oldNPath, newNPath);
+    }
+    if ((err == 0) && (exists) && (strcmp(oldNPath, newNPath) != 0))
+    {
+        CP23_QuotaRemoved(&replacedInfo, replacedGroup);
+    }
+    if ((err == 0) && (strcmp(oldNPath, newNPath) != 0))
+    {
+        CP23_PinDrop(oldNPath);                                     /* Pins of the moved entry (and of the files below it) */
+        CP23_FileOutdate(oldNPath);
+        CP23_FileOutdate(newNPath);                                 /* Replaced entry */
+    }
+    if ((err == 0) && (found) && (info.type == LFS_TYPE_REG))
+    {
+        /* Moving a file in or out of the CP23 system directory changes its charge */
+        CP23_QuotaCharge(group, info.size, false);
+        CP23_QuotaCharge(CP23_QuotaGroup(newNPath), info.size, true);
+        err = CP23_GenBump(newNPath);
+    }
+    if ((replaced) && (err == 0))
+    {
+        err = CP23_IndexApply(replacedKey, NULL, newNPath, NULL);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexApply(key, key, oldNPath, newNPath);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+    }
+    if ((changed) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    CP23_CallEnd("rename", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_setattr(const char *path, uint8_t type, const void *buffer, lfs_size_t size)
+{
+    assert_param(path);
+
+    char npath[CP23LFS_PATH_MAX];
+    uint32_t oldKey[CP23LFS_INDEX_NUM];
+    uint32_t newKey[CP23LFS_INDEX_NUM];
+    struct lfs_info info;
+    uint8_t group = CP23_QUOTA_NONE;
+    uint32_t start;
+    bool changed = false;
+    int err = 0;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    if ((type > CP23LFS_ATTR_GEN) && (size > CP23LFS_CACHE_SIZE))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NOSPC);                    /* Custom attribute larger than the wear leveling copy buffer */
+    }
+    start = IS25LP080D_TraceBegin();
+    if ((type == CP23LFS_ATTR_GROUP) && (lfs_stat(&cp23lfs, npath, &info) == 0) && (info.type == LFS_TYPE_REG))
+    {
+        group = CP23_QuotaGroup(npath);                             /* The file usage moves to the new group */
+    }
+    if (((type == CP23LFS_ATTR_GROUP) || (type == CP23LFS_ATTR_OWNER) || (type == CP23LFS_ATTR_COMPANY)) && 
+        (CP23_IndexValid()) && (lfs_stat(&cp23lfs, npath, &info) == 0) && (info.type == LFS_TYPE_REG))
+    {
+        err = CP23_IndexKeysByPath(npath, oldKey);
+        changed = true;
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    if (err == 0)
+    {
+        err = lfs_setattr(&cp23lfs, npath, type, buffer, size);
+    }
+    if ((err == 0) && (group != CP23_QUOTA_NONE))
+    {
+        CP23_QuotaCharge(group, info.size, false);
+        CP23_QuotaCharge(CP23_QuotaGroup(npath), info.size, true);
+    }
+    if ((err == 0) && ((type == CP23LFS_ATTR_DATE) || (type == CP23LFS_ATTR_TIME) || (type == CP23LFS_ATTR_EPOCH)))
+    {
+        err = CP23_TimeSyncByPath(npath, type);
+    }
+    if ((err == 0) && (type != CP23LFS_ATTR_GEN))
+    {
+        err = CP23_GenBump(npath);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexKeysByPath(npath, newKey);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexApply(oldKey, newKey, npath, npath);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+    }
+    if ((changed) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    CP23_CallEnd("setattr", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_generation(const char *path, uint32_t *generation)
+{
+    assert_param(path);
+    assert_param(generation);
+
+    char npath[CP23LFS_PATH_MAX];
+    lfs_ssize_t res;
+    uint32_t start;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    *generation = 0u;
+    res = lfs_getattr(&cp23lfs, npath, CP23LFS_ATTR_GEN, generation, sizeof(*generation));
+    CP23_CallEnd("generation", start);
+    return CP23LFS_ERRORCODE(((res < 0) && (res != LFS_ERR_NOATTR)) ? res : 0);
+}
+
+
+void cp23lfs_set_clock(cp23lfs_clock_t clock)
+{
+    cp23lfs_state.clock = clock;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_list_bytime(const char *dirPath, uint32_t from, uint32_t to, uint8_t order, 
+                                        cp23lfs_timeEntry_t entries[], uint32_t maxEntries, uint32_t *count)
+{
+    assert_param(dirPath);
+    assert_param((entries) || (maxEntries == 0u));
+    assert_param(count);
+
+    char path[CP23LFS_PATH_MAX];
+    uint8_t date[CP23LFS_DATE_LEN];
+    uint8_t time[CP23LFS_TIME_LEN];
+    lfs_dir_t dir;
+    struct lfs_info info;
+    uint32_t len;
+    uint32_t epoch;
+    uint32_t pos;
+    uint32_t start;
+    lfs_ssize_t res;
+    bool opened;
+    int err;
+
+    *count = 0u;
+    if (!CP23_PathNormalize(path, dirPath))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    len = strlen(path);
+    err = CP23_DirOpen(&dir, path);
+    opened = (err == 0);
+    while ((err == 0) && ((res = lfs_dir_read(&cp23lfs, &dir, &info)) != 0))
+    {
+        if (res < 0)
+        {
+            err = (int)res;
+            break;
+        }
+        if ((info.type != LFS_TYPE_REG) || (!CP23_PathAppend(path, info.name)))
+        {
+            continue;
+        }
+        epoch = 0u;
+        res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_EPOCH, &epoch, sizeof(epoch));
+        if (res == LFS_ERR_NOATTR)
+        {
+            /* File written before the EPOCH attribute: parse the string forms */
+            memset(date, 0, sizeof(date));
+            memset(time, 0, sizeof(time));
+            (void)lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_DATE, date, sizeof(date));
+            (void)lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_TIME, time, sizeof(time));
+            epoch = CP23_TimeToEpoch(date, time);
+            res = 0;
+        }
+        path[len] = '\0';
+        if (res < 0)
+        {
+            err = (int)res;
+            break;
+        }
+        if ((epoch < from) || (epoch > to))
+        {
+            continue;
+        }
+        /* Insertion into the sorted entries, the last one drops out when full */
+        for (pos = *count ; pos > 0u ; pos--)
+        {
+            if ((order == CP23LFS_ORDER_NEWEST) ? (entries[pos - 1u].epoch >= epoch) : (entries[pos - 1u].epoch <= epoch))
+            {
+                break;
+            }
+        }
+        if (pos >= maxEntries)
+        {
+            continue;
+        }
+        if (*count < maxEntries)
+        {
+            (*count)++;
+        }
+        memmove(&entries[pos + 1u], &entries[pos], (*count - pos - 1u) * sizeof(entries[0]));
+        memcpy(entries[pos].name, info.name, sizeof(entries[pos].name));
+        entries[pos].epoch = epoch;
+        entries[pos].size = info.size;
+    }
+    if ((opened) && (err == 0))
+    {
+        err = CP23_DirClose(&dir);
+    }
+    else if (opened)
+    {
+        (void)CP23_DirClose(&dir);
+    }
+    CP23_CallEnd("list bytime", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_log_open(cp23lfs_log_t *log, const char *path, uint32_t interval)
+{
+    assert_param(log);
+    assert_param(interval);
+
+    cp23lfs_errorcode_t retVal;
+    lfs_ssize_t res;
+    uint32_t start;
+
+    memset(log, 0, sizeof(cp23lfs_log_t));
+    retVal = cp23lfs_file_opencfg(&(log->file), path, LFS_O_RDWR | LFS_O_CREAT | LFS_O_APPEND);
+    if (retVal != CP23LFS_OK)
+    {
+        return retVal;
+    }
+    start = IS25LP080D_TraceBegin();
+    res = lfs_getattr(&cp23lfs, log->file->system.path, CP23LFS_ATTR_TINDEX, log->entry, sizeof(log->entry));
+    CP23_CallEnd("log open", start);
+    if ((res < 0) && (res != LFS_ERR_NOATTR))
+    {
+        (void)cp23lfs_file_close(log->file);
+        return CP23LFS_ERRORCODE(res);
+    }
+    /* Commit the time index with the file attributes */
+    memcpy(log->attrs, log->file->system.descr, sizeof(log->file->system.descr));
+    log->attrs[CP23LFS_LOG_TINDEX].type = CP23LFS_ATTR_TINDEX;
+    log->attrs[CP23LFS_LOG_TINDEX].buffer = log->entry;
+    log->attrs[CP23LFS_LOG_TINDEX].size = (res > 0) ? ((lfs_size_t)res / sizeof(cp23lfs_tindexEntry_t)) * sizeof(cp23lfs_tindexEntry_t) : 0u;
+    log->file->system.fileCfg.attrs = log->attrs;
+    log->file->system.fileCfg.attr_count = CP23LFS_LOG_TINDEX + 1u;
+    log->interval = interval;
+    log->count = 0u;
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_log_write(cp23lfs_log_t *log, uint32_t timestamp, const void *record, lfs_size_t size)
+{
+    assert_param(log);
+    assert_param(log->file);
+
+    uint32_t num = log->attrs[CP23LFS_LOG_TINDEX].size / sizeof(cp23lfs_tindexEntry_t);
+    uint32_t cnt;
+    lfs_ssize_t res;
+
+    if (log->count == 0u)
+    {
+        if (num == CP23LFS_TINDEX_MAX)
+        {
+            /* Index full: keep every other entry and double the interval */
+            for (cnt = 1u ; cnt < (CP23LFS_TINDEX_MAX / 2u) ; cnt++)
+            {
+                log->entry[cnt] = log->entry[cnt * 2u];
+            }
+            num = CP23LFS_TINDEX_MAX / 2u;
+            log->interval *= 2u;
+        }
+        log->entry[num].timestamp = timestamp;
+        log->entry[num].offset = log->file->size;
+        log->attrs[CP23LFS_LOG_TINDEX].size = (num + 1u) * sizeof(cp23lfs_tindexEntry_t);
+        log->count = log->interval;
+    }
+    res = cp23lfs_file_write(log->file, record, size);
+    if (res < 0)
+    {
+        return CP23LFS_ERRORCODE(res);
+    }
+    log->count--;
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_log_close(cp23lfs_log_t *log)
+{
+    assert_param(log);
+    assert_param(log->file);
+
+    cp23lfs_errorcode_t retVal = cp23lfs_file_close(log->file);
+
+    log->file = NULL;
+    return retVal;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_log_range(const char *path, uint32_t from, uint32_t to, lfs_off_t *start, lfs_off_t *end)
+{
+    assert_param(path);
+    assert_param(start);
+    assert_param(end);
+
+    char npath[CP23LFS_PATH_MAX];
+    cp23lfs_tindexEntry_t entry[CP23LFS_TINDEX_MAX];
+    struct lfs_info info;
+    uint32_t num;
+    uint32_t pos;
+    uint32_t span;
+    lfs_ssize_t res = 0;
+    int err;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    span = IS25LP080D_TraceBegin();
+    err = lfs_stat(&cp23lfs, npath, &info);
+    if (err == 0)
+    {
+        res = lfs_getattr(&cp23lfs, npath, CP23LFS_ATTR_TINDEX, entry, sizeof(entry));
+    }
+    CP23_CallEnd("log range", span);
+    if (err)
+    {
+        return CP23LFS_ERRORCODE(err);
+    }
+    *start = 0u;
+    *end = info.size;
+    if (res == LFS_ERR_NOATTR)
+    {
+        return CP23LFS_OK;                                          /* Not indexed: whole file */
+    }
+    if (res < 0)
+    {
+        return CP23LFS_ERRORCODE(res);
+    }
+    num = (uint32_t)res / sizeof(cp23lfs_tindexEntry_t);
+    /* Start at the last entry before from, end at the first entry after to */
+    pos = (from > 0u) ? CP23_TimeIndexFind(entry, num, from - 1u) : 0u;
+    if (pos > 0u)
+    {
+        *start = entry[pos - 1u].offset;
+    }
+    pos = CP23_TimeIndexFind(entry, num, to);
+    if (pos < num)
+    {
+        *end = entry[pos].offset;
+    }
+    *start = (*start < info.size) ? *start : info.size;
+    *end = (*end < info.size) ? *end : info.size;
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_map_open(cp23lfs_map_t *map, const char *path, int flags, uint8_t *pages, uint32_t pageNum,
+                                     lfs_size_t maxSize)
+{
+    assert_param(map);
+    assert_param(path);
+    assert_param(pages);
+    assert_param((pageNum > 0u) && (pageNum <= CP23LFS_MAP_PAGES_MAX));
+
+    cp23lfs_errorcode_t retVal;
+
+    memset(map, 0, sizeof(cp23lfs_map_t));
+    if ((((flags & LFS_O_RDWR) != LFS_O_RDONLY) && ((flags & LFS_O_RDWR) != LFS_O_RDWR)) || (flags & LFS_O_APPEND))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_INVAL);                    /* Pages are read before being changed */
+    }
+    retVal = cp23lfs_file_opencfg(&(map->file), path, flags);
+    if (retVal != CP23LFS_OK)
+    {
+        return retVal;
+    }
+    map->pages = pages;
+    map->pageNum = pageNum;
+    map->writable = ((flags & LFS_O_RDWR) == LFS_O_RDWR);
+    map->end = map->file->size;
+    map->size = ((map->writable) && (maxSize > map->end)) ? maxSize : map->end;
+    if ((map->writable) && (map->size == 0u))
+    {
+        (void)cp23lfs_file_close(map->file);                        /* Nothing to map */
+        map->file = NULL;
+        return CP23LFS_ERRORCODE(LFS_ERR_INVAL);
+    }
+    return CP23LFS_OK;
+}
+
+
+void *cp23lfs_map_get(cp23lfs_map_t *map, lfs_off_t off, lfs_size_t size, bool write)
+{
+    assert_param(map);
+    assert_param(map->file);
+
+    uint32_t base = off - (off % CP23LFS_MAP_PAGE);
+    uint32_t idx = map->last;
+    lfs_ssize_t res;
+    uint32_t cnt;
+
+    if ((size == 0u) || (off >= map->size) || (size > (map->size - off)) || (((off % CP23LFS_MAP_PAGE) + size) > CP23LFS_MAP_PAGE) || 
+        ((write) && (!map->writable)))
+    {
+        return NULL;
+    }
+    if ((!map->page[idx].valid) || (map->page[idx].off != base))
+    {
+        for (cnt = 0, idx = map->pageNum ; (cnt < map->pageNum) && (idx == map->pageNum) ; cnt++)
+        {
+            if ((map->page[cnt].valid) && (map->page[cnt].off == base))
+            {
+                idx = cnt;
+            }
+        }
+    }
+    if (idx < map->pageNum)
+    {
+        map->hits++;
+    }
+    else
+    {
+        /* Miss: replace a free page, or the least recently used one */
+        for (cnt = 0, idx = 0u ; cnt < map->pageNum ; cnt++)
+        {
+            if ((!map->page[cnt].valid) || ((map->page[idx].valid) && (map->page[cnt].use < map->page[idx].use)))
+            {
+                idx = cnt;
+            }
+            if (!map->page[idx].valid)
+            {
+                break;
+            }
+        }
+        if ((map->page[idx].dirty) && (CP23_MapWrite(map, idx) != 0))
+        {
+            return NULL;
+        }
+        map->misses++;
+        map->page[idx].valid = false;
+        res = cp23lfs_file_seek(map->file, (lfs_soff_t)base, LFS_SEEK_SET);
+        if (res >= 0)
+        {
+            res = cp23lfs_file_read(map->file, &(map->pages[idx * CP23LFS_MAP_PAGE]), CP23LFS_MAP_PAGE);
+        }
+        if (res < 0)
+        {
+            return NULL;
+        }
+        memset(&(map->pages[(idx * CP23LFS_MAP_PAGE) + (uint32_t)res]), 0, CP23LFS_MAP_PAGE - (uint32_t)res);
+        map->page[idx].off = base;
+        map->page[idx].valid = true;
+    }
+    map->page[idx].use = ++(map->tick);
+    map->page[idx].dirty |= write;
+    if ((write) && ((off + size) > map->end))
+    {
+        map->end = off + size;                                      /* File grown at the write back */
+    }
+    map->last = idx;
+    return &(map->pages[(idx * CP23LFS_MAP_PAGE) + (off - base)]);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_map_flush(cp23lfs_map_t *map)
+{
+    assert_param(map);
+    assert_param(map->file);
+
+    uint32_t cnt;
+    int err = 0;
+
+    for (cnt = 0 ; (cnt < map->pageNum) && (err == 0) ; cnt++)
+    {
+        if (map->page[cnt].dirty)
+        {
+            err = CP23_MapWrite(map, cnt);
+        }
+    }
+    return (err) ? CP23LFS_ERRORCODE(err) : cp23lfs_file_sync(map->file);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_map_close(cp23lfs_map_t *map)
+{
+    assert_param(map);
+    assert_param(map->file);
+
+    cp23lfs_errorcode_t retVal = CP23LFS_OK;
+    cp23lfs_errorcode_t res;
+    uint32_t cnt;
+    int err;
+
+    for (cnt = 0 ; cnt < map->pageNum ; cnt++)
+    {
+        err = (map->page[cnt].dirty) ? CP23_MapWrite(map, cnt) : 0;
+        if ((err) && (retVal == CP23LFS_OK))
+        {
+            retVal = CP23LFS_ERRORCODE(err);
+        }
+    }
+    res = cp23lfs_file_close(map->file);
+    map->file = NULL;
+    return (retVal != CP23LFS_OK) ? retVal : res;
+}
+
+
+void cp23lfs_pin_config(uint8_t *buffer, uint32_t size, const cp23lfs_pinPolicy_t *policy)
+{
+    assert_param(policy);
+    assert_param((buffer != NULL) || (size == 0u));
+
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_PINS_MAX ; cnt++)
+    {
+        assert_param(cp23lfs_state.pinned[cnt].users == 0u);
+    }
+    memset(cp23lfs_state.pinned, 0, sizeof(cp23lfs_state.pinned));
+    memset(cp23lfs_state.pinCand, 0, sizeof(cp23lfs_state.pinCand));
+    memset(&cp23lfs_state.pinStats, 0, sizeof(cp23lfs_state.pinStats));
+    cp23lfs_state.pinBuffer = buffer;
+    cp23lfs_state.pinStats.budget = (buffer) ? size : 0u;
+    cp23lfs_state.pinPolicy = *policy;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_pin(const char *path)
+{
+    assert_param(path);
+
+    char npath[CP23LFS_PATH_MAX];
+    uint32_t start;
+    int err;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    err = CP23_PinAdd(npath);
+    CP23_CallEnd("pin", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_unpin(const char *path)
+{
+    assert_param(path);
+
+    char npath[CP23LFS_PATH_MAX];
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    if (CP23_PinFind(npath) == CP23_PIN_NONE)
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NOENT);
+    }
+    CP23_PinDrop(npath);
+    return CP23LFS_OK;
+}
+
+
+void cp23lfs_pin_stats(cp23lfs_pinStats_t *stats, bool reset)
+{
+    assert_param(stats);
+
+    *stats = cp23lfs_state.pinStats;
+    if (reset)
+    {
+        cp23lfs_state.pinStats.hits = 0u;
+        cp23lfs_state.pinStats.loads = 0u;
+    }
+}
+
+
+cp23lfs_errorcode_t cp23lfs_remove_recursive_start(cp23lfs_rmtree_t *ctx, const char *path)
+{
+    assert_param(ctx);
+    assert_param(path);
+
+    uint32_t start;
+    int err = 0;
+
+    /* Store the normalized root ("/" becomes "", the root directory): pinned contents and index records
+       of the tree are matched on it */
+    if (!CP23_PathNormalize(ctx->path, path))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    ctx->rootLen = strlen(ctx->path);
+    ctx->removed = 0u;
+    ctx->done = false;
+    ctx->purgeIndex = false;
+    start = IS25LP080D_TraceBegin();
+    if ((CP23_IndexValid()) && (strncmp(ctx->path, CP23LFS_SYS_DIR, sizeof(CP23LFS_SYS_DIR) - 1u) != 0))
+    {
+        /* The index records of the tree are purged once at completion */
+        ctx->purgeIndex = true;
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    CP23_CallEnd("rmtree start", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_remove_recursive_step(cp23lfs_rmtree_t *ctx, uint32_t budget)
+{
+    assert_param(ctx);
+
+    lfs_dir_t dir;
+    struct lfs_info info;
+    struct lfs_info entry[CP23LFS_REMOVE_BATCH];
+    uint8_t group[CP23LFS_REMOVE_BATCH];
+    uint32_t len;
+    uint32_t num;
+    uint32_t done;
+    bool descend;
+    bool paused = false;
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err = 0;
+    int res = 0;
+
+    while ((ctx->done == false) && (err == 0) && (paused == false))
+    {
+        err = CP23_DirOpen(&dir, ctx->path);
+        if (err == LFS_ERR_NOTDIR)
+        {
+            /* The tree root is a plain file */
+            group[0] = CP23_QuotaGroup(ctx->path);
+            err = lfs_stat(&cp23lfs, ctx->path, &info);
+            if (err == 0)
+            {
+                err = CP23_Remove(ctx->path);
+            }
+            if (err == 0)
+            {
+                CP23_QuotaRemoved(&info, group[0]);
+                ctx->removed++;
+                ctx->done = true;
+            }
+            break;
+        }
+        if (err)
+        {
+            break;
+        }
+        len = strlen(ctx->path);
+        descend = false;
+        /* Remove the files of the current directory by batches (several per metadata commit), stop at the
+           first sub-directory. Entries following the removed ones are kept in order by the open directory
+           (LFS mlist) */
+        do
+        {
+            num = 0u;
+            while ((num < CP23LFS_REMOVE_BATCH) && ((budget == 0u) || (num < budget)) && 
+                   ((res = lfs_dir_read(&cp23lfs, &dir, &(entry[num]))) > 0))
+            {
+                if ((strcmp(entry[num].name, ".") == 0) || (strcmp(entry[num].name, "..") == 0))
+                {
+                    continue;
+                }
+                if (!CP23_PathAppend(ctx->path, entry[num].name))
+                {
+                    res = LFS_ERR_NAMETOOLONG;
+                    break;
+                }
+                if (entry[num].type == LFS_TYPE_DIR)
+                {
+                    descend = (strcmp(ctx->path, CP23LFS_SYS_DIR) != 0);    /* The CP23 system directory is kept */
+                }
+                else
+                {
+                    group[num++] = CP23_QuotaGroup(ctx->path);
+                }
+                ctx->path[len] = '\0';
+                if (descend)
+                {
+                    break;                                          /* Into the sub-directory, after the files gathered */
+                }
+            }
+            if ((res >= 0) && (num > 0u))
+            {
+                err = CP23_RemoveFiles(ctx->path, entry, group, num, &done);
+                ctx->removed += done;
+                if (budget)
+                {
+                    budget -= done;
+                    paused = (budget == 0u);
+                }
+            }
+        } while ((err == 0) && (res > 0) && (!descend) && (!paused));
+        if ((descend) && (err == 0))
+        {
+            (void)CP23_PathAppend(ctx->path, entry[num].name);      /* Fits, checked while reading */
+        }
+        if (res < 0)
+        {
+            err = res;
+        }
+        res = (err == 0) ? res : 1;
+        if (err == 0)
+        {
+            err = CP23_DirClose(&dir);
+        }
+        else
+        {
+            (void)CP23_DirClose(&dir);
+        }
+        if ((res == 0) && (err == 0))
+        {
+            /* Current directory is empty: remove it and go back to the parent */
+            if (len == ctx->rootLen)
+            {
+                if (len > 0u)
+                {
+                    err = CP23_Remove(ctx->path);
+                    if (err == 0)
+                    {
+                        ctx->removed++;
+                    }
+                }
+                if ((ctx->purgeIndex) && (err == 0))
+                {
+                    err = CP23_IndexPurge(CP23_PurgeTree, ctx->path);
+                    if (err == 0)
+                    {
+                        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+                    }
+                }
+                ctx->done = (err == 0);
+            }
+            else
+            {
+                err = CP23_Remove(ctx->path);
+                if (err == 0)
+                {
+                    ctx->removed++;
+                    CP23_PathParent(ctx->path);
+                    paused = ((budget) && (--budget == 0u));
+                }
+            }
+        }
+    }
+    if ((ctx->purgeIndex) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    CP23_CallEnd("rmtree", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_remove_recursive(const char *path)
+{
+    cp23lfs_rmtree_t ctx;
+    cp23lfs_errorcode_t retVal;
+
+    retVal = cp23lfs_remove_recursive_start(&ctx, path);
+    if (retVal == CP23LFS_OK)
+    {
+        retVal = cp23lfs_remove_recursive_step(&ctx, 0u);
+    }
+    return retVal;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_remove_multi(const char *dirPath, const char * const names[], uint32_t count, uint32_t *removed)
+{
+    assert_param(dirPath);
+    assert_param(names);
+
+    char path[CP23LFS_PATH_MAX];
+    struct lfs_info info;
+    struct lfs_info entry[CP23LFS_REMOVE_BATCH];
+    uint8_t group[CP23LFS_REMOVE_BATCH];
+    uint8_t infoGroup = CP23_QUOTA_NONE;
+    uint32_t len;
+    uint32_t cnt;
+    uint32_t num = 0u;
+    uint32_t done = 0u;
+    uint32_t files;
+    uint32_t start;
+    bool purgeIndex;
+    CP23_PurgeNames_t purge = {path, names, 0u};
+    int err = 0;
+
+    /* Normalized parent: pinned contents and index records are matched on it */
+    if (!CP23_PathNormalize(path, dirPath))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    purgeIndex = CP23_IndexValid();
+    len = strlen(path);
+    if (purgeIndex)
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+        count = (err == 0) ? count : 0u;
+    }
+    /* Files are gathered by batches and removed several per metadata commit, directories one by one */
+    for (cnt = 0 ; (cnt < count) && (err == 0) ; cnt++)
+    {
+        if (!CP23_PathAppend(path, names[cnt]))
+        {
+            err = LFS_ERR_NAMETOOLONG;
+            break;
+        }
+        err = lfs_stat(&cp23lfs, path, &info);
+        if (err == 0)
+        {
+            infoGroup = CP23_QuotaGroup(path);
+        }
+        path[len] = '\0';
+        if (err == LFS_ERR_NOENT)
+        {
+            err = 0;                                                /* Already removed */
+            continue;
+        }
+        if (err)
+        {
+            break;
+        }
+        if (info.type != LFS_TYPE_DIR)
+        {
+            entry[num] = info;
+            group[num++] = infoGroup;
+        }
+        if ((num > 0u) && ((num == CP23LFS_REMOVE_BATCH) || (info.type == LFS_TYPE_DIR)))
+        {
+            err = CP23_RemoveFiles(path, entry, group, num, &files);
+            done += files;
+            num = 0u;
+        }
+        if ((info.type == LFS_TYPE_DIR) && (err == 0))
+        {
+            (void)CP23_PathAppend(path, names[cnt]);
+            err = CP23_Remove(path);
+            path[len] = '\0';
+            if (err == 0)
+            {
+                CP23_QuotaRemoved(&info, infoGroup);
+                done++;
+            }
+        }
+    }
+    if ((num > 0u) && (err == 0))
+    {
+        err = CP23_RemoveFiles(path, entry, group, num, &files);
+        done += files;
+    }
+    if ((purgeIndex) && (err == 0))
+    {
+        /* Purge the index records of the listed entries in one pass */
+        purge.count = count;
+        err = CP23_IndexPurge(CP23_PurgeNames, &purge);
+        if (err == 0)
+        {
+            err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+        }
+    }
+    if ((purgeIndex) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    if (removed)
+    {
+        *removed = done;
+    }
+    CP23_CallEnd("remove multi", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_query(const char *root, const cp23lfs_qcond_t cond[], uint32_t condNum, cp23lfs_query_cb_t cb, void *data)
+{
+    assert_param(root);
+    assert_param(cb);
+    assert_param((cond) || (condNum == 0u));
+
+    CP23_Query_t query = {cond, condNum, cb, data};
+    char rootPath[CP23LFS_PATH_MAX];
+    char rec[CP23LFS_PATH_MAX];
+    char name[CP23LFS_INDEX_NAME_LEN];
+    uint32_t rootLen;
+    uint32_t fieldLen;
+    uint32_t idx = CP23LFS_INDEX_NUM;
+    uint32_t key = 0u;
+    uint32_t cnt;
+    uint32_t start;
+    lfs_ssize_t res;
+    int err = 0;
+
+    if (!CP23_PathNormalize(rootPath, root))
+    {
+        return CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG);
+    }
+    start = IS25LP080D_TraceBegin();
+    /* Look for a condition served by a secondary index */
+    for (cnt = 0 ; (cnt < condNum) && (CP23_IndexValid()) ; cnt++)
+    {
+        if ((cond[cnt].op == CP23LFS_QOP_EQ) && (cond[cnt].size > 0u))
+        {
+            if (cond[cnt].attr == CP23LFS_ATTR_GROUP)
+            {
+                idx = CP23LFS_INDEX_GROUP;
+                key = LfsOwnerGroup(*(uint8_t const *)(cond[cnt].value));
+            }
+            else if ((cond[cnt].attr == CP23LFS_ATTR_OWNER) || (cond[cnt].attr == CP23LFS_ATTR_COMPANY))
+            {
+                /* Whole names only (terminator within size, or the whole field): a prefix has no bucket */
+                fieldLen = (cond[cnt].attr == CP23LFS_ATTR_OWNER) ? CP23LFS_OWNER_LEN : CP23LFS_COMPANY_LEN;
+                if ((memchr(cond[cnt].value, '\0', cond[cnt].size) != NULL) || (cond[cnt].size >= fieldLen))
+                {
+                    idx = (cond[cnt].attr == CP23LFS_ATTR_OWNER) ? CP23LFS_INDEX_OWNER : CP23LFS_INDEX_COMPANY;
+                    key = CP23_KeyHash((uint8_t const *)(cond[cnt].value), (cond[cnt].size < fieldLen) ? cond[cnt].size : fieldLen);
+                }
+            }
+            if (idx < CP23LFS_INDEX_NUM)
+            {
+                break;
+            }
+        }
+    }
+    if (idx == CP23LFS_INDEX_NUM)
+    {
+        err = CP23_TreeWalk(rootPath, CP23_QueryWalkCb, &query);
+        CP23_CallEnd("query", start);
+        return CP23LFS_ERRORCODE(err);
+    }
+    /* Check only the files of the index bucket */
+    CP23_IndexBucket(name, idx, key);
+    err = CP23_SysOpen(name, LFS_O_RDONLY, &cp23lfs_idxCfg);
+    if (err)
+    {
+        CP23_CallEnd("query", start);
+        return (err == LFS_ERR_NOENT) ? CP23LFS_OK : CP23LFS_ERRORCODE(err);
+    }
+    rootLen = strlen(rootPath);
+    while ((res = lfs_file_read(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec))) == (lfs_ssize_t)sizeof(rec))
+    {
+        if ((strncmp(rec, rootPath, rootLen) != 0) || ((rec[rootLen] != '/') && (rec[rootLen] != '\0')))
+        {
+            continue;
+        }
+        err = CP23_QueryWalkCb(&query, rec, NULL);
+        if (err)
+        {
+            break;
+        }
+    }
+    if ((res < 0) && (err == 0))
+    {
+        err = (int)res;
+    }
+    res = CP23_SysClose();
+    if (err == 0)
+    {
+        err = (int)res;
+    }
+    CP23_CallEnd("query", start);
+    return CP23LFS_ERRORCODE((err > 0) ? 0 : err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_index_build(void)
+{
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    err = CP23_Mkdir(CP23LFS_SYS_DIR);
+    if ((err == 0) || (err == LFS_ERR_EXIST))
+    {
+        err = CP23_Mkdir(CP23LFS_INDEX_DIR);
+    }
+    if ((err == 0) || (err == LFS_ERR_EXIST))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    cp23lfs_state.idxState = CP23_IDX_INVALID;                      /* No maintenance while building */
+    if (err == 0)
+    {
+        err = CP23_IndexPurge(CP23_PurgeAll, NULL);
+    }
+    if (err == 0)
+    {
+        err = CP23_TreeWalk("", CP23_IndexBuildCb, NULL);
+    }
+    if (err == 0)
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+    }
+    CP23_CallEnd("index build", start);
+    return CP23LFS_ERRORCODE(err);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_index_drop(void)
+{
+    cp23lfs_rmtree_t ctx;
+    uint32_t start = IS25LP080D_TraceBegin();
+    int err;
+
+    err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    cp23lfs_state.idxState = CP23_IDX_INVALID;
+    CP23_CallEnd("index drop", start);
+    if (err == LFS_ERR_NOENT)
+    {
+        return CP23LFS_OK;                                          /* Indexes never built */
+    }
+    if (err)
+    {
+        return CP23LFS_ERRORCODE(err);
+    }
+    (void)cp23lfs_remove_recursive_start(&ctx, CP23LFS_INDEX_DIR);
+    return cp23lfs_remove_recursive_step(&ctx, 0u);
+}
+
+
+void cp23lfs_rec_start(cp23lfs_rec_t *buffer, uint32_t num, cp23lfs_recClock_t clock)
+{
+    assert_param((buffer) || (num == 0u));
+
+    cp23lfs_state.rec = buffer;
+    cp23lfs_state.recNum = num;
+    cp23lfs_state.recCount = 0u;
+    cp23lfs_state.recLost = 0u;
+    cp23lfs_state.recClock = clock;
+}
+
+
+uint32_t cp23lfs_rec_stop(uint32_t *lost)
+{
+    cp23lfs_state.rec = NULL;
+    if (lost)
+    {
+        *lost = cp23lfs_state.recLost;
+    }
+    return cp23lfs_state.recCount;
+}
+
+
+uint32_t cp23lfs_rec_hash(const char *path)
+{
+    assert_param(path);
+
+    return CP23_KeyHash((uint8_t const *)path, CP23LFS_PATH_MAX);
+}
+
+
+cp23lfs_errorcode_t cp23lfs_replay(const cp23lfs_rec_t rec[], uint32_t num, cp23lfs_replayPath_t resolve, 
+                                   void *buffer, lfs_size_t size, uint32_t *failed)
+{
+    assert_param(rec);
+    assert_param(buffer);
+    assert_param(size);
+    assert_param(failed);
+
+    cp23lfs_file_t slot[CP23LFS_FILES_MAX] = {NULL};                /* Replay files of the recorded slots */
+    char path[CP23LFS_PATH_MAX];
+    char newPath[CP23LFS_PATH_MAX];
+    cp23lfs_file_t file;
+    lfs_size_t left;
+    lfs_ssize_t res;
+    uint32_t cnt;
+    int err;
+
+    *failed = 0u;
+    for (cnt = 0 ; cnt < num ; cnt++)
+    {
+        if (rec[cnt].slot >= CP23LFS_FILES_MAX)
+        {
+            return CP23LFS_ERRORCODE(LFS_ERR_INVAL);
+        }
+        file = slot[rec[cnt].slot];
+        err = 0;
+        if ((file == NULL) && (rec[cnt].call >= CP23LFS_REC_CLOSE) && (rec[cnt].call <= CP23LFS_REC_TRUNCATE))
+        {
+            err = LFS_ERR_BADF;                                     /* File open failed in the replay */
+        }
+        else
+        {
+            switch (rec[cnt].call)
+            {
+                case CP23LFS_REC_OPEN:
+                    CP23_ReplayPath(resolve, rec[cnt].hash, path);
+                    err = (slot[rec[cnt].slot]) ? LFS_ERR_INVAL : (cp23lfs_file_opencfg(&(slot[rec[cnt].slot]), path, (int)(rec[cnt].arg)) != CP23LFS_OK);
+                    break;
+                case CP23LFS_REC_CLOSE:
+                    err = (cp23lfs_file_close(file) != CP23LFS_OK);
+                    slot[rec[cnt].slot] = NULL;
+                    break;
+                case CP23LFS_REC_SYNC:
+                    err = (cp23lfs_file_sync(file) != CP23LFS_OK);
+                    break;
+                case CP23LFS_REC_READ:
+                case CP23LFS_REC_WRITE:
+                    /* Chunks of the buffer size */
+                    for (left = rec[cnt].arg ; (left > 0u) && (err == 0) ; left -= (lfs_size_t)res)
+                    {
+                        res = (rec[cnt].call == CP23LFS_REC_READ) ? cp23lfs_file_read(file, buffer, (left < size) ? left : size) : 
+                                                                   cp23lfs_file_write(file, buffer, (left < size) ? left : size);
+                        err = (res <= 0);
+                        res = (res < 0) ? 0 : res;
+                    }
+                    break;
+                case CP23LFS_REC_SEEK:
+                    err = (cp23lfs_file_seek(file, (lfs_soff_t)(rec[cnt].arg), rec[cnt].whence) < 0);
+                    break;
+                case CP23LFS_REC_TRUNCATE:
+                    err = (cp23lfs_file_truncate(file, rec[cnt].arg) != CP23LFS_OK);
+                    break;
+                case CP23LFS_REC_REMOVE:
+                    CP23_ReplayPath(resolve, rec[cnt].hash, path);
+                    err = (cp23lfs_remove(path) != CP23LFS_OK);
+                    break;
+                case CP23LFS_REC_RENAME:
+                    CP23_ReplayPath(resolve, rec[cnt].hash, path);
+                    CP23_ReplayPath(resolve, rec[cnt].arg, newPath);
+                    err = (cp23lfs_rename(path, newPath) != CP23LFS_OK);
+                    break;
+                case CP23LFS_REC_MKDIR:
+                    CP23_ReplayPath(resolve, rec[cnt].hash, path);
+                    err = (cp23lfs_mkdir(path) != CP23LFS_OK);
+                    break;
+                default:
+                    return CP23LFS_ERRORCODE(LFS_ERR_INVAL);
+            }
+        }
+        *failed += (err) ? 1u : 0u;
+    }
+    /* Files left open by the workload */
+    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
+    {
+        if (slot[cnt])
+        {
+            (void)cp23lfs_file_close(slot[cnt]);
+        }
+    }
+    return CP23LFS_OK;
+}
+
+
+cp23lfs_errorcode_t cp23lfs_perf_run(const cp23lfs_rec_t rec[], uint32_t num, cp23lfs_replayPath_t resolve, 
+                                     void *buffer, lfs_size_t size, cp23lfs_perf_t *perf)
+{
+    assert_param(perf);
+
+    IS25LP080D_energy_t energy;
+    cp23lfs_mem_t mem;
+    cp23lfs_errorcode_t retVal;
+    uint32_t failed = 0u;
+    int err;
+
+    /* Erases left deferred by the previous calls are not charged to the workload */
+    err = IS25LP080D_EraseFlush();
+    IS25LP080D_GetEnergy(&energy, true);
+    retVal = (err == 0) ? cp23lfs_replay(rec, num, resolve, buffer, size, &failed) : CP23LFS_ERRORCODE(err);
+    if (retVal == CP23LFS_OK)
+    {
+        retVal = CP23LFS_ERRORCODE(IS25LP080D_EraseFlush());
+    }
+    IS25LP080D_GetEnergy(&energy, true);
+    cp23lfs_mem_stats(&mem, false);
+    perf->metric[CP23LFS_PERF_TIME] = energy.timeUs;
+    perf->metric[CP23LFS_PERF_BUS] = energy.busBytes;
+    perf->metric[CP23LFS_PERF_PROG] = energy.programs;
+    perf->metric[CP23LFS_PERF_ERASE] = energy.erases[0] + (energy.erases[1] * (32768u / CP23LFS_BLOCK_SIZE)) + 
+                                       (energy.erases[2] * (65536u / CP23LFS_BLOCK_SIZE));
+    perf->metric[CP23LFS_PERF_RAM] = mem.total;
+    perf->metric[CP23LFS_PERF_FAILED] = failed;
+    return retVal;
+}
+
+
+uint32_t cp23lfs_perf_check(const cp23lfs_perf_t *base, const cp23lfs_perf_t *perf, uint32_t threshold)
+{
+    assert_param(base);
+    assert_param(perf);
+
+    static char const * const name[CP23LFS_PERF_NUM] = {"time", "bus bytes", "programs", "erases", "RAM", "failed calls"};
+    uint32_t retVal = 0u;
+    uint64_t limit;
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_PERF_NUM ; cnt++)
+    {
+        limit = (uint64_t)base->metric[cnt] + (((uint64_t)base->metric[cnt] * threshold) / 100u);
+        if (perf->metric[cnt] > limit)
+        {
+            retVal |= (1u << cnt);
+            LFS_WARN("cp23 perf %s %"PRIu32" -> %"PRIu32" (+%"PRIu32")", name[cnt], base->metric[cnt], perf->metric[cnt], 
+                     perf->metric[cnt] - base->metric[cnt]);
+        }
+    }
+    return retVal;
+}
+
+
+#ifdef CP23LFS_STACK_CHECK
+void __attribute__((noinline)) cp23lfs_stack_mark(void)
+{
+    volatile uint8_t top;
+    volatile uint8_t *paint = (volatile uint8_t *)&top - CP23LFS_STACK_MARGIN;
+    uint32_t cnt;
+
+    cp23lfs_state.stackTop = (uintptr_t)&top;
+    for (cnt = 0 ; cnt < CP23LFS_STACK_PAINT ; cnt++)
+    {
+        *(paint - cnt) = CP23LFS_STACK_FILL;
+    }
+}
+
+
+uint32_t cp23lfs_stack_used(void)
+{
+    volatile uint8_t const *paint = (volatile uint8_t const *)(cp23lfs_state.stackTop - CP23LFS_STACK_MARGIN - (CP23LFS_STACK_PAINT - 1u));
+    uint32_t cnt;
+
+    assert_param(cp23lfs_state.stackTop);
+
+    /* Untouched pattern from the bottom of the painted area */
+    for (cnt = 0 ; (cnt < CP23LFS_STACK_PAINT) && (paint[cnt] == CP23LFS_STACK_FILL) ; cnt++)
+    {
+    }
+    return CP23LFS_STACK_PAINT - cnt + CP23LFS_STACK_MARGIN;
+}
+
+
+bool cp23lfs_stack_check(cp23lfs_stack_t *measure, const char *name)
+{
+    assert_param(measure);
+    assert_param(name);
+
+    measure->name = name;
+    measure->peak = cp23lfs_stack_used();
+    measure->over = (measure->peak > CP23LFS_STACK_BUDGET);
+    if (measure->over)
+    {
+        LFS_WARN("cp23 %s stack %"PRIu32" bytes", name, measure->peak);
+    }
+    return measure->over;
+}
+#endif
+
+
+static int CP23_BlockRead(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    return IS25LP080D_Read(c->context, (block * c->block_size) + off, buffer, size);
+}
+
+
+/**
+  * @brief Checks that the superblock pair (blocks 0 and 1) is fully erased.
+  * @retval true on a blank memory (never formatted), false if any byte is programmed or on read errors.
+  */
+static bool CP23_DeviceBlank(void)
+{
+    uint8_t data[64];
+    uint32_t addr;
+    uint32_t cnt;
+
+    for (addr = 0u ; addr < (2u * CP23LFS_BLOCK_SIZE) ; addr += sizeof(data))
+    {
+        if (IS25LP080D_Read(cp23lfs_cfg.context, addr, data, sizeof(data)) != 0)
+        {
+            return false;
+        }
+        for (cnt = 0u ; cnt < sizeof(data) ; cnt++)
+        {
+            if (data[cnt] != 0xFFu)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**
+  * @brief Programs a block region.
+  * 
+  * The driver splits the program at the memory page boundaries (and in bus sharing chunks),
+  * the cache flushes crossing a page are passed whole.
+  */
+static int CP23_BlockProg(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+    return IS25LP080D_Program(c->context, (block * c->block_size) + off, buffer, size);
+}
+
+
+/**
+  * @brief Erases a block.
+  * 
+  * The driver queues the erase until the block is read or programmed: only the erases issued by
+  * LFS are merged into block erases, no block is erased ahead.
+  */
+static int CP23_BlockErase(const struct lfs_config *c, lfs_block_t block)
+{
+    int err = IS25LP080D_Erase(c->context, block * c->block_size, c->block_size);
+
+    if (err == 0)
+    {
+        cp23lfs_state.wearErases++;                                 /* Counted per block by the driver, saved by CP23_WearSave */
+    }
+    return err;
+}
+
+
+static int CP23_BlockSync(const struct lfs_config *c)
+{
+    return IS25LP080D_Sync(c->context);
+}
+
+
+/**
+  * @brief Commits a file (sync or close), keeping the secondary indexes up to date.
+  * 
+  * The indexes are marked dirty before committing a change of the indexed attributes,
+  * so a reset between the file commit and the index update leaves them invalid instead of stale.
+  */
+static int CP23_FileCommit(cp23lfs_file_t file, bool close)
+{
+    uint32_t key[CP23LFS_INDEX_NUM];
+    uint8_t group = file->system.commitGroup;
+    bool dirty = false;
+    bool changed = false;
+    int err = 0;
+    int res;
+
+    if ((file->system.file.flags & LFS_O_WRONLY) == LFS_O_WRONLY)
+    {
+        CP23_TimeSync(file);
+        /* Data written, attributes changed or new file (LFS_F_DIRTY is also set by opens only reading) */
+        dirty = ((file->system.written) || (file->system.generation == 0u) || (CP23_AttrHash(file) != file->system.attrHash));
+        CP23_IndexKeys(file, key);
+        changed = CP23_IndexChanged((file->system.indexed) ? file->system.idxKey : NULL, key, file->system.path, file->system.path);
+    }
+    if (changed)
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_DIRTY);
+    }
+    if ((dirty) && (err == 0))
+    {
+        err = CP23_GenNext(&(file->system.generation));             /* Committed with the attributes */
+    }
+    res = (close) ? lfs_file_close(&cp23lfs, &(file->system.file)) : lfs_file_sync(&cp23lfs, &(file->system.file));
+    if (err == 0)
+    {
+        err = res;
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexApply((file->system.indexed) ? file->system.idxKey : NULL, key, file->system.path, file->system.path);
+    }
+    if ((changed) && (err == 0))
+    {
+        err = CP23_IndexSetState(CP23LFS_INDEX_CLEAN);
+    }
+    if ((changed) && (err))
+    {
+        cp23lfs_state.idxState = CP23_IDX_INVALID;                  /* Indexes left dirty: rebuild required */
+    }
+    if ((changed) && (err == 0))
+    {
+        memcpy(file->system.idxKey, key, sizeof(key));
+        file->system.indexed = true;
+    }
+    if ((res == 0) && ((file->system.file.flags & LFS_F_ERRED) == 0u))
+    {
+        /* An errored file is not committed by LFS: its stored size and group are unchanged */
+        if ((group != CP23_QUOTA_NONE) && ((file->system.file.flags & LFS_O_WRONLY) == LFS_O_WRONLY))
+        {
+            group = LfsOwnerGroup(file->flags);                     /* Writable files commit the GROUP attribute */
+        }
+        CP23_UsedCommit(&(file->system.commitHead), file->system.commitSize, &(file->system.file));
+        CP23_QuotaCharge(file->system.commitGroup, file->system.commitSize, false);
+        CP23_QuotaCharge(group, file->size, true);
+        file->system.commitSize = file->size;
+        file->system.commitGroup = group;
+        file->system.written = false;
+        file->system.reserved = 0u;                                 /* Growth committed: charged to the group */
+        file->system.attrHash = CP23_AttrHash(file);
+    }
+    if ((res == 0) && (dirty))
+    {
+        CP23_PinRefresh(file->system.path);                         /* Write-through of the pinned copy */
+        CP23_FileOutdate(file->system.path);                        /* Read-only opens of the old content */
+    }
+    if ((err == 0) && (cp23lfs_state.wearErases >= CP23LFS_WEAR_SAVE))
+    {
+        err = CP23_WearSave();
+    }
+    return err;
+}
+
+
+/**
+  * @brief Keeps the EPOCH attribute of an open file in sync with DATE and TIME (committed by the caller).
+  * 
+  * DATE and TIME are the reference: EPOCH is derived from them when valid, otherwise the strings
+  * are derived from EPOCH. Files created without any time get it from the wall clock.
+  */
+static void CP23_TimeSync(cp23lfs_file_t file)
+{
+    uint32_t epoch = CP23_TimeToEpoch(file->date, file->time);
+
+    if (epoch)
+    {
+        file->epoch = epoch;
+        return;
+    }
+    if ((file->epoch == 0u) && (file->system.created) && (cp23lfs_state.clock))
+    {
+        file->epoch = cp23lfs_state.clock();
+    }
+    if (file->epoch)
+    {
+        CP23_EpochToTime(file->epoch, file->date, file->time);
+    }
+}
+
+
+/**
+  * @brief Re-aligns the time attributes of a file after type (DATE, TIME or EPOCH) has been set.
+  */
+static int CP23_TimeSyncByPath(const char *path, uint8_t type)
+{
+    uint8_t date[CP23LFS_DATE_LEN] = {0};
+    uint8_t time[CP23LFS_TIME_LEN] = {0};
+    uint32_t epoch = 0u;
+    lfs_ssize_t res;
+    int err;
+
+    res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_DATE, date, sizeof(date));
+    if ((res >= 0) || (res == LFS_ERR_NOATTR))
+    {
+        res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_TIME, time, sizeof(time));
+    }
+    if ((res >= 0) || (res == LFS_ERR_NOATTR))
+    {
+        res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_EPOCH, &epoch, sizeof(epoch));
+    }
+    if ((res < 0) && (res != LFS_ERR_NOATTR))
+    {
+        return (int)res;
+    }
+    if (type == CP23LFS_ATTR_EPOCH)
+    {
+        CP23_EpochToTime(epoch, date, time);
+        err = lfs_setattr(&cp23lfs, path, CP23LFS_ATTR_DATE, date, sizeof(date));
+        if (err == 0)
+        {
+            err = lfs_setattr(&cp23lfs, path, CP23LFS_ATTR_TIME, time, sizeof(time));
+        }
+        return err;
+    }
+    epoch = CP23_TimeToEpoch(date, time);
+    return lfs_setattr(&cp23lfs, path, CP23LFS_ATTR_EPOCH, &epoch, sizeof(epoch));
+}
+
+
+/**
+  * @brief Returns the number of time index entries with a time stamp not after timestamp (binary search).
+  */
+static uint32_t CP23_TimeIndexFind(const cp23lfs_tindexEntry_t entry[], uint32_t num, uint32_t timestamp)
+{
+    uint32_t low = 0u;
+    uint32_t high = num;
+    uint32_t mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2u;
+        if (entry[mid].timestamp <= timestamp)
+        {
+            low = mid + 1u;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+
+/**
+  * @brief Converts the DATE ("dd-mm-yyyy") and TIME ("HH:MM:SS") attributes to seconds since 1970.
+  * @return The time, 0 if the date is missing or invalid (a missing time counts as 00:00:00).
+  */
+static uint32_t CP23_TimeToEpoch(const uint8_t *date, const uint8_t *time)
+{
+    static uint8_t const datePos[8] = {0u, 1u, 3u, 4u, 6u, 7u, 8u, 9u};
+    static uint8_t const timePos[6] = {0u, 1u, 3u, 4u, 6u, 7u};
+    uint32_t digit[8];
+    uint32_t day;
+    uint32_t month;
+    uint32_t year;
+    uint32_t era;
+    uint32_t cnt;
+    uint32_t secs = 0u;
+
+    for (cnt = 0 ; cnt < 8u ; cnt++)
+    {
+        if ((date[datePos[cnt]] < '0') || (date[datePos[cnt]] > '9'))
+        {
+            return 0u;
+        }
+        digit[cnt] = date[datePos[cnt]] - '0';
+    }
+    if ((date[2] != '-') || (date[5] != '-'))
+    {
+        return 0u;
+    }
+    day = (digit[0] * 10u) + digit[1];
+    month = (digit[2] * 10u) + digit[3];
+    year = (digit[4] * 1000u) + (digit[5] * 100u) + (digit[6] * 10u) + digit[7];
+    if ((day < 1u) || (day > 31u) || (month < 1u) || (month > 12u) || (year < 1970u) || (year > 2105u))
+    {
+        return 0u;
+    }
+    for (cnt = 0 ; cnt < 6u ; cnt++)
+    {
+        if ((time[timePos[cnt]] < '0') || (time[timePos[cnt]] > '9'))
+        {
+            break;
+        }
+        digit[cnt] = time[timePos[cnt]] - '0';
+    }
+    if ((cnt == 6u) && (time[2] == ':') && (time[5] == ':'))
+    {
+        secs = (((digit[0] * 10u) + digit[1]) * 3600u) + (((digit[2] * 10u) + digit[3]) * 60u) + (digit[4] * 10u) + digit[5];
+    }
+    /* Days from civil date (March based year, 400 years eras) */
+    year -= (month <= 2u) ? 1u : 0u;
+    era = year / 400u;
+    day = ((((153u * ((month > 2u) ? (month - 3u) : (month + 9u))) + 2u) / 5u) + day) - 1u;
+    day = (((year - (era * 400u)) * 365u) + ((year - (era * 400u)) / 4u) - ((year - (era * 400u)) / 100u)) + day;
+    day = ((era * 146097u) + day) - 719468u;
+    return (day * CP23LFS_SECS_PER_DAY) + secs;
+}
+
+
+/**
+  * @brief Converts seconds since 1970 to the DATE ("dd-mm-yyyy") and TIME ("HH:MM:SS") attributes.
+  */
+static void CP23_EpochToTime(uint32_t epoch, uint8_t *date, uint8_t *time)
+{
+    uint32_t days = (epoch / CP23LFS_SECS_PER_DAY) + 719468u;
+    uint32_t secs = epoch % CP23LFS_SECS_PER_DAY;
+    uint32_t era = days / 146097u;
+    uint32_t doe = days - (era * 146097u);
+    uint32_t yoe = (doe - (doe / 1460u) + (doe / 36524u) - (doe / 146096u)) / 365u;
+    uint32_t doy = doe - ((365u * yoe) + (yoe / 4u) - (yoe / 100u));
+    uint32_t mp = ((5u * doy) + 2u) / 153u;
+    uint32_t day = (doy - (((153u * mp) + 2u) / 5u)) + 1u;
+    uint32_t month = (mp < 10u) ? (mp + 3u) : (mp - 9u);
+    uint32_t year = (yoe + (era * 400u)) + ((month <= 2u) ? 1u : 0u);
+
+    memset(date, 0, CP23LFS_DATE_LEN);
+    memset(time, 0, CP23LFS_TIME_LEN);
+    if (epoch == 0u)
+    {
+        memcpy(date, "NA", 2u);
+        memcpy(time, "NA", 2u);
+        return;
+    }
+    date[0] = '0' + (day / 10u);
+    date[1] = '0' + (day % 10u);
+    date[2] = '-';
+    date[3] = '0' + (month / 10u);
+    date[4] = '0' + (month % 10u);
+    date[5] = '-';
+    date[6] = '0' + (year / 1000u);
+    date[7] = '0' + ((year / 100u) % 10u);
+    date[8] = '0' + ((year / 10u) % 10u);
+    date[9] = '0' + (year % 10u);
+    time[0] = '0' + (secs / 36000u);
+    time[1] = '0' + ((secs / 3600u) % 10u);
+    time[2] = ':';
+    time[3] = '0' + (((secs / 60u) % 60u) / 10u);
+    time[4] = '0' + ((secs / 60u) % 10u);
+    time[5] = ':';
+    time[6] = '0' + ((secs % 60u) / 10u);
+    time[7] = '0' + (secs % 10u);
+}
+
+
+/**
+  * @brief Walks a directory tree depth-first, calling cb for each regular file.
+  * 
+  * Only one directory is open at a time: the parent positions are kept in a bounded stack
+  * and restored with lfs_dir_seek. The CP23 system directory is skipped. cb must not modify
+  * the tree and returns 0 to continue, > 0 to stop or a negative LFS error code.
+  */
+static int CP23_TreeWalk(const char *root, CP23_WalkCb_t cb, void *data)
+{
+    char path[CP23LFS_PATH_MAX];
+    lfs_off_t pos[CP23LFS_TREE_DEPTH_MAX];
+    uint32_t depth = 0u;
+    uint32_t len;
+    lfs_dir_t dir;
+    struct lfs_info info;
+    lfs_soff_t off;
+    bool opened;
+    int err;
+    int res;
+
+    if (!CP23_PathNormalize(path, root))
+    {
+        return LFS_ERR_NAMETOOLONG;
+    }
+    err = CP23_DirOpen(&dir, path);
+    opened = (err == 0);
+    while (err == 0)
+    {
+        len = strlen(path);
+        res = lfs_dir_read(&cp23lfs, &dir, &info);
+        if (res < 0)
+        {
+            err = res;
+        }
+        else if (res == 0)
+        {
+            /* End of directory: go back to the parent position */
+            err = CP23_DirClose(&dir);
+            opened = false;
+            if ((err) || (depth == 0u))
+            {
+                break;
+            }
+            CP23_PathParent(path);
+            depth--;
+            err = CP23_DirOpen(&dir, path);
+            opened = (err == 0);
+            if (err == 0)
+            {
+                err = lfs_dir_seek(&cp23lfs, &dir, pos[depth]);
+            }
+        }
+        else if ((strcmp(info.name, ".") == 0) || (strcmp(info.name, "..") == 0))
+        {
+            continue;
+        }
+        else if (!CP23_PathAppend(path, info.name))
+        {
+            err = LFS_ERR_NAMETOOLONG;
+        }
+        else if (info.type == LFS_TYPE_DIR)
+        {
+            if (strcmp(path, CP23LFS_SYS_DIR) == 0)
+            {
+                path[len] = '\0';
+                continue;
+            }
+            if (depth >= CP23LFS_TREE_DEPTH_MAX)
+            {
+                err = LFS_ERR_NOMEM;
+                break;
+            }
+            off = lfs_dir_tell(&cp23lfs, &dir);
+            err = CP23_DirClose(&dir);
+            opened = false;
+            if ((err == 0) && (off < 0))
+            {
+                err = (int)off;
+            }
+            if (err == 0)
+            {
+                pos[depth++] = (lfs_off_t)off;
+                err = CP23_DirOpen(&dir, path);
+                opened = (err == 0);
+            }
+        }
+        else
+        {
+            err = cb(data, path, &info);
+            path[len] = '\0';
+        }
+    }
+    if (opened)
+    {
+        (void)CP23_DirClose(&dir);
+    }
+    return (err > 0) ? 0 : err;
+}
+
+
+/**
+  * @brief Checks the query conditions on a file.
+  * @return 1 if all the conditions are satisfied, 0 if not, a negative LFS error code on failure.
+  */
+static int CP23_QueryMatch(const char *path, const cp23lfs_qcond_t cond[], uint32_t condNum)
+{
+    uint8_t attr[CP23LFS_QUERY_ATTR_MAX];
+    uint8_t const *value;
+    uint8_t group;
+    uint32_t size;
+    uint32_t cnt;
+    uint32_t byte;
+    bool match = true;
+    lfs_ssize_t res;
+
+    for (cnt = 0 ; (cnt < condNum) && (match) ; cnt++)
+    {
+        memset(attr, 0, sizeof(attr));
+        res = lfs_getattr(&cp23lfs, path, cond[cnt].attr, attr, sizeof(attr));
+        if ((res < 0) && (res != LFS_ERR_NOATTR))
+        {
+            return (int)res;                                        /* Missing attributes read as zero */
+        }
+        value = (uint8_t const *)(cond[cnt].value);
+        size = (cond[cnt].size < sizeof(attr)) ? cond[cnt].size : sizeof(attr);
+        if ((cond[cnt].attr == CP23LFS_ATTR_GROUP) && (size > 0u))
+        {
+            /* Owner group compared (flags bits 2-7 not used), as by the group index and the quotas */
+            attr[0] = LfsOwnerGroup(attr[0]);
+            group = LfsOwnerGroup(value[0]);
+            value = &group;
+            size = 1u;
+        }
+        switch (cond[cnt].op)
+        {
+            case CP23LFS_QOP_EQ:
+                match = (memcmp(attr, value, size) == 0);
+                break;
+            case CP23LFS_QOP_NE:
+                match = (memcmp(attr, value, size) != 0);
+                break;
+            case CP23LFS_QOP_ALL:
+                for (byte = 0 ; (byte < size) && (match) ; byte++)
+                {
+                    match = ((attr[byte] & value[byte]) == value[byte]);
+                }
+                break;
+            case CP23LFS_QOP_ANY:
+                match = false;
+                for (byte = 0 ; (byte < size) && (!match) ; byte++)
+                {
+                    match = ((attr[byte] & value[byte]) != 0u);
+                }
+                break;
+            default:
+                return LFS_ERR_INVAL;
+        }
+    }
+    return (match) ? 1 : 0;
+}
+
+
+/**
+  * @brief Query check of a candidate file (info = NULL for index records, read from the file system).
+  */
+static int CP23_QueryWalkCb(void *data, const char *path, const struct lfs_info *info)
+{
+    CP23_Query_t const *query = (CP23_Query_t const *)data;
+    struct lfs_info recInfo;
+    int res;
+
+    if (info == NULL)
+    {
+        res = lfs_stat(&cp23lfs, path, &recInfo);
+        if (res == LFS_ERR_NOENT)
+        {
+            return 0;
+        }
+        if (res)
+        {
+            return res;
+        }
+        info = &recInfo;
+    }
+    res = CP23_QueryMatch(path, query->cond, query->condNum);
+    if (res <= 0)
+    {
+        return res;
+    }
+    return (query->cb(query->data, path, info)) ? 0 : 1;
+}
+
+
+/**
+  * @brief Returns true if the secondary indexes are built and consistent.
+  */
+static bool CP23_IndexValid(void)
+{
+    uint8_t state = CP23LFS_INDEX_DIRTY;
+
+    if (cp23lfs_state.idxState == CP23_IDX_UNKNOWN)
+    {
+        cp23lfs_state.idxState = ((lfs_getattr(&cp23lfs, CP23LFS_INDEX_DIR, CP23LFS_SYSATTR_STATE, &state, sizeof(state)) == sizeof(state)) &&
+                            (state == CP23LFS_INDEX_CLEAN)) ? CP23_IDX_VALID : CP23_IDX_INVALID;
+    }
+    return (cp23lfs_state.idxState == CP23_IDX_VALID);
+}
+
+
+/**
+  * @brief Stores the secondary indexes state (CP23LFS_INDEX_CLEAN or CP23LFS_INDEX_DIRTY).
+  */
+static int CP23_IndexSetState(uint8_t state)
+{
+    int err = lfs_setattr(&cp23lfs, CP23LFS_INDEX_DIR, CP23LFS_SYSATTR_STATE, &state, sizeof(state));
+
+    if ((err == 0) && (state == CP23LFS_INDEX_CLEAN))
+    {
+        cp23lfs_state.idxState = CP23_IDX_VALID;
+    }
+    return err;
+}
+
+
+/**
+  * @brief Returns true if the indexes are valid and a key or the path changes (NULL keys = not indexed).
+  */
+static bool CP23_IndexChanged(const uint32_t oldKey[], const uint32_t newKey[], const char *oldPath, const char *newPath)
+{
+    if (!CP23_IndexValid())
+    {
+        return false;
+    }
+    if ((oldKey == NULL) || (newKey == NULL))
+    {
+        return ((oldKey) || (newKey));
+    }
+    return ((memcmp(oldKey, newKey, CP23LFS_INDEX_NUM * sizeof(uint32_t)) != 0) || (strcmp(oldPath, newPath) != 0));
+}
+
+
+/**
+  * @brief Moves a file between index buckets (oldKey = NULL: add, newKey = NULL: remove).
+  */
+static int CP23_IndexApply(const uint32_t oldKey[], const uint32_t newKey[], const char *oldPath, const char *newPath)
+{
+    uint32_t idx;
+    int err = 0;
+
+    for (idx = 0 ; (idx < CP23LFS_INDEX_NUM) && (err == 0) ; idx++)
+    {
+        if ((oldKey) && (newKey) && (oldKey[idx] == newKey[idx]))
+        {
+            if (strcmp(oldPath, newPath) != 0)
+            {
+                err = CP23_BucketUpdate(idx, oldKey[idx], oldPath, newPath);
+            }
+            continue;
+        }
+        if (oldKey)
+        {
+            err = CP23_BucketUpdate(idx, oldKey[idx], oldPath, NULL);
+        }
+        if ((newKey) && (err == 0))
+        {
+            err = CP23_BucketAdd(idx, newKey[idx], newPath);
+        }
+    }
+    return err;
+}
+
+
+/**
+  * @brief Removes the records selected by match from all the index buckets (one pass per bucket).
+  */
+static int CP23_IndexPurge(CP23_PurgeMatch_t match, const void *data)
+{
+    char name[CP23LFS_INDEX_NAME_LEN];
+    char rec[CP23LFS_PATH_MAX];
+    lfs_dir_t dir;
+    struct lfs_info info;
+    lfs_soff_t size;
+    uint32_t len;
+    uint32_t rd;
+    uint32_t wr;
+    int err;
+    int res;
+
+    err = CP23_DirOpen(&dir, CP23LFS_INDEX_DIR);
+    while ((err == 0) && ((res = lfs_dir_read(&cp23lfs, &dir, &info)) != 0))
+    {
+        if (res < 0)
+        {
+            err = res;
+            break;
+        }
+        if (info.type != LFS_TYPE_REG)
+        {
+            continue;
+        }
+        len = strlen(info.name);
+        if ((sizeof(CP23LFS_INDEX_DIR "/") + len) > sizeof(name))
+        {
+            continue;                                               /* Not a bucket name */
+        }
+        memcpy(name, CP23LFS_INDEX_DIR "/", sizeof(CP23LFS_INDEX_DIR "/") - 1u);
+        memcpy(&name[sizeof(CP23LFS_INDEX_DIR "/") - 1u], info.name, len + 1u);
+        err = CP23_SysOpen(name, LFS_O_RDWR, &cp23lfs_idxCfg);
+        if (err)
+        {
+            break;
+        }
+        /* Compact the bucket in place */
+        size = lfs_file_size(&cp23lfs, &cp23lfs_idxFile);
+        wr = 0u;
+        for (rd = 0 ; (err == 0) && (rd < ((uint32_t)size / sizeof(rec))) ; rd++)
+        {
+            res = (int)lfs_file_seek(&cp23lfs, &cp23lfs_idxFile, rd * sizeof(rec), LFS_SEEK_SET);
+            if (res >= 0)
+            {
+                res = (int)lfs_file_read(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+            }
+            if (res < 0)
+            {
+                err = res;
+            }
+            else if (!match(data, rec))
+            {
+                if (wr != rd)
+                {
+                    res = (int)lfs_file_seek(&cp23lfs, &cp23lfs_idxFile, wr * sizeof(rec), LFS_SEEK_SET);
+                    if (res >= 0)
+                    {
+                        res = (int)lfs_file_write(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+                    }
+                    err = (res < 0) ? res : 0;
+                }
+                wr++;
+            }
+        }
+        if ((err == 0) && ((wr * sizeof(rec)) != (uint32_t)size))
+        {
+            err = lfs_file_truncate(&cp23lfs, &cp23lfs_idxFile, wr * sizeof(rec));
+        }
+        res = CP23_SysClose();
+        err = (err) ? err : res;
+        if ((err == 0) && (wr == 0u))
+        {
+            err = CP23_Remove(name);                                /* Empty bucket */
+        }
+    }
+    res = CP23_DirClose(&dir);
+    return (err) ? err : res;
+}
+
+
+/**
+  * @brief Index build: adds a file to its buckets.
+  */
+static int CP23_IndexBuildCb(void *data, const char *path, const struct lfs_info *info)
+{
+    uint32_t key[CP23LFS_INDEX_NUM];
+    int err;
+
+    NOT_USED(data);
+    NOT_USED(info);
+    err = CP23_IndexKeysByPath(path, key);
+    return (err) ? err : CP23_IndexApply(NULL, key, path, path);
+}
+
+
+/**
+  * @brief Computes the secondary index keys of an open file.
+  */
+static void CP23_IndexKeys(cp23lfs_file_t file, uint32_t key[])
+{
+    key[CP23LFS_INDEX_GROUP] = LfsOwnerGroup(file->flags);
+    key[CP23LFS_INDEX_OWNER] = CP23_KeyHash(file->owner, sizeof(file->owner));
+    key[CP23LFS_INDEX_COMPANY] = CP23_KeyHash(file->company, sizeof(file->company));
+}
+
+
+/**
+  * @brief Computes the secondary index keys of a file from its stored attributes.
+  */
+static int CP23_IndexKeysByPath(const char *path, uint32_t key[])
+{
+    uint8_t flags = 0u;
+    uint8_t name[CP23LFS_OWNER_LEN];
+    lfs_ssize_t res;
+
+    res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_GROUP, &flags, sizeof(flags));
+    if ((res < 0) && (res != LFS_ERR_NOATTR))
+    {
+        return (int)res;
+    }
+    key[CP23LFS_INDEX_GROUP] = LfsOwnerGroup(flags);
+    res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_OWNER, name, CP23LFS_OWNER_LEN);
+    if ((res < 0) && (res != LFS_ERR_NOATTR))
+    {
+        return (int)res;
+    }
+    key[CP23LFS_INDEX_OWNER] = CP23_KeyHash(name, CP23LFS_OWNER_LEN);
+    res = lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_COMPANY, name, CP23LFS_COMPANY_LEN);
+    if ((res < 0) && (res != LFS_ERR_NOATTR))
+    {
+        return (int)res;
+    }
+    key[CP23LFS_INDEX_COMPANY] = CP23_KeyHash(name, CP23LFS_COMPANY_LEN);
+    return 0;
+}
+
+
+/**
+  * @brief Builds the bucket file path of an index key ("/.cp23/idx/" + 'g', 'o' or 'c' + 8 hex digits).
+  */
+static void CP23_IndexBucket(char *name, uint32_t idx, uint32_t key)
+{
+    static char const prefix[CP23LFS_INDEX_NUM] = {'g', 'o', 'c'};
+    static char const hex[] = "0123456789abcdef";
+    uint32_t len = sizeof(CP23LFS_INDEX_DIR "/") - 1u;
+    uint32_t cnt;
+
+    memcpy(name, CP23LFS_INDEX_DIR "/", len);
+    name[len++] = prefix[idx];
+    for (cnt = 8u ; cnt > 0u ; cnt--)
+    {
+        name[len++] = hex[(key >> ((cnt - 1u) * 4u)) & 0x0Fu];
+    }
+    name[len] = '\0';
+}
+
+
+/**
+  * @brief Creates a directory (its metadata pair is counted as an allocation, see CP23_UsedSync).
+  */
+static int CP23_Mkdir(const char *path)
+{
+    return lfs_mkdir(&cp23lfs, path);
+}
+
+
+/**
+  * @brief Appends a path record to an index bucket.
+  */
+static int CP23_BucketAdd(uint32_t idx, uint32_t key, const char *path)
+{
+    char name[CP23LFS_INDEX_NAME_LEN];
+    char rec[CP23LFS_PATH_MAX] = {0};
+    lfs_ssize_t res;
+    int err;
+
+    CP23_IndexBucket(name, idx, key);
+    strncpy(rec, path, sizeof(rec) - 1u);
+    err = CP23_SysOpen(name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, &cp23lfs_idxCfg);
+    if (err)
+    {
+        return err;
+    }
+    res = lfs_file_write(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+    err = CP23_SysClose();
+    return (res < 0) ? (int)res : err;
+}
+
+
+/**
+  * @brief Replaces (newPath != NULL) or removes (newPath = NULL) a path record of an index bucket.
+  * 
+  * A removed record is overwritten by the last one, so the bucket stays compact.
+  */
+static int CP23_BucketUpdate(uint32_t idx, uint32_t key, const char *path, const char *newPath)
+{
+    char name[CP23LFS_INDEX_NAME_LEN];
+    char rec[CP23LFS_PATH_MAX];
+    lfs_soff_t size;
+    uint32_t num;
+    uint32_t cnt;
+    lfs_ssize_t res = 0;
+    int err;
+
+    CP23_IndexBucket(name, idx, key);
+    err = CP23_SysOpen(name, LFS_O_RDWR, &cp23lfs_idxCfg);
+    if (err)
+    {
+        return (err == LFS_ERR_NOENT) ? 0 : err;
+    }
+    size = lfs_file_size(&cp23lfs, &cp23lfs_idxFile);
+    num = (size > 0) ? ((uint32_t)size / sizeof(rec)) : 0u;
+    for (cnt = 0 ; cnt < num ; cnt++)
+    {
+        res = lfs_file_read(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+        if ((res < 0) || (strcmp(rec, path) == 0))
+        {
+            break;
+        }
+    }
+    if ((res >= 0) && (cnt < num))
+    {
+        if (newPath)
+        {
+            memset(rec, 0, sizeof(rec));
+            strncpy(rec, newPath, sizeof(rec) - 1u);
+        }
+        else if (cnt != (num - 1u))
+        {
+            res = lfs_file_seek(&cp23lfs, &cp23lfs_idxFile, (num - 1u) * sizeof(rec), LFS_SEEK_SET);
+            if (res >= 0)
+            {
+                res = lfs_file_read(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+            }
+        }
+        if ((res >= 0) && ((newPath) || (cnt != (num - 1u))))
+        {
+            res = lfs_file_seek(&cp23lfs, &cp23lfs_idxFile, cnt * sizeof(rec), LFS_SEEK_SET);
+            if (res >= 0)
+            {
+                res = lfs_file_write(&cp23lfs, &cp23lfs_idxFile, rec, sizeof(rec));
+            }
+        }
+        if ((res >= 0) && (newPath == NULL))
+        {
+            res = lfs_file_truncate(&cp23lfs, &cp23lfs_idxFile, (num - 1u) * sizeof(rec));
+        }
+    }
+    err = CP23_SysClose();
+    if (res < 0)
+    {
+        return (int)res;
+    }
+    if ((err == 0) && (newPath == NULL) && (num == 1u) && (cnt == 0u))
+    {
+        err = CP23_Remove(name);                                    /* Empty bucket */
+    }
+    return err;
+}
+
+
+static bool CP23_PurgeAll(const void *data, const char *path)
+{
+    NOT_USED(data);
+    NOT_USED(path);
+    return true;
+}
+
+
+/**
+  * @brief Purge match: records inside the tree data ("" = whole file system).
+  */
+static bool CP23_PurgeTree(const void *data, const char *path)
+{
+    char const *root = (char const *)data;
+    uint32_t len = strlen(root);
+
+    return ((strncmp(path, root, len) == 0) && ((path[len] == '/') || (path[len] == '\0')));
+}
+
+
+/**
+  * @brief Purge match: records of the listed entries of a directory.
+  */
+static bool CP23_PurgeNames(const void *data, const char *path)
+{
+    CP23_PurgeNames_t const *purge = (CP23_PurgeNames_t const *)data;
+    uint32_t len = strlen(purge->dirPath);
+    uint32_t cnt;
+
+    if ((strncmp(path, purge->dirPath, len) != 0) || (path[len] != '/'))
+    {
+        return false;
+    }
+    for (cnt = 0 ; cnt < purge->count ; cnt++)
+    {
+        if (strcmp(&path[len + 1u], purge->names[cnt]) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+  * @brief Recounts the blocks in use with a file system traversal (mount and cp23lfs_fs_reconcile).
+  */
+static int CP23_UsedReconcile(void)
+{
+    int err = CP23_UsedCount(cp23lfs_state.usedMap, &(cp23lfs_state.usedBlocks));
+
+    CP23_UsedSnap();
+    return err;
+}
+
+
+/**
+  * @brief Lists the blocks in use with a file system traversal.
+  * 
+  * Unlike lfs_fs_size, a block is counted once when it is also listed by an open file
+  * (files opened for writing list their committed blocks again).
+  * @param used The blocks in use (bitmap of the memory blocks).
+  * @param blocks The number of blocks in use.
+  */
+static int CP23_UsedCount(uint8_t used[], int32_t *blocks)
+{
+    uint32_t cnt;
+    int err;
+
+    memset(used, 0, CP23LFS_BLOCK_COUNT / 8u);
+    err = lfs_fs_traverse(&cp23lfs, CP23_UsedCountCb, used);
+    *blocks = 0;
+    for (cnt = 0 ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        *blocks += (int32_t)((used[cnt / 8u] >> (cnt % 8u)) & 1u);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Traverse callback of CP23_UsedCount: marks a block in use.
+  */
+static int CP23_UsedCountCb(void *data, lfs_block_t block)
+{
+    uint8_t *used = (uint8_t *)data;
+
+    if (block < CP23LFS_BLOCK_COUNT)
+    {
+        used[block / 8u] |= (uint8_t)(1u << (block % 8u));
+    }
+    return 0;
+}
+
+
+/**
+  * @brief Counts the blocks allocated by LFS since the last count, from its allocation window.
+  * 
+  * lfs_alloc hands out the free blocks of the window in order (see CP23_Window), so the free blocks
+  * passed since the last count were allocated. Once counted, the passed blocks are marked in use in
+  * the window (LFS does not look back before its next block): any block freed again by a rescan
+  * shows the rescan. LFS rescans the window only when it is used up: the free blocks left in the
+  * old window were allocated first, then the new window holds the blocks in use at the scan, and
+  * its free blocks passed since were allocated. The blocks out of the new window keep their state.
+  * Called at the end of the calls and before the frees, so that a rescan never undoes a later free.
+  * A new window is steered away from the worn blocks (see CP23_WearSkip).
+  */
+static void CP23_UsedSync(void)
+{
+    CP23_Window_t win = CP23_Window(NULL);
+    CP23_Window_t last = cp23lfs_state.usedWin;
+    uint8_t *ahead = (uint8_t *)cp23lfs_lookaheadBuffer;
+    bool rescanned;
+    uint32_t off;
+
+    rescanned = ((win.start != last.start) || (win.size != last.size) || (win.next < last.next) || 
+                 (memcmp(ahead, cp23lfs_state.usedAhead, sizeof(cp23lfs_state.usedAhead)) != 0));
+    if (!rescanned)
+    {
+        last.size = win.next;                                       /* Same window: passed up to the next block to allocate */
+    }
+    else if (win.size == 0u)
+    {
+        last.size = 0u;                                             /* Window dropped (failed scan): rescanned by the next allocation */
+    }
+    for (off = last.next ; off < last.size ; off++)
+    {
+        if ((cp23lfs_state.usedAhead[off / 8u] & (1u << (off % 8u))) == 0u)
+        {
+            CP23_UsedSet((last.start + off) % CP23LFS_BLOCK_COUNT, true);
+        }
+    }
+    for (off = 0 ; (rescanned) && (off < win.size) ; off++)
+    {
+        CP23_UsedSet((win.start + off) % CP23LFS_BLOCK_COUNT, ((off < win.next) || ((ahead[off / 8u] & (1u << (off % 8u))) != 0u)));
+    }
+    for (off = (rescanned) ? 0u : last.next ; off < win.next ; off++)
+    {
+        ahead[off / 8u] |= (uint8_t)(1u << (off % 8u));
+    }
+    CP23_UsedSnap();
+    if ((rescanned) && (win.size > 0u))
+    {
+        CP23_WearSkip();                                            /* New window: steered again */
+    }
+}
+
+
+/**
+  * @brief Keeps the allocation window as counted (see CP23_UsedSync).
+  */
+static void CP23_UsedSnap(void)
+{
+    cp23lfs_state.usedWin = CP23_Window(NULL);
+    memcpy(cp23lfs_state.usedAhead, cp23lfs_lookaheadBuffer, sizeof(cp23lfs_state.usedAhead));
+}
+
+
+/**
+  * @brief Sets a block in use or free.
+  */
+static void CP23_UsedSet(lfs_block_t block, bool used)
+{
+    uint8_t mask = (uint8_t)(1u << (block % 8u));
+
+    if (block >= CP23LFS_BLOCK_COUNT)
+    {
+        return;
+    }
+    if ((used) && ((cp23lfs_state.usedMap[block / 8u] & mask) == 0u))
+    {
+        cp23lfs_state.usedMap[block / 8u] |= mask;
+        cp23lfs_state.usedBlocks++;
+    }
+    else if ((!used) && ((cp23lfs_state.usedMap[block / 8u] & mask) != 0u))
+    {
+        cp23lfs_state.usedMap[block / 8u] &= (uint8_t)~mask;
+        cp23lfs_state.usedBlocks--;
+    }
+}
+
+
+/**
+  * @brief Frees blocks released by a commit or a remove (allocations counted first).
+  * @param freed The blocks (bitmap of the memory blocks).
+  */
+static void CP23_UsedRelease(const uint8_t freed[])
+{
+    uint32_t cnt;
+
+    CP23_UsedSync();
+    for (cnt = 0 ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        if (freed[cnt / 8u] & (1u << (cnt % 8u)))
+        {
+            CP23_UsedSet(cnt, false);
+        }
+    }
+}
+
+
+/**
+  * @brief Frees the blocks of the committed CTZ skip-list of a file that its new commit no longer uses.
+  * @param head The committed head (CP23_CTZ_NONE: inline or empty file), updated to the new one.
+  * @param size The committed size.
+  * @param file The file just committed.
+  */
+static void CP23_UsedCommit(lfs_block_t *head, lfs_size_t size, const lfs_file_t *file)
+{
+    uint8_t freed[CP23LFS_BLOCK_COUNT / 8u];
+    lfs_block_t newHead = CP23_CtzHead(file);
+
+    if (*head != CP23_CTZ_NONE)
+    {
+        memset(freed, 0, sizeof(freed));
+        (void)CP23_CtzCollect(*head, size, newHead, (newHead != CP23_CTZ_NONE) ? file->ctz.size : 0u, freed);
+        CP23_UsedRelease(freed);                                    /* Blocks collected before a read error are still free */
+    }
+    *head = newHead;
+}
+
+
+/**
+  * @brief Collects the blocks of an entry about to be removed or replaced: CTZ skip-list of a file, metadata pair of a directory.
+  * 
+  * A directory can only be removed empty: its other metadata pairs were dropped with its last entries.
+  * @param path The entry (normalized). Missing entries collect nothing.
+  * @param freed The collected blocks (bitmap of the memory blocks).
+  */
+static void CP23_UsedEntry(const char *path, uint8_t freed[])
+{
+    lfs_block_t head;
+    lfs_size_t size;
+    lfs_dir_t dir;
+    int err = CP23_CtzGet(path, &head, &size);
+
+    if (err == 0)
+    {
+        (void)CP23_CtzCollect(head, size, CP23_CTZ_NONE, 0u, freed);
+    }
+    else if ((err == LFS_ERR_ISDIR) && (CP23_DirOpen(&dir, path) == 0))
+    {
+        freed[dir.m.pair[0] / 8u] |= (uint8_t)(1u << (dir.m.pair[0] % 8u));
+        freed[dir.m.pair[1] / 8u] |= (uint8_t)(1u << (dir.m.pair[1] % 8u));
+        (void)CP23_DirClose(&dir);
+    }
+}
+
+
+/**
+  * @brief Lists the metadata pairs of a directory (before removing some of its entries, see CP23_UsedDropped).
+  * 
+  * The pairs after the first one are walked only for split directories.
+  * @param dirPath The directory (normalized).
+  * @param pairs The blocks of the pairs (bitmap of the memory blocks).
+  * @return The number of pairs (0 if the directory cannot be read).
+  */
+static uint32_t CP23_UsedPairs(const char *dirPath, uint8_t pairs[])
+{
+    struct lfs_info info;
+    lfs_dir_t dir;
+    uint32_t num = 0u;
+    int res;
+
+    memset(pairs, 0, CP23LFS_BLOCK_COUNT / 8u);
+    if (CP23_DirOpen(&dir, dirPath) != 0)
+    {
+        return 0u;
+    }
+    do
+    {
+        if ((pairs[dir.m.pair[0] / 8u] & (1u << (dir.m.pair[0] % 8u))) == 0u)
+        {
+            pairs[dir.m.pair[0] / 8u] |= (uint8_t)(1u << (dir.m.pair[0] % 8u));
+            pairs[dir.m.pair[1] / 8u] |= (uint8_t)(1u << (dir.m.pair[1] % 8u));
+            num++;
+        }
+        res = (dir.m.split) ? lfs_dir_read(&cp23lfs, &dir, &info) : 0;
+    } while (res > 0);
+    (void)CP23_DirClose(&dir);
+    return num;
+}
+
+
+/**
+  * @brief Collects the metadata pairs that LFS dropped from a directory emptied by removes (split directories only).
+  * @param dirPath The directory (normalized).
+  * @param pairs Its pairs before the removes (CP23_UsedPairs).
+  * @param num The number of pairs before the removes (the first pair is never dropped).
+  * @param freed The collected blocks (bitmap of the memory blocks).
+  */
+static void CP23_UsedDropped(const char *dirPath, const uint8_t pairs[], uint32_t num, uint8_t freed[])
+{
+    uint8_t now[CP23LFS_BLOCK_COUNT / 8u];
+    uint32_t cnt;
+
+    if ((num > 1u) && (CP23_UsedPairs(dirPath, now) > 0u))
+    {
+        for (cnt = 0 ; cnt < sizeof(now) ; cnt++)
+        {
+            freed[cnt] |= (uint8_t)(pairs[cnt] & ~now[cnt]);
+        }
+    }
+}
+
+
+/**
+  * @brief Returns the data blocks of a file (CTZ skip-list, inline files use none).
+  * 
+  * Block 0 holds block_size data bytes, block n also stores ctz(n) + 1 back pointers.
+  */
+static uint32_t CP23_FileBlocks(lfs_size_t size)
+{
+    uint32_t blocks = 0u;
+    uint32_t capacity;
+
+    if (size <= cp23lfs.inline_max)
+    {
+        return 0u;
+    }
+    while (size > 0u)
+    {
+        capacity = (blocks == 0u) ? CP23LFS_BLOCK_SIZE : (CP23LFS_BLOCK_SIZE - (4u * (lfs_ctz(blocks) + 1u)));
+        size -= (size < capacity) ? size : capacity;
+        blocks++;
+    }
+    return blocks;
+}
+
+
+/**
+  * @brief Recounts the owner groups usage with a tree walk (limits are kept).
+  */
+static int CP23_QuotaReconcile(void)
+{
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_GROUP_NUM ; cnt++)
+    {
+        cp23lfs_state.quota[cnt].bytes = 0u;
+        cp23lfs_state.quota[cnt].blocks = 0u;
+    }
+    return CP23_TreeWalk("/", CP23_QuotaReconcileCb, NULL);
+}
+
+
+/**
+  * @brief Tree walk callback of CP23_QuotaReconcile: charges a file to its owner group.
+  */
+static int CP23_QuotaReconcileCb(void *data, const char *path, const struct lfs_info *info)
+{
+    uint32_t generation = 0u;
+
+    (void)data;
+
+    CP23_QuotaCharge(CP23_QuotaGroup(path), info->size, true);
+    /* Generations continue from the highest stored one */
+    (void)lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_GEN, &generation, sizeof(generation));
+    cp23lfs_state.genLast = (generation > cp23lfs_state.genLast) ? generation : cp23lfs_state.genLast;
+    return 0;
+}
+
+
+/**
+  * @brief Stores a new generation for a file changed without a commit of the file (rename, attribute), reloads its pin and stops sharing its opens.
+  */
+static int CP23_GenBump(const char *path)
+{
+    struct lfs_info info;
+    uint32_t generation;
+    int err = lfs_stat(&cp23lfs, path, &info);
+
+    if ((err == 0) && (info.type == LFS_TYPE_REG))
+    {
+        err = CP23_GenNext(&generation);
+    }
+    if ((err == 0) && (info.type == LFS_TYPE_REG))
+    {
+        err = lfs_setattr(&cp23lfs, path, CP23LFS_ATTR_GEN, &generation, sizeof(generation));
+    }
+    if (err == 0)
+    {
+        CP23_PinRefresh(path);
+        CP23_FileOutdate(path);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Returns a new file generation.
+  * 
+  * Generations are handed out below a high-water mark stored in the system directory, raised by
+  * CP23LFS_GEN_CHUNK at a time, so the generation of a removed file is not used again after a reset.
+  */
+static int CP23_GenNext(uint32_t *generation)
+{
+    uint32_t mark = cp23lfs_state.genLast + 1u + CP23LFS_GEN_CHUNK;
+    int err;
+
+    if (cp23lfs_state.genLast >= cp23lfs_state.genMark)
+    {
+        err = CP23_Mkdir(CP23LFS_SYS_DIR);
+        if ((err) && (err != LFS_ERR_EXIST))
+        {
+            return err;
+        }
+        err = lfs_setattr(&cp23lfs, CP23LFS_SYS_DIR, CP23LFS_SYSATTR_GEN, &mark, sizeof(mark));
+        if (err)
+        {
+            return err;
+        }
+        cp23lfs_state.genMark = mark;
+    }
+    *generation = ++cp23lfs_state.genLast;
+    return 0;
+}
+
+
+/**
+  * @brief Continues the generations from the stored high-water mark (or from the highest stored generation).
+  */
+static int CP23_GenLoad(void)
+{
+    uint32_t mark = 0u;
+    lfs_ssize_t res = lfs_getattr(&cp23lfs, CP23LFS_SYS_DIR, CP23LFS_SYSATTR_GEN, &mark, sizeof(mark));
+
+    if ((res < 0) && (res != LFS_ERR_NOENT) && (res != LFS_ERR_NOATTR))
+    {
+        return (int)res;
+    }
+    cp23lfs_state.genMark = (res == (lfs_ssize_t)sizeof(mark)) ? mark : 0u;
+    cp23lfs_state.genLast = (cp23lfs_state.genMark > cp23lfs_state.genLast) ? cp23lfs_state.genMark : cp23lfs_state.genLast;
+    return 0;
+}
+
+
+/**
+  * @brief Checks that a file can grow to newSize within its owner group quota and the SYS reserve.
+  * 
+  * The growth is reserved in the group until the file is committed, so the uncommitted growth
+  * of the other open files is taken into account. The blocks in use already count the blocks
+  * written by the open files (see CP23_UsedSync), so the SYS reserve is checked against the
+  * blocks still to be written up to newSize only.
+  * @return 0 if the file can grow, LFS_ERR_NOSPC otherwise.
+  */
+static int CP23_QuotaCheck(cp23lfs_file_t file, lfs_size_t newSize)
+{
+    uint8_t group = LfsOwnerGroup(file->flags);
+    uint32_t oldBlocks = CP23_FileBlocks(file->system.commitSize);
+    uint32_t newBlocks = CP23_FileBlocks(newSize);
+    uint32_t growBlocks = newBlocks - CP23_FileBlocks(file->size);
+    uint32_t reserve;
+    uint32_t groupBlocks;
+
+    if (file->system.commitGroup == CP23_QUOTA_NONE)
+    {
+        return 0;
+    }
+    if ((group != CP23LFS_GROUP_SYS) && 
+        ((cp23lfs_state.usedBlocks + (int32_t)growBlocks + (int32_t)CP23LFS_SYS_RESERVE) > (int32_t)CP23LFS_BLOCK_COUNT))
+    {
+        return LFS_ERR_NOSPC;
+    }
+    if (newBlocks <= oldBlocks)
+    {
+        return 0;
+    }
+    reserve = newBlocks - ((file->system.commitGroup == group) ? oldBlocks : 0u);
+    if ((file->system.reserved >= reserve) && (file->system.reservedGroup == group))
+    {
+        return 0;                                                   /* Already reserved */
+    }
+    groupBlocks = cp23lfs_state.quota[group].blocks + CP23_QuotaReserved(file, group) + reserve;
+    if ((cp23lfs_state.quota[group].limit) && (groupBlocks > cp23lfs_state.quota[group].limit))
+    {
+        return LFS_ERR_NOSPC;
+    }
+    file->system.reserved = reserve;
+    file->system.reservedGroup = group;
+    return 0;
+}
+
+
+/**
+  * @brief Returns the blocks reserved in a group by the uncommitted growth of the open files other than file.
+  */
+static uint32_t CP23_QuotaReserved(cp23lfs_file_t file, uint8_t group)
+{
+    uint32_t blocks = 0u;
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
+    {
+        if ((cp23lsf_file[cnt].system.allocated) && (&(cp23lsf_file[cnt]) != file))
+        {
+            blocks += (cp23lsf_file[cnt].system.reservedGroup == group) ? cp23lsf_file[cnt].system.reserved : 0u;
+        }
+    }
+    return blocks;
+}
+
+
+/**
+  * @brief Removes a removed entry from the usage of its owner group (group read with CP23_QuotaGroup before removing).
+  */
+static void CP23_QuotaRemoved(const struct lfs_info *info, uint8_t group)
+{
+    if (info->type == LFS_TYPE_REG)
+    {
+        CP23_QuotaCharge(group, info->size, false);
+    }
+}
+
+
+/**
+  * @brief Adds (or removes) a committed file to the usage of an owner group.
+  */
+static void CP23_QuotaCharge(uint8_t group, lfs_size_t size, bool add)
+{
+    uint32_t blocks = CP23_FileBlocks(size);
+    cp23lfs_quota_t *quota;
+
+    if (group == CP23_QUOTA_NONE)
+    {
+        return;
+    }
+    quota = &(cp23lfs_state.quota[LfsOwnerGroup(group)]);
+    if (add)
+    {
+        quota->bytes += size;
+        quota->blocks += blocks;
+    }
+    else
+    {
+        quota->bytes -= (quota->bytes > size) ? size : quota->bytes;
+        quota->blocks -= (quota->blocks > blocks) ? blocks : quota->blocks;
+    }
+}
+
+
+/**
+  * @brief Returns the owner group charged for a file (CP23_QUOTA_NONE for the CP23 system files).
+  */
+static uint8_t CP23_QuotaGroup(const char *path)
+{
+    uint8_t flags = 0u;
+
+    if (CP23_PathIsSys(path))
+    {
+        return CP23_QUOTA_NONE;
+    }
+    (void)lfs_getattr(&cp23lfs, path, CP23LFS_ATTR_GROUP, &flags, sizeof(flags));
+    return LfsOwnerGroup(flags);
+}
+
+
+/**
+  * @brief Restores the erase counts stored in the wear table (kept when the driver counted more since start-up).
+  */
+static int CP23_WearLoad(void)
+{
+    uint32_t chunk[CP23LFS_WEAR_CHUNK];
+    uint32_t sector = 0u;
+    uint32_t count;
+    uint32_t cnt;
+    lfs_ssize_t res = 0;
+    int err;
+
+    err = CP23_SysOpen(CP23LFS_WEAR_FILE, LFS_O_RDONLY, &cp23lfs_idxCfg);
+    if (err == LFS_ERR_NOENT)
+    {
+        return 0;                                                   /* First start: the table is created by the first save */
+    }
+    if (err)
+    {
+        return err;
+    }
+    while (sector < CP23LFS_BLOCK_COUNT)
+    {
+        res = lfs_file_read(&cp23lfs, &cp23lfs_idxFile, chunk, sizeof(chunk));
+        if (res != (lfs_ssize_t)sizeof(chunk))
+        {
+            break;
+        }
+        for (cnt = 0 ; cnt < CP23LFS_WEAR_CHUNK ; cnt++, sector++)
+        {
+            /* A remount without reset finds the table already in the driver counts */
+            count = IS25LP080D_GetEraseCount(sector);
+            IS25LP080D_SetEraseCount(sector, (chunk[cnt] > count) ? chunk[cnt] : count);
+        }
+    }
+    err = CP23_SysClose();
+    return (res < 0) ? (int)res : err;
+}
+
+
+/**
+  * @brief Stores the erase counts in the wear table, then refills the allocation window (see CP23_WearSteer).
+  */
+static int CP23_WearSave(void)
+{
+    uint32_t chunk[CP23LFS_WEAR_CHUNK];
+    uint32_t sector = 0u;
+    uint32_t cnt;
+    lfs_ssize_t res = 0;
+    int err;
+
+    err = CP23_Mkdir(CP23LFS_SYS_DIR);
+    if ((err) && (err != LFS_ERR_EXIST))
+    {
+        return err;
+    }
+    err = CP23_SysOpen(CP23LFS_WEAR_FILE, LFS_O_WRONLY | LFS_O_CREAT, &cp23lfs_idxCfg);
+    if (err)
+    {
+        return err;
+    }
+    while ((sector < CP23LFS_BLOCK_COUNT) && (res >= 0))
+    {
+        for (cnt = 0 ; cnt < CP23LFS_WEAR_CHUNK ; cnt++, sector++)
+        {
+            chunk[cnt] = IS25LP080D_GetEraseCount(sector);
+        }
+        res = lfs_file_write(&cp23lfs, &cp23lfs_idxFile, chunk, sizeof(chunk));
+    }
+    err = CP23_SysClose();
+    if ((res >= 0) && (err == 0))
+    {
+        cp23lfs_state.wearErases = 0u;
+        err = CP23_WearSteer();
+    }
+    return (res < 0) ? (int)res : err;
+}
+
+
+/**
+  * @brief Refills the allocation window, skipping the worn free blocks.
+  * 
+  * LFS allocates the free blocks of its lookahead window (the whole memory) in order from the
+  * window start, and rescans the file system when the window is used up. Between two LFS operations
+  * no allocation is in flight, so the window can be refilled here: it starts from the least worn
+  * block, and the worn free blocks are skipped (see CP23_WearSkip).
+  */
+static int CP23_WearSteer(void)
+{
+    lfs_block_t start = 0u;
+    uint32_t minCount = UINT32_MAX;
+    uint32_t count;
+    uint32_t cnt;
+    int err;
+
+    for (cnt = 0 ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        count = IS25LP080D_GetEraseCount(cnt);
+        if (count < minCount)
+        {
+            start = cnt;
+            minCount = count;
+        }
+    }
+    err = CP23_WearFill(start);
+    if (err == 0)
+    {
+        CP23_WearSkip();
+    }
+    return err;
+}
+
+
+/**
+  * @brief Marks in use the worn free blocks of the allocation window.
+  * 
+  * The free blocks worn more than CP23LFS_WEAR_DELTA erases over the least worn free one, or slow
+  * (see IS25LP080D_IsSlowSector), are marked in use. The limit is raised by steps of
+  * CP23LFS_WEAR_DELTA until CP23LFS_WEAR_KEEP free blocks are left. The skipped blocks are
+  * available again at the next LFS scan, which is steered again (see CP23_UsedSync) without
+  * moving its start. Blocks and memory sectors have the same size.
+  */
+static void CP23_WearSkip(void)
+{
+    CP23_Window_t win = CP23_Window(NULL);
+    uint32_t minCount = UINT32_MAX;
+    uint32_t count;
+    uint32_t limit;
+    uint32_t keep = 0u;
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < win.size ; cnt++)
+    {
+        if (CP23_WearIsFree(cnt))
+        {
+            count = IS25LP080D_GetEraseCount((win.start + cnt) % CP23LFS_BLOCK_COUNT);
+            minCount = (count < minCount) ? count : minCount;
+        }
+    }
+    if (minCount == UINT32_MAX)
+    {
+        return;                                                     /* No free block in the window */
+    }
+    /* Raise the limit until CP23LFS_WEAR_KEEP free blocks are left: the allocation restarts from
+       the window start at each refill, the blocks kept must take turns */
+    for (limit = minCount + CP23LFS_WEAR_DELTA ; ; limit += CP23LFS_WEAR_DELTA)
+    {
+        for (cnt = 0, keep = 0u, count = 0u ; cnt < win.size ; cnt++)
+        {
+            if (CP23_WearIsFree(cnt))
+            {
+                keep += (CP23_WearAvoid((win.start + cnt) % CP23LFS_BLOCK_COUNT, limit)) ? 0u : 1u;
+                count += (IS25LP080D_GetEraseCount((win.start + cnt) % CP23LFS_BLOCK_COUNT) > limit) ? 1u : 0u;
+            }
+        }
+        if ((keep >= CP23LFS_WEAR_KEEP) || (count == 0u))
+        {
+            break;                                                  /* Enough blocks left, or only slow blocks left to skip */
+        }
+    }
+    for (cnt = 0 ; (cnt < win.size) && (keep >= CP23LFS_WEAR_KEEP) ; cnt++)
+    {
+        if ((CP23_WearIsFree(cnt)) && (CP23_WearAvoid((win.start + cnt) % CP23LFS_BLOCK_COUNT, limit)))
+        {
+            CP23_WearMark(cnt);
+        }
+    }
+}
+
+
+/**
+  * @brief Checks if the allocator should avoid a block: worn over the limit or slow.
+  */
+static bool CP23_WearAvoid(lfs_block_t block, uint32_t limit)
+{
+    return ((IS25LP080D_GetEraseCount(block) > limit) || (IS25LP080D_IsSlowSector(block)));
+}
+
+
+/**
+  * @brief Refills the allocation window from start with the blocks in use (same window as lfs_alloc_scan).
+  * 
+  * The traversal also lists the blocks in use again (see CP23_UsedSync).
+  */
+static int CP23_WearFill(lfs_block_t start)
+{
+    CP23_Window_t win = {start, 0u, CP23LFS_BLOCK_COUNT};
+    uint32_t cnt;
+    int err;
+
+    (void)CP23_Window(&win);
+    memset(cp23lfs_lookaheadBuffer, 0, sizeof(cp23lfs_lookaheadBuffer));
+    memset(cp23lfs_state.usedMap, 0, sizeof(cp23lfs_state.usedMap));
+    err = lfs_fs_traverse(&cp23lfs, CP23_WearUsedCb, NULL);
+    if (err)
+    {
+        win.size = 0u;                                              /* Rescanned by the next allocation */
+        (void)CP23_Window(&win);
+    }
+    cp23lfs_state.usedBlocks = 0;
+    for (cnt = 0 ; cnt < CP23LFS_BLOCK_COUNT ; cnt++)
+    {
+        cp23lfs_state.usedBlocks += (int32_t)((cp23lfs_state.usedMap[cnt / 8u] >> (cnt % 8u)) & 1u);
+    }
+    CP23_UsedSnap();
+    return err;
+}
+
+
+/**
+  * @brief Reads, and optionally sets, the LFS allocation window.
+  * 
+  * The window state is private to LFS: this is the only function accessing it, written for
+  * littlefs v2.9 (lfs_alloc, lfs_alloc_scan, lfs_alloc_ckpoint). It relies on these lfs_t fields:
+  *  - lookahead.start: block of bit 0 of the window bitmap (block = (start + offset) % block_count).
+  *  - lookahead.next: offset of the next bit lfs_alloc tests. lfs_alloc only moves it forward and
+  *    returns the clear bits it passes, so every clear bit below it was allocated.
+  *  - lookahead.size: bits of the window. lfs_alloc calls lfs_alloc_scan once next reaches it,
+  *    which moves start to start + next, clears the bitmap and traverses the file system.
+  *    A size of 0 (lfs_alloc_drop, failed scan) makes the next allocation rescan.
+  *  - lookahead.ckpoint: blocks lfs_alloc may pass before LFS_ERR_NOSPC, reset to block_count by
+  *    lfs_alloc_ckpoint at the start of each operation. Set to block_count here too.
+  * lookahead.buffer is not changed: it is the configuration lookahead buffer
+  * (cp23lfs_lookaheadBuffer), read and marked directly. The version guard stops the build on
+  * another LFS version, until these fields are checked against it.
+  * 
+  * @param set The new window (checkpointed: no allocation is in flight between two LFS calls),
+  *            NULL to read it only.
+  * @return The window.
+  */
+static CP23_Window_t CP23_Window(const CP23_Window_t *set)
+{
+#if LFS_VERSION != 0x00020009
+#error "CP23_Window accesses the lfs_t lookahead state of littlefs v2.9: check it against this LFS version"
+#endif
+    if (set)
+    {
+        cp23lfs.lookahead.start = set->start;
+        cp23lfs.lookahead.next = set->next;
+        cp23lfs.lookahead.size = set->size;
+        cp23lfs.lookahead.ckpoint = CP23LFS_BLOCK_COUNT;
+    }
+    return (CP23_Window_t){cp23lfs.lookahead.start, cp23lfs.lookahead.next, cp23lfs.lookahead.size};
+}
+
+
+/**
+  * @brief Checks if a block of the allocation window (offset from the window start) is free.
+  */
+static bool CP23_WearIsFree(uint32_t off)
+{
+    return ((((uint8_t const *)cp23lfs_lookaheadBuffer)[off / 8u] & (1u << (off % 8u))) == 0u);
+}
+
+
+/**
+  * @brief Marks a block of the allocation window (offset from the window start) in use.
+  * 
+  * The window as counted (see CP23_UsedSync) is marked too: the block is skipped, not allocated.
+  */
+static void CP23_WearMark(uint32_t off)
+{
+    ((uint8_t *)cp23lfs_lookaheadBuffer)[off / 8u] |= (uint8_t)(1u << (off % 8u));
+    cp23lfs_state.usedAhead[off / 8u] |= (uint8_t)(1u << (off % 8u));
+}
+
+
+/**
+  * @brief Traverse callback of CP23_WearFill: marks a block in use in the allocation window and in the blocks in use.
+  */
+static int CP23_WearUsedCb(void *data, lfs_block_t block)
+{
+    (void)data;
+    CP23_WearMark((block + CP23LFS_BLOCK_COUNT - CP23_Window(NULL).start) % CP23LFS_BLOCK_COUNT);
+    (void)CP23_UsedCountCb(cp23lfs_state.usedMap, block);
+    return 0;
+}
+
+
+/**
+  * @brief Tree walk callback of cp23lfs_wear_level: selects the file on the least worn blocks.
+  * 
+  * Only closed files fitting the budget, and much less worn than the free blocks, are selected.
+  */
+static int CP23_WearLevelCb(void *data, const char *path, const struct lfs_info *info)
+{
+    CP23_WearLevel_t *wl = (CP23_WearLevel_t *)data;
+    uint32_t blocks = CP23_FileBlocks(info->size);
+    uint32_t sum = 0u;
+    uint32_t mean;
+    int err;
+
+    if ((blocks == 0u) || (blocks > wl->budget) || ((blocks + CP23LFS_WEAR_KEEP) > wl->freeNum) || (CP23_FileIsOpen(path)))
+    {
+        return 0;
+    }
+    err = CP23_SysOpen(path, LFS_O_RDONLY, &cp23lfs_idxCfg);
+    if (err)
+    {
+        return err;
+    }
+    if ((cp23lfs_idxFile.flags & LFS_F_INLINE) == 0u)
+    {
+        err = CP23_CtzWear(cp23lfs_idxFile.ctz.head, cp23lfs_idxFile.ctz.size, &sum);
+    }
+    (void)CP23_SysClose();
+    mean = sum / blocks;
+    if ((err == 0) && ((mean + CP23LFS_WEAR_STATIC) <= wl->freeMean) && ((wl->blocks == 0u) || (mean < wl->mean)))
+    {
+        wl->mean = mean;
+        wl->blocks = blocks;
+        strcpy(wl->path, path);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Rewrites a file (data and attributes) on new blocks.
+  * 
+  * The copy is written in the CP23 system directory and renamed over the file, so a reset
+  * leaves either the original file or the copy. The CP23 attributes are written with the copy,
+  * the custom ones by CP23_WearMoveAttrs.
+  */
+static int CP23_WearMove(const char *path)
+{
+    cp23lfs_file_t src = CP23_GetFileStructure(true);
+    struct lfs_attr attrs[CP23LFS_ATTR_NUM + 2u];
+    cp23lfs_tindexEntry_t tindex[CP23LFS_TINDEX_MAX];
+    struct lfs_file_config srcCfg;
+    struct lfs_file_config dstCfg = {.buffer = cp23lfs_idxBuffer, .attrs = attrs, .attr_count = 0u};
+    uint8_t chunk[CP23LFS_WEAR_COPY];
+    lfs_ssize_t res;
+    uint32_t cnt;
+    int err;
+
+    if (src == NULL)
+    {
+        return LFS_ERR_NOMEM;
+    }
+    /* Copy the stored CP23 attributes (the generation too: the file is unchanged) */
+    for (cnt = 0 ; cnt <= CP23LFS_ATTR_GEN ; cnt++)
+    {
+        attrs[dstCfg.attr_count].type = (uint8_t)cnt;
+        attrs[dstCfg.attr_count].buffer = (cnt == CP23LFS_ATTR_TINDEX) ? (void *)tindex : 
+                                          src->system.descr[(cnt < CP23LFS_ATTR_NUM) ? cnt : CP23LFS_ATTR_NUM].buffer;
+        res = lfs_getattr(&cp23lfs, path, (uint8_t)cnt, attrs[dstCfg.attr_count].buffer, 
+                          (cnt == CP23LFS_ATTR_TINDEX) ? sizeof(tindex) : src->system.descr[(cnt < CP23LFS_ATTR_NUM) ? cnt : CP23LFS_ATTR_NUM].size);
+        if (res >= 0)
+        {
+            attrs[dstCfg.attr_count++].size = (lfs_size_t)res;
+        }
+    }
+    srcCfg = (struct lfs_file_config){.buffer = src->system.buffer};
+    err = lfs_file_opencfg(&cp23lfs, &(src->system.file), path, LFS_O_RDONLY, &srcCfg);
+    if (err == 0)
+    {
+        err = CP23_SysOpen(CP23LFS_WEAR_TMP, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC, &dstCfg);
+        if (err == 0)
+        {
+            while ((res = lfs_file_read(&cp23lfs, &(src->system.file), chunk, sizeof(chunk))) > 0)
+            {
+                res = lfs_file_write(&cp23lfs, &cp23lfs_idxFile, chunk, (lfs_size_t)res);
+                if (res < 0)
+                {
+                    break;
+                }
+            }
+            err = CP23_SysClose();
+            err = (res < 0) ? (int)res : err;
+        }
+        (void)lfs_file_close(&cp23lfs, &(src->system.file));
+    }
+    if (err == 0)
+    {
+        err = CP23_WearMoveAttrs(path, src->system.buffer);
+    }
+    CP23_ReleaseFileStructure(src);
+    if (err == 0)
+    {
+        err = CP23_Rename(CP23LFS_WEAR_TMP, path);
+    }
+    if (err)
+    {
+        (void)CP23_Remove(CP23LFS_WEAR_TMP);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Copies the custom attributes (types over CP23LFS_ATTR_GEN) of a file to its relocation copy.
+  * 
+  * LFS cannot list the attributes of a file: every custom type is probed. The attributes are
+  * copied one at a time through the scratch buffer (a file cache, CP23LFS_CACHE_SIZE bytes, the
+  * largest custom attribute accepted by cp23lfs_setattr).
+  * @return 0, or an error (the move is given up: no attribute is lost).
+  */
+static int CP23_WearMoveAttrs(const char *path, uint8_t *scratch)
+{
+    lfs_ssize_t res;
+    uint32_t type;
+    int err = 0;
+
+    for (type = CP23LFS_ATTR_GEN + 1u ; (type <= 0xFFu) && (err == 0) ; type++)
+    {
+        res = lfs_getattr(&cp23lfs, path, (uint8_t)type, scratch, CP23LFS_CACHE_SIZE);
+        if (res > (lfs_ssize_t)CP23LFS_CACHE_SIZE)
+        {
+            err = LFS_ERR_NOSPC;                                    /* Stored before the size check of cp23lfs_setattr */
+        }
+        else if (res >= 0)
+        {
+            err = lfs_setattr(&cp23lfs, CP23LFS_WEAR_TMP, (uint8_t)type, scratch, (lfs_size_t)res);
+        }
+        else if (res != LFS_ERR_NOATTR)
+        {
+            err = (int)res;
+        }
+    }
+    return err;
+}
+
+
+/**
+  * @brief Sums the erase counts of the blocks of a file (CTZ skip-list, see CP23_FileBlocks).
+  */
+static int CP23_CtzWear(lfs_block_t head, lfs_size_t size, uint32_t *sum)
+{
+    uint32_t index = CP23_CtzIndex(size);
+    lfs_block_t block = head;
+    int err = 0;
+
+    while ((block < CP23LFS_BLOCK_COUNT) && (err == 0))
+    {
+        *sum += IS25LP080D_GetEraseCount(block);
+        if (index-- == 0u)
+        {
+            return 0;
+        }
+        err = CP23_CtzPrev(&block);
+    }
+    return (err) ? err : LFS_ERR_CORRUPT;
+}
+
+
+/**
+  * @brief Returns the CTZ skip-list head of an open file (CP23_CTZ_NONE for inline and empty files).
+  */
+static lfs_block_t CP23_CtzHead(const lfs_file_t *file)
+{
+    return (((file->flags & LFS_F_INLINE) == 0u) && (file->ctz.size > 0u)) ? file->ctz.head : CP23_CTZ_NONE;
+}
+
+
+/**
+  * @brief Reads the CTZ skip-list of a file (through the system file).
+  * @param path The file (normalized).
+  * @param head The head block (CP23_CTZ_NONE for inline and empty files).
+  * @param size The list size (0 for inline and empty files).
+  * @retval LFS_ERR_ISDIR for a directory, LFS_ERR_NOENT for a missing entry.
+  */
+static int CP23_CtzGet(const char *path, lfs_block_t *head, lfs_size_t *size)
+{
+    int err = CP23_SysOpen(path, LFS_O_RDONLY, &cp23lfs_idxCfg);
+
+    *head = CP23_CTZ_NONE;
+    *size = 0u;
+    if (err == 0)
+    {
+        *head = CP23_CtzHead(&cp23lfs_idxFile);
+        *size = (*head != CP23_CTZ_NONE) ? cp23lfs_idxFile.ctz.size : 0u;
+        err = CP23_SysClose();
+    }
+    return err;
+}
+
+
+/**
+  * @brief Returns the index of the head block of a CTZ skip-list (lfs_ctz_index).
+  * 
+  * Block 0 holds block_size data bytes, block n also stores ctz(n) + 1 back pointers.
+  */
+static uint32_t CP23_CtzIndex(lfs_size_t size)
+{
+    lfs_off_t off = (size > 0u) ? (size - 1u) : 0u;
+    lfs_off_t index = off / (CP23LFS_BLOCK_SIZE - 8u);
+
+    if (index)
+    {
+        index = (off - (4u * (lfs_popc(index - 1u) + 2u))) / (CP23LFS_BLOCK_SIZE - 8u);
+    }
+    return index;
+}
+
+
+/**
+  * @brief Steps back a CTZ skip-list: block n starts with the address of block n - 1.
+  */
+static int CP23_CtzPrev(lfs_block_t *block)
+{
+    uint32_t prev;
+    int err;
+
+    if (*block >= CP23LFS_BLOCK_COUNT)
+    {
+        return LFS_ERR_CORRUPT;
+    }
+    err = CP23_BlockRead(&cp23lfs_cfg, *block, 0u, &prev, sizeof(prev));
+    *block = lfs_fromle32(prev);
+    return err;
+}
+
+
+/**
+  * @brief Collects the blocks of a CTZ skip-list that a newer list of the same file does not use.
+  * 
+  * A rewrite keeps the blocks before the first one it changes (appends copy the last partial block):
+  * the newer list is walked back to the index of the older head, then both are walked back together
+  * until they meet. Only the blocks that differ are read.
+  * @param head The older list head.
+  * @param size The older list size (0: none).
+  * @param newHead The newer list head.
+  * @param newSize The newer list size (0: none, all the older blocks are collected).
+  * @param set The collected blocks (bitmap of the memory blocks).
+  */
+static int CP23_CtzCollect(lfs_block_t head, lfs_size_t size, lfs_block_t newHead, lfs_size_t newSize, uint8_t set[])
+{
+    uint32_t index = CP23_CtzIndex(size);
+    uint32_t newIndex = CP23_CtzIndex(newSize);
+    int err = 0;
+
+    if (size == 0u)
+    {
+        return 0;
+    }
+    while ((newSize > 0u) && (newIndex > index) && (err == 0))
+    {
+        err = CP23_CtzPrev(&newHead);
+        newIndex--;
+    }
+    while (err == 0)
+    {
+        if ((newSize > 0u) && (newIndex == index) && (newHead == head))
+        {
+            return 0;                                               /* Shared back to the first block */
+        }
+        if (head >= CP23LFS_BLOCK_COUNT)
+        {
+            return LFS_ERR_CORRUPT;
+        }
+        set[head / 8u] |= (uint8_t)(1u << (head % 8u));
+        if (index == 0u)
+        {
+            return 0;
+        }
+        if ((newSize > 0u) && (newIndex == index))
+        {
+            err = CP23_CtzPrev(&newHead);
+            newIndex--;
+        }
+        err = (err) ? err : CP23_CtzPrev(&head);
+        index--;
+    }
+    return err;
+}
+
+
+/**
+  * @brief Checks if a file (normalized path) is open.
+  */
+static bool CP23_FileIsOpen(const char *path)
+{
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
+    {
+        if ((cp23lsf_file[cnt].system.allocated) && (strcmp(cp23lsf_file[cnt].system.path, path) == 0))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+  * @brief FNV-1a hash of the attributes of an open file (generation excluded), to detect their changes.
+  */
+static uint32_t CP23_AttrHash(cp23lfs_file_t file)
+{
+    uint32_t hash = 2166136261u;
+    uint32_t cnt;
+    uint32_t idx;
+
+    for (cnt = 0 ; cnt < CP23LFS_ATTR_NUM ; cnt++)
+    {
+        for (idx = 0 ; idx < file->system.descr[cnt].size ; idx++)
+        {
+            hash ^= ((uint8_t const *)(file->system.descr[cnt].buffer))[idx];
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+
+/**
+  * @brief FNV-1a hash of a string attribute (stops at the terminator or at size bytes).
+  */
+static uint32_t CP23_KeyHash(const uint8_t *key, uint32_t size)
+{
+    uint32_t hash = 2166136261u;
+
+    while ((size--) && (*key))
+    {
+        hash ^= *key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/**
+  * @brief Normalizes a path: "/" separated names with a leading separator, no ".", ".." or empty names.
+  * 
+  * The root directory is the empty string.
+  * @return false if the path does not fit CP23LFS_PATH_MAX.
+  */
+static bool CP23_PathNormalize(char *dst, const char *src)
+{
+    uint32_t len = 0u;
+    uint32_t nameLen;
+
+    dst[0] = '\0';
+    while (*src)
+    {
+        while (*src == '/')
+        {
+            src++;
+        }
+        for (nameLen = 0u ; (src[nameLen] != '\0') && (src[nameLen] != '/') ; nameLen++)
+        {
+        }
+        if ((nameLen == 2u) && (src[0] == '.') && (src[1] == '.'))
+        {
+            CP23_PathParent(dst);
+            len = strlen(dst);
+        }
+        else if ((nameLen > 0u) && ((nameLen != 1u) || (src[0] != '.')))
+        {
+            if ((len + nameLen + 2u) > CP23LFS_PATH_MAX)
+            {
+                return false;
+            }
+            dst[len++] = '/';
+            memcpy(&dst[len], src, nameLen);
+            len += nameLen;
+            dst[len] = '\0';
+        }
+        src += nameLen;
+    }
+    return true;
+}
+
+
+/**
+  * @brief Appends an entry name to a path ("dir" + "name" = "dir/name").
+  * @return false if the resulting path does not fit CP23LFS_PATH_MAX (path unchanged).
+  */
+static bool CP23_PathAppend(char *path, const char *name)
+{
+    uint32_t len = strlen(path);
+    uint32_t nameLen = strlen(name);
+
+    if ((len + nameLen + 2u) > CP23LFS_PATH_MAX)
+    {
+        return false;
+    }
+    path[len] = '/';
+    memcpy(&path[len + 1u], name, nameLen + 1u);
+    return true;
+}
+
+
+/**
+  * @brief Removes the last entry name from a path ("dir/name" = "dir").
+  */
+static void CP23_PathParent(char *path)
+{
+    char *sep = strrchr(path, '/');
+
+    if (sep)
+    {
+        *sep = '\0';
+    }
+    else
+    {
+        path[0] = '\0';
+    }
+}
+
+
+/**
+  * @brief Checks if a normalized path is the CP23 system directory or an entry below it.
+  */
+static bool CP23_PathIsSys(const char *path)
+{
+    uint32_t len = sizeof(CP23LFS_SYS_DIR) - 1u;
+
+    return ((strncmp(path, CP23LFS_SYS_DIR, len) == 0) && ((path[len] == '\0') || (path[len] == '/')));
+}
+
+
+/**
+  * @brief Gets a file structure from the pool, waiting up to the timeout if the pool is exhausted.
+  */
+static cp23lfs_file_t CP23_PoolWait(uint32_t timeout, uint8_t priority)
+{
+    cp23lfs_file_t retVal = CP23_GetFileStructure(true);
+    CP23_Waiter_t *waiter = NULL;
+    uint8_t waiters = 0u;
+    uint32_t cnt;
+
+    if (retVal != NULL)
+    {
+        return retVal;
+    }
+    cp23lfs_state.pool.exhausted++;
+    if ((timeout == 0u) || (cp23lfs_state.poolWait == NULL))
+    {
+        return NULL;
+    }
+    for (cnt = 0 ; cnt < CP23LFS_WAITERS_MAX ; cnt++)
+    {
+        if (!cp23lfs_state.waiter[cnt].used && (waiter == NULL))
+        {
+            waiter = &(cp23lfs_state.waiter[cnt]);
+            *waiter = (CP23_Waiter_t){.used = true, .granted = false, .priority = priority, .seq = cp23lfs_state.waitSeq++};
+        }
+        waiters += (cp23lfs_state.waiter[cnt].used) ? 1u : 0u;
+    }
+    if (waiter == NULL)
+    {
+        return NULL;
+    }
+    cp23lfs_state.pool.waits++;
+    cp23lfs_state.pool.waitersPeak = (waiters > cp23lfs_state.pool.waitersPeak) ? waiters : cp23lfs_state.pool.waitersPeak;
+    /* The file system lock is released while blocked, so the closes of the other tasks can wake the waiter */
+    IS25LP080D_ReadStop();
+    if (cp23lfs_state.unlock)
+    {
+        cp23lfs_state.unlock();
+    }
+    (void)cp23lfs_state.poolWait((uint8_t)(waiter - cp23lfs_state.waiter), timeout);
+    if (cp23lfs_state.lock)
+    {
+        cp23lfs_state.lock();
+    }
+    /* A structure reserved while timing out is taken anyway */
+    if (waiter->granted)
+    {
+        cp23lfs_state.poolReserved--;
+        retVal = CP23_GetFileStructure(true);
+    }
+    else
+    {
+        cp23lfs_state.pool.timeouts++;
+    }
+    waiter->used = false;
+    return retVal;
+}
+
+
+/**
+  * @brief Returns the file structures (with a cache if required) not reserved to the woken waiters.
+  */
+static uint32_t CP23_PoolAvailable(bool cache)
+{
+    uint32_t retVal = CP23LFS_FILES_MAX - cp23lfs_state.filesUsed;
+
+    if (cache && ((CP23LFS_CACHES_MAX - cp23lfs_state.cachesUsed) < retVal))
+    {
+        retVal = CP23LFS_CACHES_MAX - cp23lfs_state.cachesUsed;
+    }
+    return (retVal > cp23lfs_state.poolReserved) ? (retVal - cp23lfs_state.poolReserved) : 0u;
+}
+
+
+/**
+  * @brief Opens a file read-only sharing the open state of a read-only open of the same file.
+  * 
+  * Returns NULL if the file is not open read-only, or if no file structure is available.
+  */
+static cp23lfs_file_t CP23_FileShare(const char *path)
+{
+    char npath[CP23LFS_PATH_MAX];
+    cp23lfs_file_t holder = NULL;
+    cp23lfs_file_t retVal;
+    uint32_t cnt;
+
+    if (!CP23_PathNormalize(npath, path))
+    {
+        return NULL;
+    }
+    for (cnt = 0 ; (cnt < CP23LFS_FILES_MAX) && (holder == NULL) ; cnt++)
+    {
+        if ((cp23lsf_file[cnt].system.allocated) && (cp23lsf_file[cnt].system.holder == cnt) && 
+            (!cp23lsf_file[cnt].system.outdated) && ((cp23lsf_file[cnt].system.file.flags & LFS_O_RDWR) == LFS_O_RDONLY) &&
+            (strcmp(cp23lsf_file[cnt].system.path, npath) == 0))
+        {
+            holder = &(cp23lsf_file[cnt]);
+        }
+    }
+    retVal = (holder) ? CP23_GetFileStructure(false) : NULL;
+    if (retVal == NULL)
+    {
+        return NULL;
+    }
+    /* Attributes and commit state of the held file */
+    memcpy(retVal, holder, offsetof(cp23lfs_fileStructure_t, system));
+    memcpy(retVal->system.path, holder->system.path, sizeof(retVal->system.path));
+    memcpy(retVal->system.idxKey, holder->system.idxKey, sizeof(retVal->system.idxKey));
+    retVal->system.indexed = holder->system.indexed;
+    retVal->system.commitSize = holder->system.commitSize;
+    retVal->system.commitHead = holder->system.commitHead;
+    retVal->system.commitGroup = holder->system.commitGroup;
+    retVal->system.generation = holder->system.generation;
+    retVal->system.holder = (uint8_t)(holder - cp23lsf_file);
+    retVal->system.pos = 0u;
+    if (holder->system.users == 0u)
+    {
+        holder->system.pos = (uint32_t)lfs_file_tell(&cp23lfs, &(holder->system.file));
+    }
+    holder->system.users++;
+    return retVal;
+}
+
+
+/**
+  * @brief Returns the LFS file of a file structure (the held file for shared opens).
+  */
+static lfs_file_t *CP23_LfsFile(cp23lfs_file_t file)
+{
+    return &(cp23lsf_file[file->system.holder].system.file);
+}
+
+
+/**
+  * @brief Returns true if the open state of a file is shared (positions kept by each file structure).
+  */
+static bool CP23_FileShared(cp23lfs_file_t file)
+{
+    return (cp23lsf_file[file->system.holder].system.users > 0u);
+}
+
+
+/**
+  * @brief Stops sharing the read-only opens of a file (normalized path), or of the files below a directory.
+  * 
+  * The opens keep reading the content they opened until their close; the next opens read the
+  * file as changed by a commit, a rename or a removal.
+  */
+static void CP23_FileOutdate(const char *path)
+{
+    uint32_t len = strlen(path);
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_FILES_MAX ; cnt++)
+    {
+        if ((cp23lsf_file[cnt].system.allocated) && (cp23lsf_file[cnt].system.holder == cnt) &&
+            (strncmp(cp23lsf_file[cnt].system.path, path, len) == 0) &&
+            ((cp23lsf_file[cnt].system.path[len] == '\0') || (cp23lsf_file[cnt].system.path[len] == '/')))
+        {
+            cp23lsf_file[cnt].system.outdated = true;
+        }
+    }
+}
+
+
+/**
+  * @brief Ends a file system call: releases the chip select left asserted by a continued read
+  *        (IS25LP080D_SetReadContinuation), so the bus is never held between two calls, and
+  *        records the call span.
+  */
+static void CP23_CallEnd(const char *name, uint32_t start)
+{
+    CP23_UsedSync();                                                /* Blocks allocated by the call */
+    IS25LP080D_ReadStop();
+    IS25LP080D_TraceEnd(name, start);
+}
+
+
+/**
+  * @brief Writes back a changed page of a map.
+  */
+static int CP23_MapWrite(cp23lfs_map_t *map, uint32_t idx)
+{
+    uint32_t size = map->end - map->page[idx].off;                  /* Page up to the file end */
+    lfs_ssize_t res;
+
+    size = (size < CP23LFS_MAP_PAGE) ? size : CP23LFS_MAP_PAGE;
+    res = cp23lfs_file_seek(map->file, (lfs_soff_t)(map->page[idx].off), LFS_SEEK_SET);
+    if (res >= 0)
+    {
+        res = cp23lfs_file_write(map->file, &(map->pages[idx * CP23LFS_MAP_PAGE]), size);
+    }
+    if (res < 0)
+    {
+        return (int)res;
+    }
+    if ((uint32_t)res != size)
+    {
+        return LFS_ERR_NOSPC;
+    }
+    map->page[idx].dirty = false;
+    return 0;
+}
+
+
+/**
+  * @brief Finds the pin of a file (normalized path).
+  * @return The pin entry, CP23_PIN_NONE if the file is not pinned.
+  */
+static uint32_t CP23_PinFind(const char *path)
+{
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_PINS_MAX ; cnt++)
+    {
+        if ((cp23lfs_state.pinned[cnt].used) && (!cp23lfs_state.pinned[cnt].stale) && 
+            (strcmp((const char *)&(cp23lfs_state.pinBuffer[cp23lfs_state.pinned[cnt].off]), path) == 0))
+        {
+            return cnt;
+        }
+    }
+    return CP23_PIN_NONE;
+}
+
+
+/**
+  * @brief Pins a file (normalized path).
+  */
+static int CP23_PinAdd(const char *path)
+{
+    uint32_t idx = CP23_PinFind(path);
+    uint32_t cnt;
+    int err;
+
+    if (idx != CP23_PIN_NONE)
+    {
+        return 0;                                                   /* Already pinned */
+    }
+    for (cnt = 0 ; (cnt < CP23LFS_PINS_MAX) && (idx == CP23_PIN_NONE) ; cnt++)
+    {
+        idx = (cp23lfs_state.pinned[cnt].used) ? idx : cnt;
+    }
+    if (idx == CP23_PIN_NONE)
+    {
+        return LFS_ERR_NOSPC;
+    }
+    err = CP23_PinLoad(idx, path);
+    if (err == 0)
+    {
+        cp23lfs_state.pinned[idx].used = true;
+        cp23lfs_state.pinStats.pins++;
+    }
+    return err;
+}
+
+
+/**
+  * @brief Loads a file (normalized path) at the end of the pin RAM: path, attributes (public part
+  * of the file structure) and content.
+  */
+static int CP23_PinLoad(uint32_t idx, const char *path)
+{
+    struct lfs_attr attrs[CP23LFS_ATTR_NUM + 1u];
+    struct lfs_file_config const cfg = {.buffer = cp23lfs_idxBuffer, .attrs = attrs, .attr_count = CP23LFS_ATTR_NUM + 1u};
+    CP23_Pin_t *pin = &(cp23lfs_state.pinned[idx]);
+    uint32_t pathLen = strlen(path) + 1u;
+    struct lfs_info info;
+    uint8_t *region;
+    lfs_ssize_t res;
+    uint32_t len = 0u;
+    uint32_t cnt;
+    int err = lfs_stat(&cp23lfs, path, &info);
+
+    if ((err == 0) && (info.type != LFS_TYPE_REG))
+    {
+        err = LFS_ERR_ISDIR;
+    }
+    if ((err == 0) && (info.size > cp23lfs_state.pinPolicy.maxFile))
+    {
+        err = LFS_ERR_FBIG;
+    }
+    if (err == 0)
+    {
+        len = pathLen + CP23_PIN_ATTRS + info.size;
+        err = ((info.size > cp23lfs_state.pinStats.budget) || (len > (cp23lfs_state.pinStats.budget - cp23lfs_state.pinStats.used))) ? LFS_ERR_NOSPC : 0;
+    }
+    if (err)
+    {
+        return err;
+    }
+    region = &(cp23lfs_state.pinBuffer[cp23lfs_state.pinStats.used]);
+    memcpy(region, path, pathLen);
+    memset(&(region[pathLen]), 0, CP23_PIN_ATTRS);
+    for (cnt = 0 ; cnt < CP23LFS_ATTR_NUM ; cnt++)
+    {
+        attrs[cnt].type = cnt;
+        attrs[cnt].buffer = &(region[pathLen + cp23lfs_attrOffset[cnt]]);
+        attrs[cnt].size = cp23lfs_attrSize[cnt];
+    }
+    pin->generation = 0u;
+    attrs[CP23LFS_ATTR_NUM].type = CP23LFS_ATTR_GEN;
+    attrs[CP23LFS_ATTR_NUM].buffer = &(pin->generation);
+    attrs[CP23LFS_ATTR_NUM].size = sizeof(pin->generation);
+    err = CP23_SysOpen(path, LFS_O_RDONLY, &cfg);
+    if (err == 0)
+    {
+        res = lfs_file_read(&cp23lfs, &cp23lfs_idxFile, &(region[len - info.size]), info.size);
+        err = CP23_SysClose();
+        err = (res < 0) ? (int)res : (((uint32_t)res != info.size) ? LFS_ERR_CORRUPT : err);
+    }
+    if (err == 0)
+    {
+        pin->off = cp23lfs_state.pinStats.used;
+        pin->len = len;
+        pin->size = info.size;
+        cp23lfs_state.pinStats.used += len;
+        cp23lfs_state.pinStats.loads++;
+    }
+    return err;
+}
+
+
+/**
+  * @brief Releases the pin RAM region of an entry (the following regions move down).
+  */
+static void CP23_PinFree(uint32_t idx)
+{
+    CP23_Pin_t *pin = &(cp23lfs_state.pinned[idx]);
+    uint32_t end = pin->off + pin->len;
+    uint32_t cnt;
+
+    if (pin->len)
+    {
+        memmove(&(cp23lfs_state.pinBuffer[pin->off]), &(cp23lfs_state.pinBuffer[end]), cp23lfs_state.pinStats.used - end);
+        for (cnt = 0 ; cnt < CP23LFS_PINS_MAX ; cnt++)
+        {
+            if ((cp23lfs_state.pinned[cnt].used) && (cp23lfs_state.pinned[cnt].len) && (cp23lfs_state.pinned[cnt].off >= end))
+            {
+                cp23lfs_state.pinned[cnt].off -= pin->len;
+            }
+        }
+        cp23lfs_state.pinStats.used -= pin->len;
+    }
+    pin->off = 0u;
+    pin->len = 0u;
+    pin->size = 0u;
+}
+
+
+/**
+  * @brief Unpins an entry: freed now, or at the close of its last pinned open.
+  */
+static void CP23_PinRelease(uint32_t idx)
+{
+    cp23lfs_state.pinStats.pins--;
+    if (cp23lfs_state.pinned[idx].users == 0u)
+    {
+        CP23_PinFree(idx);
+        cp23lfs_state.pinned[idx].used = false;
+    }
+    else
+    {
+        cp23lfs_state.pinned[idx].stale = true;
+    }
+}
+
+
+/**
+  * @brief Reloads the pinned copy of a changed file (normalized path).
+  * 
+  * With pinned opens, the new copy is loaded in a new entry and region first: the opens keep
+  * reading the old copy, freed at their last close (see CP23_PinRelease). Without, the copy is
+  * reloaded in place. A file no longer fitting the policy, the pin RAM or the pin entries is
+  * unpinned: its next opens read the memory.
+  */
+static void CP23_PinRefresh(const char *path)
+{
+    uint32_t idx = CP23_PinFind(path);
+    uint32_t next = CP23_PIN_NONE;
+    uint32_t cnt;
+
+    if (idx == CP23_PIN_NONE)
+    {
+        return;
+    }
+    if (cp23lfs_state.pinned[idx].users == 0u)
+    {
+        CP23_PinFree(idx);
+        if (CP23_PinLoad(idx, path) != 0)
+        {
+            CP23_PinRelease(idx);
+        }
+        return;
+    }
+    for (cnt = 0 ; (cnt < CP23LFS_PINS_MAX) && (next == CP23_PIN_NONE) ; cnt++)
+    {
+        next = (cp23lfs_state.pinned[cnt].used) ? next : cnt;
+    }
+    if ((next != CP23_PIN_NONE) && (CP23_PinLoad(next, path) == 0))
+    {
+        cp23lfs_state.pinned[next].used = true;
+        cp23lfs_state.pinStats.pins++;
+    }
+    CP23_PinRelease(idx);                                           /* Old copy kept for its opens */
+}
+
+
+/**
+  * @brief Unpins a file (normalized path), or the files below a directory.
+  */
+static void CP23_PinDrop(const char *path)
+{
+    uint32_t len = strlen(path);
+    const char *pinPath;
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < CP23LFS_PINS_MAX ; cnt++)
+    {
+        if ((!cp23lfs_state.pinned[cnt].used) || (cp23lfs_state.pinned[cnt].stale))
+        {
+            continue;
+        }
+        pinPath = (const char *)&(cp23lfs_state.pinBuffer[cp23lfs_state.pinned[cnt].off]);
+        if ((strncmp(pinPath, path, len) == 0) && ((pinPath[len] == '\0') || (pinPath[len] == '/')))
+        {
+            CP23_PinRelease(cnt);
+        }
+    }
+}
+
+
+/**
+  * @brief Opens a pinned file read-only (no memory access).
+  * @return The file structure, NULL if the file is not pinned or no structure is available.
+  */
+static cp23lfs_file_t CP23_PinOpen(const char *path)
+{
+    char npath[CP23LFS_PATH_MAX];
+    cp23lfs_file_t retVal;
+    CP23_Pin_t *pin;
+    uint32_t idx;
+
+    if ((cp23lfs_state.pinStats.pins == 0u) || (!CP23_PathNormalize(npath, path)))
+    {
+        return NULL;
+    }
+    idx = CP23_PinFind(npath);
+    retVal = (idx != CP23_PIN_NONE) ? CP23_GetFileStructure(false) : NULL;
+    if (retVal == NULL)
+    {
+        return NULL;
+    }
+    pin = &(cp23lfs_state.pinned[idx]);
+    memcpy(retVal, &(cp23lfs_state.pinBuffer[pin->off + strlen(npath) + 1u]), CP23_PIN_ATTRS);
+    retVal->size = pin->size;
+    memcpy(retVal->system.path, npath, sizeof(retVal->system.path));
+    CP23_IndexKeys(retVal, retVal->system.idxKey);
+    retVal->system.indexed = true;
+    retVal->system.commitSize = pin->size;
+    retVal->system.commitHead = CP23_CTZ_NONE;                      /* Read-only */
+    retVal->system.commitGroup = (CP23_PathIsSys(npath)) ? CP23_QUOTA_NONE : LfsOwnerGroup(retVal->flags);
+    retVal->system.generation = pin->generation;
+    retVal->system.pin = (uint8_t)(idx + 1u);
+    pin->users++;
+    cp23lfs_state.pinStats.hits++;
+    return retVal;
+}
+
+
+/**
+  * @brief Closes a pinned open (frees the entry unpinned while open at its last close).
+  */
+static void CP23_PinClose(cp23lfs_file_t file)
+{
+    CP23_Pin_t *pin = &(cp23lfs_state.pinned[file->system.pin - 1u]);
+
+    pin->users--;
+    if ((pin->stale) && (pin->users == 0u))
+    {
+        CP23_PinFree(file->system.pin - 1u);
+        pin->used = false;
+        pin->stale = false;
+    }
+    CP23_ReleaseFileStructure(file);
+}
+
+
+/**
+  * @brief Reads a pinned open from the pin RAM.
+  */
+static lfs_ssize_t CP23_PinRead(cp23lfs_file_t file, void *buffer, lfs_size_t size)
+{
+    CP23_Pin_t const *pin = &(cp23lfs_state.pinned[file->system.pin - 1u]);
+    uint32_t avail = (file->system.pos < pin->size) ? (pin->size - file->system.pos) : 0u;
+
+    size = (size < avail) ? size : avail;
+    if (size)
+    {
+        memcpy(buffer, &(cp23lfs_state.pinBuffer[(pin->off + pin->len - pin->size) + file->system.pos]), size);
+    }
+    file->system.pos += size;
+    return (lfs_ssize_t)size;
+}
+
+
+/**
+  * @brief Moves the position of a pinned open.
+  */
+static lfs_soff_t CP23_PinSeek(cp23lfs_file_t file, lfs_soff_t off, int whence)
+{
+    lfs_soff_t pos = off;
+
+    if (whence == LFS_SEEK_CUR)
+    {
+        pos = (lfs_soff_t)(file->system.pos) + off;
+    }
+    else if (whence == LFS_SEEK_END)
+    {
+        pos = (lfs_soff_t)(cp23lfs_state.pinned[file->system.pin - 1u].size) + off;
+    }
+    if (pos < 0)
+    {
+        return LFS_ERR_INVAL;
+    }
+    file->system.pos = (uint32_t)pos;
+    return pos;
+}
+
+
+/**
+  * @brief Counts a read-only open for the automatic pinning (policy autoOpens).
+  */
+static void CP23_PinCount(cp23lfs_file_t file)
+{
+    uint32_t hash;
+    uint32_t idx = 0u;
+    uint32_t cnt;
+
+    if ((cp23lfs_state.pinPolicy.autoOpens == 0u) || (cp23lfs_state.pinStats.budget == 0u) || (file->size > cp23lfs_state.pinPolicy.maxFile))
+    {
+        return;
+    }
+    hash = CP23_KeyHash((uint8_t const *)(file->system.path), CP23LFS_PATH_MAX);
+    hash = (hash) ? hash : 1u;                                      /* 0 marks the free candidates */
+    /* Counted file, or the candidate with the fewest opens */
+    for (cnt = 0 ; cnt < CP23LFS_PINS_MAX ; cnt++)
+    {
+        if (cp23lfs_state.pinCand[cnt].hash == hash)
+        {
+            idx = cnt;
+            break;
+        }
+        if (cp23lfs_state.pinCand[cnt].opens < cp23lfs_state.pinCand[idx].opens)
+        {
+            idx = cnt;
+        }
+    }
+    if (cp23lfs_state.pinCand[idx].hash != hash)
+    {
+        cp23lfs_state.pinCand[idx].hash = hash;
+        cp23lfs_state.pinCand[idx].opens = 0u;
+    }
+    if (++(cp23lfs_state.pinCand[idx].opens) >= cp23lfs_state.pinPolicy.autoOpens)
+    {
+        cp23lfs_state.pinCand[idx].hash = 0u;
+        cp23lfs_state.pinCand[idx].opens = 0u;
+        (void)CP23_PinAdd(file->system.path);                       /* Pinned if it fits the pin RAM */
+    }
+}
+
+
+/**
+  * @brief Removes an entry, frees its blocks (and the metadata pairs dropped from its directory) and unpins it (or the files below it).
+  */
+static int CP23_Remove(const char *path)
+{
+    uint8_t freed[CP23LFS_BLOCK_COUNT / 8u] = {0};
+    uint8_t pairs[CP23LFS_BLOCK_COUNT / 8u];
+    char dirPath[CP23LFS_PATH_MAX];
+    uint32_t num;
+    int err;
+
+    strcpy(dirPath, path);
+    CP23_PathParent(dirPath);
+    CP23_UsedEntry(path, freed);
+    num = CP23_UsedPairs(dirPath, pairs);
+    err = lfs_remove(&cp23lfs, path);
+    if (err == 0)
+    {
+        CP23_UsedDropped(dirPath, pairs, num, freed);
+        CP23_UsedRelease(freed);
+        CP23_PinDrop(path);
+        CP23_FileOutdate(path);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Renames an entry, freeing the blocks of the entry it replaces (and the metadata pairs dropped from its old directory).
+  */
+static int CP23_Rename(const char *oldPath, const char *newPath)
+{
+    uint8_t freed[CP23LFS_BLOCK_COUNT / 8u] = {0};
+    uint8_t pairs[CP23LFS_BLOCK_COUNT / 8u];
+    char dirPath[CP23LFS_PATH_MAX];
+    uint32_t num;
+    int err;
+
+    strcpy(dirPath, oldPath);
+    CP23_PathParent(dirPath);
+    if (strcmp(oldPath, newPath) != 0)
+    {
+        CP23_UsedEntry(newPath, freed);
+    }
+    num = CP23_UsedPairs(dirPath, pairs);
+    err = lfs_rename(&cp23lfs, oldPath, newPath);
+    if (err == 0)
+    {
+        CP23_UsedDropped(dirPath, pairs, num, freed);
+        CP23_UsedRelease(freed);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Removes files of the same directory, several per metadata commit (lfs_remove_files).
+  * 
+  * lfs_remove_files is not part of upstream littlefs: it is added by littlefs_remove_files.patch,
+  * applied on the sources of littlefs.zip.
+  * @param dirPath The directory (normalized).
+  * @param entry The files (lfs_stat or lfs_dir_read information).
+  * @param group The owner groups of the files (read with CP23_QuotaGroup before removing).
+  * @param num The number of files (up to CP23LFS_REMOVE_BATCH).
+  * @param removed The number of files removed (also on error).
+  * 
+  * A file listed twice is removed once. The blocks of the files and the metadata pairs dropped
+  * from the directory are freed (see CP23_UsedEntry).
+  */
+static int CP23_RemoveFiles(const char *dirPath, const struct lfs_info entry[], const uint8_t group[], uint32_t num, uint32_t *removed)
+{
+    const char *names[CP23LFS_REMOVE_BATCH];
+    uint8_t freed[CP23LFS_BLOCK_COUNT / 8u] = {0};
+    uint8_t pairs[CP23LFS_BLOCK_COUNT / 8u];
+    char path[CP23LFS_PATH_MAX];
+    lfs_size_t done;
+    uint32_t first = 0u;
+    uint32_t pairNum;
+    uint32_t cnt;
+    int err = 0;
+
+    for (cnt = 0 ; cnt < num ; cnt++)
+    {
+        names[cnt] = entry[cnt].name;
+        strcpy(path, dirPath);
+        if (CP23_PathAppend(path, entry[cnt].name))
+        {
+            CP23_UsedEntry(path, freed);
+        }
+    }
+    pairNum = CP23_UsedPairs(dirPath, pairs);
+    *removed = 0u;
+    while ((first < num) && (err == 0))
+    {
+        err = lfs_remove_files(&cp23lfs, dirPath, &(names[first]), num - first, &done);
+        for (cnt = first ; cnt < (first + done) ; cnt++)
+        {
+            strcpy(path, dirPath);
+            if (CP23_PathAppend(path, entry[cnt].name))
+            {
+                CP23_PinDrop(path);
+                CP23_FileOutdate(path);
+            }
+            CP23_QuotaRemoved(&(entry[cnt]), group[cnt]);
+        }
+        *removed += done;
+        first += done;
+        if (err == LFS_ERR_NOENT)
+        {
+            err = 0;                                                /* Listed twice: removed by a previous commit */
+            first++;
+        }
+    }
+    if (err == 0)
+    {
+        /* After a failure, the blocks of the files removed are left to the next LFS scan */
+        CP23_UsedDropped(dirPath, pairs, pairNum, freed);
+        CP23_UsedRelease(freed);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Opens a directory (open directories accounted in the RAM footprint).
+  */
+static int CP23_DirOpen(lfs_dir_t *dir, const char *path)
+{
+    int err = lfs_dir_open(&cp23lfs, dir, path);
+
+    if (err == 0)
+    {
+        cp23lfs_state.dirsUsed++;
+        CP23_MemPeak();
+    }
+    return err;
+}
+
+
+/**
+  * @brief Closes a directory opened by CP23_DirOpen.
+  */
+static int CP23_DirClose(lfs_dir_t *dir)
+{
+    cp23lfs_state.dirsUsed--;
+    return lfs_dir_close(&cp23lfs, dir);
+}
+
+
+/**
+  * @brief Opens the system file (system file cache accounted in the RAM footprint).
+  */
+static int CP23_SysOpen(const char *path, int flags, const struct lfs_file_config *cfg)
+{
+    int err;
+
+    cp23lfs_state.sysHead = CP23_CTZ_NONE;
+    if ((flags & LFS_O_TRUNC) && (lfs_file_opencfg(&cp23lfs, &cp23lfs_idxFile, path, LFS_O_RDONLY, cfg) == 0))
+    {
+        /* Blocks of the file, freed by the commit of the truncation */
+        cp23lfs_state.sysHead = CP23_CtzHead(&cp23lfs_idxFile);
+        cp23lfs_state.sysSize = cp23lfs_idxFile.ctz.size;
+        (void)lfs_file_close(&cp23lfs, &cp23lfs_idxFile);
+    }
+    err = lfs_file_opencfg(&cp23lfs, &cp23lfs_idxFile, path, flags, cfg);
+    if ((err == 0) && ((flags & LFS_O_TRUNC) == 0))
+    {
+        cp23lfs_state.sysHead = CP23_CtzHead(&cp23lfs_idxFile);
+        cp23lfs_state.sysSize = cp23lfs_idxFile.ctz.size;
+    }
+    if (err == 0)
+    {
+        cp23lfs_state.sysUsed = 1u;
+        CP23_MemPeak();
+    }
+    return err;
+}
+
+
+/**
+  * @brief Closes the system file opened by CP23_SysOpen (blocks released by its commit freed).
+  */
+static int CP23_SysClose(void)
+{
+    bool write = ((cp23lfs_idxFile.flags & LFS_O_WRONLY) == LFS_O_WRONLY);
+    int err = lfs_file_close(&cp23lfs, &cp23lfs_idxFile);
+
+    cp23lfs_state.sysUsed = 0u;
+    if ((err == 0) && (write) && ((cp23lfs_idxFile.flags & LFS_F_ERRED) == 0u))
+    {
+        CP23_UsedCommit(&(cp23lfs_state.sysHead), cp23lfs_state.sysSize, &cp23lfs_idxFile);
+    }
+    return err;
+}
+
+
+/**
+  * @brief Updates the RAM footprint high-water marks.
+  */
+static void CP23_MemPeak(void)
+{
+    uint8_t caches = cp23lfs_state.cachesUsed + cp23lfs_state.sysUsed;
+
+    cp23lfs_state.filesPeak = (cp23lfs_state.filesUsed > cp23lfs_state.filesPeak) ? cp23lfs_state.filesUsed : cp23lfs_state.filesPeak;
+    cp23lfs_state.dirsPeak = (cp23lfs_state.dirsUsed > cp23lfs_state.dirsPeak) ? cp23lfs_state.dirsUsed : cp23lfs_state.dirsPeak;
+    cp23lfs_state.cachesPeak = (caches > cp23lfs_state.cachesPeak) ? caches : cp23lfs_state.cachesPeak;
+}
+
+
+/**
+  * @brief Records a call in the workload records (see cp23lfs_rec_start).
+  */
+static void CP23_Record(uint8_t call, cp23lfs_file_t file, uint32_t hash, uint32_t arg, uint16_t whence)
+{
+    cp23lfs_rec_t *rec;
+
+    if (cp23lfs_state.rec == NULL)
+    {
+        return;
+    }
+    if (cp23lfs_state.recCount >= cp23lfs_state.recNum)
+    {
+        cp23lfs_state.recLost++;
+        return;
+    }
+    rec = &(cp23lfs_state.rec[cp23lfs_state.recCount++]);
+    rec->time = (cp23lfs_state.recClock) ? cp23lfs_state.recClock() : 0u;
+    rec->hash = hash;
+    rec->arg = arg;
+    rec->whence = whence;
+    rec->call = call;
+    rec->slot = (file) ? (uint8_t)(file - cp23lsf_file) : 0u;
+}
+
+
+/**
+  * @brief Resolves a recorded path hash for the replay ("/rp<hash>" if not resolved).
+  */
+static void CP23_ReplayPath(cp23lfs_replayPath_t resolve, uint32_t hash, char *path)
+{
+    static char const hex[] = "0123456789abcdef";
+    uint32_t len = sizeof("/rp") - 1u;
+    uint32_t cnt;
+
+    if ((resolve) && (resolve(hash, path)))
+    {
+        return;
+    }
+    memcpy(path, "/rp", len);
+    for (cnt = 8u ; cnt > 0u ; cnt--)
+    {
+        path[len++] = hex[(hash >> ((cnt - 1u) * 4u)) & 0x0Fu];
+    }
+    path[len] = '\0';
+}
+
+
+
+/**
+  * @}
+*/
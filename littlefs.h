@@ -1,136 +1,1199 @@
-/** @addtogroup littlefs
-  * @{
-*/
-
-/**
-  *******************************************************************************
-  * @file           : littlefs.h
-  * @author         : Massimo Casoni
-  * @date           : 30/11/2024
-  * @brief          : Header for the littlefs integration 
-  * 
-  *     Attributes for the CP23LFS file system:
-  *     - DID: 
-  *     - Data IDentifier. Includes encryption level (yes/no/type) and default authorization rules
-  *     -
-  *     - DATE: 
-  *     - File creation date (dd-mm-yyyy format). If not available report "NA"
-  *     - 
-  *     - TIME: 
-  *     - File creation time (HH:MM:SS format). If not available report "NA"
-  *     -
-  *     - GROUP: 
-  *     - The group of the owner (mandatory)
-  *     -   0: USER - End Customer/Dealer/Maintenance (No identification and authorization required. Name optional)
-  *     -   1: MNF - Vehicle Manufacturer/B&P Customer (specify name in ECUtuner license) 
-  *     -   2: BP - B&P Manufacturer/B&P Engineering-Production-Testing (specify name in ECUtuner license)
-  *     -   3: SYS - Electronic system (Self-Generated, or from another B&P device: Node, Gateway, Server)
-  *     -
-  *     - AUTHORIZATION: 
-  *     - Read/Write permissions. OWNERS of GROUP 2 and 3 can modify this attribute. All others must maintain default DID values
-  *     - Authorization syntax: 2 bits per group, where bit0 = r and Bit1 = w (1 = enabled). LSB field for USER GROUP, then MNF, BP and finally SYS (8 bits total)
-  *     - Example: wrwr-r-- (0xF4) --> SYS and BP can read/write, MNF can read, USER has no access
-  *     - When the OWNER has no access rights (rw) on a specific file, this automatically becomes a hidden file
-  *     -
-  *     - OWNER: 
-  *     - File owner name (who's sending or receiving. Optional only for GROUP 0 owners). If not available leave blank.
-  *     -   For USER GROUP use: Optional, requested by ECUTuner (leave blank if not available). Character "*" forbidden
-  *     -   For MNF GROUP use: Name of the ECUtuner license (mandatory). Character "*" forbidden
-  *     -   For BP GROUP use: Name of the ECUtuner license (mandatory). Character "*" forbidden
-  *     -   For SYS GROUP use (Assigned by receiver!): "*Local" (Same ECU), "*Can_XXX" (Another CAN ECU, where xxx = node address), or "*Server" (Non-ECU device, remote server)
-  *     -
-  *     - COMPANY: 
-  *     - Company name of the owner. Optional only for GROUP 0 owners. If not available leave blank.
-  *     -   For USER GROUP use: Optional, requested by ECUTuner (leave blank if not available)
-  *     -   For MNF GROUP use: Company of the ECUtuner license (mandatory)
-  *     -   For BP GROUP use: Company of the ECUtuner license (mandatory)
-  *     -   For SYS GROUP use: "Bondioli-Pavesi"
-  * 
-  ********************************************************************************
-*/
-
-#ifndef __LITTLEFS_HEADER
-#define __LITTLEFS_HEADER
-
-#ifdef __cplusplus
- extern "C" {
-#endif
-
-#include <stdint.h>
-#include "lfs.h"
-
-/* Attribute keys */
-#define CP23LFS_ATTR_DID            0u                          /* File DID (Data IDentifier) */
-#define CP23LFS_ATTR_DATE           1u                          /* File creation date (dd-mm-yyyy format) */
-#define CP23LFS_ATTR_TIME           2u                          /* File creation time (HH:MM:SS format) */
-#define CP23LFS_ATTR_GROUP          3u                          /* File owner group */
-#define CP23LFS_ATTR_AUTH           4u                          /* File authorization */
-#define CP23LFS_ATTR_OWNER          5u                          /* File owner name */
-#define CP23LFS_ATTR_COMPANY        6u                          /* File owner company */
-
-#define CP23LFS_ATTR_NUM            7u                          /* Number of file attributes */
-
-#define CP23LFS_DATE_LEN            11u                         /* Maximum date length */
-#define CP23LFS_TIME_LEN            9u                          /* Maximum time length */
-#define CP23LFS_OWNER_LEN           32u                         /* Maximum owner length */
-#define CP23LFS_COMPANY_LEN         32u                         /* Maximum company length */
-
-#define LfsOwnerGroup(x)            ((x) & 0x03)                /* Owner group position */
-#define LfsUserAuth(x)              ((x) & 0x03)                /* User authorization position */
-#define LfsMNFAuth(x)               (((x) >> 2) & 0x03)         /* (Vehicle) Manufacturers authorization position */
-#define LfsBPAuth(x)                (((x) >> 4) & 0x03)         /* BP authorization position */
-#define LfsSysAuth(x)               (((x) >> 6) & 0x03)         /* System authorization position */
-
-/* CP23LFS error code offset */
-typedef uint32_t cp23lfs_errorcode_t;                           /* Error code type (native error code + CP23LFS_ERRORCODE_OFFSET)*/
-
-#define CP23LFS_ERRORCODE(lfsec)    (cp23lfs_errorcode_t)(((int32_t)(CP23LFS_ERRORCODE_OFFSET))+((int32_t)(lfsec)))                        
-#define CP23LFS_OK                  CP23LFS_ERRORCODE_OFFSET    /* No error */
-
-
-typedef struct 
-{
-    uint16_t dId;                                               /* Data IDentifier */
-    uint8_t date[CP23LFS_DATE_LEN];                             /* File creation date (dd-mm-yyyy format) - When len = 0 the date is missing */
-    uint8_t time[CP23LFS_TIME_LEN];                             /* File creation time (HH:MM:SS format) - When Len = 0 the time is missing */
-    uint8_t flags;                                              /* Flags: 
-                                                                    - Bits 0-1: Owner's Group (00=USER, 01=MNF, 10=BP, 11=SYS)
-                                                                    - Bits 2-7: Not used (= 0) 
-                                                                */
-    uint8_t authorization;                                      /* Authorization flags. r or w = 1 (enabled), r or w = 0 (disabled).
-                                                                    - Bits 0-1: USER Group (r/w)
-                                                                    - Bits 2-3: MNF Group (r/w)
-                                                                    - Bits 4-5: BP Group (r/w)
-                                                                    - Bits 6-7: SYS Group (r/w)
-                                                                */
-    uint8_t owner[CP23LFS_OWNER_LEN];                           /* File Owner name */
-    uint8_t company[CP23LFS_COMPANY_LEN];                       /* File Owner company */
-    uint32_t size;                                              /* File size (read only) */
-    struct 
-    {
-        bool allocated;                                         /* File structure allocated (true). File structure available (false) */
-        uint8_t buffer[CP23LFS_CACHE_SIZE];                     /* Service buffer */
-        struct lfs_attr descr[CP23LFS_ATTR_NUM];                /* Attributes description */
-        struct lfs_file_config fileCfg;                         /* File configuration */
-        lfs_file_t file;                                        /* File object */
-    } system;                                                   /* System attributes - Do not access from Application */
-}cp23lfs_fileStructure_t;
-
-typedef cp23lfs_fileStructure_t *cp23lfs_fileStructure_tPtr;
-typedef cp23lfs_fileStructure_tPtr cp23lfs_file_t;
-
-
-
-
-
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __LITTLEFS_HEADER */
-
-/**
-  * @}
-*/
+/** @addtogroup littlefs
+  * @{
+*/
+
+/**
+  *******************************************************************************
+  * @file           : littlefs.h
+  * @author         : Massimo Casoni
+  * @date           : 30/11/2024
+  * @brief          : Header for the littlefs integration 
+  * 
+  *     Attributes for the CP23LFS file system:
+  *     - DID: 
+  *     - Data IDentifier. Includes encryption level (yes/no/type) and default authorization rules
+  *     -
+  *     - DATE: 
+  *     - File creation date (dd-mm-yyyy format). If not available report "NA"
+  *     - 
+  *     - TIME: 
+  *     - File creation time (HH:MM:SS format). If not available report "NA"
+  *     -
+  *     - GROUP: 
+  *     - The group of the owner (mandatory)
+  *     -   0: USER - End Customer/Dealer/Maintenance (No identification and authorization required. Name optional)
+  *     -   1: MNF - Vehicle Manufacturer/B&P Customer (specify name in ECUtuner license) 
+  *     -   2: BP - B&P Manufacturer/B&P Engineering-Production-Testing (specify name in ECUtuner license)
+  *     -   3: SYS - Electronic system (Self-Generated, or from another B&P device: Node, Gateway, Server)
+  *     -
+  *     - AUTHORIZATION: 
+  *     - Read/Write permissions. OWNERS of GROUP 2 and 3 can modify this attribute. All others must maintain default DID values
+  *     - Authorization syntax: 2 bits per group, where bit0 = r and Bit1 = w (1 = enabled). LSB field for USER GROUP, then MNF, BP and finally SYS (8 bits total)
+  *     - Example: wrwr-r-- (0xF4) --> SYS and BP can read/write, MNF can read, USER has no access
+  *     - When the OWNER has no access rights (rw) on a specific file, this automatically becomes a hidden file
+  *     -
+  *     - OWNER: 
+  *     - File owner name (who's sending or receiving. Optional only for GROUP 0 owners). If not available leave blank.
+  *     -   For USER GROUP use: Optional, requested by ECUTuner (leave blank if not available). Character "*" forbidden
+  *     -   For MNF GROUP use: Name of the ECUtuner license (mandatory). Character "*" forbidden
+  *     -   For BP GROUP use: Name of the ECUtuner license (mandatory). Character "*" forbidden
+  *     -   For SYS GROUP use (Assigned by receiver!): "*Local" (Same ECU), "*Can_XXX" (Another CAN ECU, where xxx = node address), or "*Server" (Non-ECU device, remote server)
+  *     -
+  *     - COMPANY: 
+  *     - Company name of the owner. Optional only for GROUP 0 owners. If not available leave blank.
+  *     -   For USER GROUP use: Optional, requested by ECUTuner (leave blank if not available)
+  *     -   For MNF GROUP use: Company of the ECUtuner license (mandatory)
+  *     -   For BP GROUP use: Company of the ECUtuner license (mandatory)
+  *     -   For SYS GROUP use: "Bondioli-Pavesi"
+  *     -
+  *     - EPOCH: 
+  *     - File creation time in seconds since 01-01-1970 00:00:00 (binary). 0 if not available
+  *     - Written at creation and kept in sync with DATE and TIME by the CP23LFS functions
+  * 
+  ********************************************************************************
+*/
+
+#ifndef __LITTLEFS_HEADER
+#define __LITTLEFS_HEADER
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include "lfs.h"
+
+/* Attribute keys */
+#define CP23LFS_ATTR_DID            0u                          /* File DID (Data IDentifier) */
+#define CP23LFS_ATTR_DATE           1u                          /* File creation date (dd-mm-yyyy format) */
+#define CP23LFS_ATTR_TIME           2u                          /* File creation time (HH:MM:SS format) */
+#define CP23LFS_ATTR_GROUP          3u                          /* File owner group */
+#define CP23LFS_ATTR_AUTH           4u                          /* File authorization */
+#define CP23LFS_ATTR_OWNER          5u                          /* File owner name */
+#define CP23LFS_ATTR_COMPANY        6u                          /* File owner company */
+#define CP23LFS_ATTR_EPOCH          7u                          /* File creation time (seconds since 1970) */
+
+#define CP23LFS_ATTR_NUM            8u                          /* Number of file attributes */
+
+#define CP23LFS_ATTR_TINDEX         8u                          /* Log time index (log files only, not in the file structure) */
+#define CP23LFS_ATTR_GEN            9u                          /* File generation (bumped by each commit and rename, see cp23lfs_generation) */
+
+#define CP23LFS_DATE_LEN            11u                         /* Maximum date length */
+#define CP23LFS_TIME_LEN            9u                          /* Maximum time length */
+#define CP23LFS_OWNER_LEN           32u                         /* Maximum owner length */
+#define CP23LFS_COMPANY_LEN         32u                         /* Maximum company length */
+#define CP23LFS_PATH_MAX            128u                        /* Maximum path length (terminator included) */
+
+/* Owner groups (LfsOwnerGroup) */
+#define CP23LFS_GROUP_USER          0u                          /* End Customer/Dealer/Maintenance */
+#define CP23LFS_GROUP_MNF           1u                          /* Vehicle Manufacturer/B&P Customer */
+#define CP23LFS_GROUP_BP            2u                          /* B&P Manufacturer/B&P Engineering-Production-Testing */
+#define CP23LFS_GROUP_SYS           3u                          /* Electronic system */
+
+#define CP23LFS_GROUP_NUM           4u                          /* Number of owner groups */
+
+/* Storage quotas */
+#define CP23LFS_SYS_RESERVE         8u                          /* Free blocks reserved to the SYS group */
+
+/* Wear leveling */
+#define CP23LFS_WEAR_SAVE           64u                         /* Erases between two saves of the wear table */
+#define CP23LFS_WEAR_STATIC         64u                         /* Wear gap (erases) between a cold file and the free blocks to relocate it */
+
+/* Secondary indexes */
+#define CP23LFS_INDEX_GROUP         0u                          /* Owner group index (CP23LFS_ATTR_GROUP) */
+#define CP23LFS_INDEX_OWNER         1u                          /* Owner name index (CP23LFS_ATTR_OWNER) */
+#define CP23LFS_INDEX_COMPANY       2u                          /* Owner company index (CP23LFS_ATTR_COMPANY) */
+
+#define CP23LFS_INDEX_NUM           3u                          /* Number of secondary indexes */
+
+/* Log time index */
+#define CP23LFS_TINDEX_MAX          32u                         /* Max log time index entries (committed with the log metadata) */
+
+/* File mapping */
+#define CP23LFS_MAP_PAGE            256u                        /* Mapping page size */
+#define CP23LFS_MAP_PAGES_MAX       16u                         /* Max pages of a mapping */
+
+/* Pinned files */
+#define CP23LFS_PINS_MAX            8u                          /* Max pinned files */
+
+/* Time ordered listing */
+#define CP23LFS_ORDER_OLDEST        0u                          /* Oldest files first */
+#define CP23LFS_ORDER_NEWEST        1u                          /* Newest files first */
+
+/* Query operators */
+#define CP23LFS_QOP_EQ              0u                          /* Attribute equal to the value */
+#define CP23LFS_QOP_NE              1u                          /* Attribute different from the value */
+#define CP23LFS_QOP_ALL             2u                          /* All the value bits set in the attribute (masks, e.g. authorization) */
+#define CP23LFS_QOP_ANY             3u                          /* At least one of the value bits set in the attribute */
+
+/* Stack measurement (CP23LFS_STACK_CHECK builds) */
+#define CP23LFS_STACK_PAINT         4096u                       /* Stack painted below the measure start (must be available) */
+#define CP23LFS_STACK_BUDGET        2048u                       /* Stack budget of a cp23 call */
+
+/* File structures pool */
+#define CP23LFS_WAITERS_MAX         8u                          /* Max tasks waiting for a file structure */
+#define CP23LFS_WAIT_FOREVER        0xFFFFFFFFu                 /* No timeout (passed to the wait hook) */
+
+/* Performance gate metrics */
+#define CP23LFS_PERF_TIME           0u                          /* Modeled memory time (uSec, see IS25LP080D_GetEnergy) */
+#define CP23LFS_PERF_BUS            1u                          /* SPI bus bytes */
+#define CP23LFS_PERF_PROG           2u                          /* Page programs */
+#define CP23LFS_PERF_ERASE          3u                          /* Erased sectors (block erases counted as their sectors) */
+#define CP23LFS_PERF_RAM            4u                          /* Static RAM (see cp23lfs_mem_stats) */
+#define CP23LFS_PERF_FAILED         5u                          /* Failed calls of the replay */
+
+#define CP23LFS_PERF_NUM            6u                          /* Number of performance metrics */
+
+/* Workload recorder calls */
+#define CP23LFS_REC_OPEN            1u                          /* cp23lfs_file_opencfg (successful) */
+#define CP23LFS_REC_CLOSE           2u                          /* cp23lfs_file_close */
+#define CP23LFS_REC_SYNC            3u                          /* cp23lfs_file_sync */
+#define CP23LFS_REC_READ            4u                          /* cp23lfs_file_read */
+#define CP23LFS_REC_WRITE           5u                          /* cp23lfs_file_write */
+#define CP23LFS_REC_SEEK            6u                          /* cp23lfs_file_seek */
+#define CP23LFS_REC_TRUNCATE        7u                          /* cp23lfs_file_truncate */
+#define CP23LFS_REC_REMOVE          8u                          /* cp23lfs_remove */
+#define CP23LFS_REC_RENAME          9u                          /* cp23lfs_rename */
+#define CP23LFS_REC_MKDIR           10u                         /* cp23lfs_mkdir */
+
+#define LfsOwnerGroup(x)            ((x) & 0x03)                /* Owner group position */
+#define LfsUserAuth(x)              ((x) & 0x03)                /* User authorization position */
+#define LfsMNFAuth(x)               (((x) >> 2) & 0x03)         /* (Vehicle) Manufacturers authorization position */
+#define LfsBPAuth(x)                (((x) >> 4) & 0x03)         /* BP authorization position */
+#define LfsSysAuth(x)               (((x) >> 6) & 0x03)         /* System authorization position */
+
+/* CP23LFS error code offset */
+typedef uint32_t cp23lfs_errorcode_t;                           /* Error code type (native error code + CP23LFS_ERRORCODE_OFFSET)*/
+
+#define CP23LFS_ERRORCODE(lfsec)    (cp23lfs_errorcode_t)(((int32_t)(CP23LFS_ERRORCODE_OFFSET))+((int32_t)(lfsec)))                        
+#define CP23LFS_OK                  CP23LFS_ERRORCODE_OFFSET    /* No error */
+
+
+typedef struct 
+{
+    uint16_t dId;                                               /* Data IDentifier */
+    uint8_t date[CP23LFS_DATE_LEN];                             /* File creation date (dd-mm-yyyy format) - When len = 0 the date is missing */
+    uint8_t time[CP23LFS_TIME_LEN];                             /* File creation time (HH:MM:SS format) - When Len = 0 the time is missing */
+    uint8_t flags;                                              /* Flags: 
+                                                                    - Bits 0-1: Owner's Group (00=USER, 01=MNF, 10=BP, 11=SYS)
+                                                                    - Bits 2-7: Not used (= 0) 
+                                                                */
+    uint8_t authorization;                                      /* Authorization flags. r or w = 1 (enabled), r or w = 0 (disabled).
+                                                                    - Bits 0-1: USER Group (r/w)
+                                                                    - Bits 2-3: MNF Group (r/w)
+                                                                    - Bits 4-5: BP Group (r/w)
+                                                                    - Bits 6-7: SYS Group (r/w)
+                                                                */
+    uint8_t owner[CP23LFS_OWNER_LEN];                           /* File Owner name */
+    uint8_t company[CP23LFS_COMPANY_LEN];                       /* File Owner company */
+    uint32_t epoch;                                             /* File creation time (seconds since 1970, 0 = missing) */
+    uint32_t size;                                              /* File size (read only) */
+    struct 
+    {
+        bool allocated;                                         /* File structure allocated (true). File structure available (false) */
+        bool closed;                                            /* Holder closed, kept open for its shared opens */
+        bool outdated;                                          /* Holder of a file since committed, renamed or removed: not shared */
+        uint8_t holder;                                         /* Pool index of the structure holding the open file (itself unless shared) */
+        uint8_t users;                                          /* Shared opens of the held file (holder only) */
+        uint32_t pos;                                           /* File position (files with shared opens) */
+        uint8_t *buffer;                                        /* File cache (NULL for shared and pinned opens) */
+        uint8_t pin;                                            /* Pinned file entry + 1 (0 = not pinned: read from the memory) */
+        struct lfs_attr descr[CP23LFS_ATTR_NUM + 1u];           /* Attributes description (+ generation) */
+        struct lfs_file_config fileCfg;                         /* File configuration */
+        lfs_file_t file;                                        /* File object */
+        char path[CP23LFS_PATH_MAX];                            /* File path (normalized) */
+        uint32_t idxKey[CP23LFS_INDEX_NUM];                     /* Secondary index keys at the last commit */
+        bool indexed;                                           /* File listed in the secondary indexes */
+        bool created;                                           /* File created by the open */
+        bool written;                                           /* Data written since the last commit */
+        uint32_t generation;                                    /* File generation (committed with the attributes) */
+        uint32_t attrHash;                                      /* Attributes hash at the last commit (changes bump the generation) */
+        uint32_t commitSize;                                    /* File size at the last commit */
+        lfs_block_t commitHead;                                 /* CTZ skip-list head at the last commit (blocks in use accounting) */
+        uint8_t commitGroup;                                    /* Owner group at the last commit (quota accounting) */
+        uint32_t reserved;                                      /* Uncommitted growth reserved in the quota (blocks) */
+        uint8_t reservedGroup;                                  /* Owner group of the reserved growth */
+    } system;                                                   /* System attributes - Do not access from Application */
+}cp23lfs_fileStructure_t;
+
+typedef cp23lfs_fileStructure_t *cp23lfs_fileStructure_tPtr;
+typedef cp23lfs_fileStructure_tPtr cp23lfs_file_t;
+
+
+typedef struct
+{
+    uint8_t attr;                                               /* Attribute key (CP23LFS_ATTR_xxx) */
+    uint8_t op;                                                 /* Operator (CP23LFS_QOP_xxx) */
+    uint8_t size;                                               /* Value size (compared to the first size bytes of the attribute) */
+    const void *value;                                          /* Value. Strings must include the terminator in size */
+}cp23lfs_qcond_t;                                               /* Query condition */
+
+typedef struct
+{
+    char name[LFS_NAME_MAX + 1u];                               /* Entry name */
+    uint32_t epoch;                                             /* Creation time (seconds since 1970) */
+    uint32_t size;                                              /* File size */
+}cp23lfs_timeEntry_t;                                           /* Time ordered listing entry */
+
+typedef struct
+{
+    uint32_t timestamp;                                         /* Record time stamp */
+    uint32_t offset;                                            /* Record offset in the log file */
+}cp23lfs_tindexEntry_t;                                         /* Log time index entry */
+
+typedef struct
+{
+    cp23lfs_file_t file;                                        /* Log file (access with the cp23lfs_file_xxx functions) */
+    uint32_t interval;                                          /* Records between index entries (doubled when the index is full) */
+    uint32_t count;                                             /* Records to write before the next index entry */
+    struct lfs_attr attrs[CP23LFS_ATTR_NUM + 2u];               /* File attributes + generation + time index */
+    cp23lfs_tindexEntry_t entry[CP23LFS_TINDEX_MAX];            /* Time index */
+}cp23lfs_log_t;                                                 /* Time indexed log */
+
+typedef struct
+{
+    uint32_t off;                                               /* File offset of the page */
+    uint32_t use;                                               /* Last use (least recently used page replaced first) */
+    bool valid;                                                 /* Page filled */
+    bool dirty;                                                 /* Page changed, not written back */
+}cp23lfs_mapPage_t;                                             /* Mapping page */
+
+typedef struct
+{
+    cp23lfs_file_t file;                                        /* Mapped file */
+    uint8_t *pages;                                             /* Pages RAM (pageNum * CP23LFS_MAP_PAGE bytes) */
+    uint32_t pageNum;                                           /* Number of pages */
+    uint32_t size;                                              /* Mapped range (file size at open, or size limit) */
+    uint32_t end;                                               /* File end (size at open, grown by the writes) */
+    uint32_t tick;                                              /* Use counter */
+    uint32_t last;                                              /* Last page used */
+    bool writable;                                              /* Pages can be changed and written back */
+    uint32_t hits;                                              /* Accesses to a filled page */
+    uint32_t misses;                                            /* Accesses filling a page */
+    cp23lfs_mapPage_t page[CP23LFS_MAP_PAGES_MAX];              /* Pages */
+}cp23lfs_map_t;                                                 /* File mapping */
+
+typedef struct
+{
+    uint32_t maxFile;                                           /* Largest file pinned (bytes) */
+    uint16_t autoOpens;                                         /* Read-only opens pinning a file (0 = explicit pins only) */
+}cp23lfs_pinPolicy_t;                                           /* Pinning policy */
+
+typedef struct
+{
+    uint32_t budget;                                            /* Pin RAM (bytes) */
+    uint32_t used;                                              /* Pin RAM in use (paths, attributes and contents) */
+    uint32_t hits;                                              /* Read-only opens served from the pin RAM */
+    uint32_t loads;                                             /* Files loaded (pins and reloads after a change) */
+    uint8_t pins;                                               /* Pinned files */
+}cp23lfs_pinStats_t;                                            /* Pinned files statistics */
+
+typedef struct
+{
+    uint32_t bytes;                                             /* Committed file bytes */
+    uint32_t blocks;                                            /* Data blocks of the committed files */
+    uint32_t limit;                                             /* Block quota (0 = no limit) */
+}cp23lfs_quota_t;                                               /* Owner group storage usage */
+
+typedef struct
+{
+    uint32_t min;                                               /* Erases of the least worn block */
+    uint32_t max;                                               /* Erases of the most worn block */
+    uint32_t mean;                                              /* Average erases per block */
+    uint32_t total;                                             /* Total erases */
+}cp23lfs_wear_t;                                                /* Wear statistics */
+
+typedef struct
+{
+    uint32_t fileSize;                                          /* File structure (handle) size */
+    uint32_t filePool;                                          /* File structures pool (CP23LFS_FILES_MAX handles) */
+    uint32_t caches;                                            /* LFS read, program, system file and file caches */
+    uint32_t lookahead;                                         /* LFS lookahead bitmap */
+    uint32_t lfsState;                                          /* File system and system file objects */
+    uint32_t cp23State;                                         /* CP23 state structure (usage, quotas, recorder, pool, pins) */
+    uint32_t total;                                             /* Static RAM of the module */
+    uint32_t dirSize;                                           /* Directory object size (on the stack of the walks) */
+    uint8_t filesMax;                                           /* File structures of the pool */
+    uint8_t filesUsed;                                          /* File structures in use */
+    uint8_t filesPeak;                                          /* File structures in use, high-water mark */
+    uint8_t dirsUsed;                                           /* Directories open */
+    uint8_t dirsPeak;                                           /* Directories open, high-water mark */
+    uint8_t cachesUsed;                                         /* File caches in use (file structures and system file) */
+    uint8_t cachesPeak;                                         /* File caches in use, high-water mark */
+}cp23lfs_mem_t;                                                 /* RAM footprint */
+
+typedef struct
+{
+    uint32_t time;                                              /* Time stamp (recorder clock) */
+    uint32_t hash;                                              /* Path hash (open, remove, rename, mkdir, see cp23lfs_rec_hash) */
+    uint32_t arg;                                               /* Flags (open), size (read, write, truncate), offset (seek), new path hash (rename) */
+    uint16_t whence;                                            /* Seek origin (seek) */
+    uint8_t call;                                               /* Call (CP23LFS_REC_xxx) */
+    uint8_t slot;                                               /* File slot (file calls) */
+}cp23lfs_rec_t;                                                 /* Workload record */
+
+typedef struct
+{
+    const char *name;                                           /* Measured calls */
+    uint32_t peak;                                              /* Peak stack (bytes) */
+    bool over;                                                  /* Peak over CP23LFS_STACK_BUDGET */
+}cp23lfs_stack_t;                                               /* Stack measure of cp23 calls */
+
+typedef struct
+{
+    uint32_t exhausted;                                         /* Opens finding no file structure available */
+    uint32_t waits;                                             /* Opens waiting for a file structure */
+    uint32_t timeouts;                                          /* Waits timed out */
+    uint8_t waitersPeak;                                        /* Waiting opens, high-water mark */
+}cp23lfs_pool_t;                                                /* File structures pool contention */
+
+typedef struct
+{
+    uint32_t metric[CP23LFS_PERF_NUM];                          /* Metrics (CP23LFS_PERF_xxx) */
+}cp23lfs_perf_t;                                                /* Performance of a workload */
+
+typedef uint32_t (*cp23lfs_clock_t)(void);                      /* Wall clock (seconds since 1970, 0 = not available) */
+typedef uint32_t (*cp23lfs_recClock_t)(void);                   /* Recorder clock (any unit, e.g. mSec) */
+typedef bool (*cp23lfs_replayPath_t)(uint32_t hash, char *path);    /* Replay path resolution (false = not found) */
+typedef bool (*cp23lfs_poolWait_t)(uint8_t waiter, uint32_t timeout);  /* Blocks a waiter until woken or timed out (false = timeout) */
+typedef void (*cp23lfs_poolWake_t)(uint8_t waiter);             /* Wakes a waiter (e.g. gives its semaphore) */
+typedef void (*cp23lfs_lock_t)(void);                           /* Takes or releases the integrator file system lock */
+
+typedef bool (*cp23lfs_query_cb_t)(void *data, const char *path, const struct lfs_info *info);    /* Query match callback (false = stop) */
+
+
+typedef struct
+{
+    char path[CP23LFS_PATH_MAX];                                /* Working path (depth-first position in the tree) */
+    uint32_t rootLen;                                           /* Length of the tree root path */
+    uint32_t removed;                                           /* Number of entries removed so far (progress) */
+    bool done;                                                  /* Tree removal completed */
+    bool purgeIndex;                                            /* Secondary indexes to be purged at completion */
+}cp23lfs_rmtree_t;                                              /* Recursive remove context */
+
+
+/**
+ * @brief Initializes the CP23 file system.
+ * 
+ * This function initializes the memory and mounts the file system, restores the erase counts of the blocks, then counts the blocks in use, in total
+ * and per owner group. The memory is formatted only at the first start (mount failing with
+ * LFS_ERR_CORRUPT on a memory whose superblock blocks are blank): any other mount failure is
+ * returned and the memory is left as it is.
+ * 
+ * @param None
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t CP23Init(void);
+
+
+/**
+ * @brief Returns the blocks in use.
+ * 
+ * The data blocks of the files are counted on commit and remove. The operations changing the metadata
+ * (new, removed or moved entries, inline files, attributes) recount the blocks with a traversal when
+ * they complete, once no open file has uncommitted data (otherwise at the commit of the last one),
+ * so the call costs nothing and the count matches the traversal whenever no file has uncommitted data
+ * (debug builds with USE_FULL_ASSERT check it against the traversal).
+ * 
+ * @param None
+ * 
+ * @return The number of blocks in use.
+ */
+lfs_ssize_t cp23lfs_fs_size(void);
+
+
+/**
+ * @brief Returns the free blocks (see cp23lfs_fs_size).
+ * 
+ * @param None
+ * 
+ * @return The number of free blocks.
+ */
+lfs_ssize_t cp23lfs_fs_free(void);
+
+
+/**
+ * @brief Recounts the blocks in use with a file system traversal.
+ * 
+ * The owner group usage (see cp23lfs_quota_get) is recounted as well. The blocks in use are recounted
+ * once no open file has uncommitted data.
+ * 
+ * @param None
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_fs_reconcile(void);
+
+
+/**
+ * @brief Saves the wear table and steers the allocator to the least worn free blocks.
+ * 
+ * The erase count of each block (kept by the memory driver) is stored in the CP23 system
+ * directory every CP23LFS_WEAR_SAVE erases, at the end of a file commit, and restored by
+ * CP23Init(): a reset loses at most CP23LFS_WEAR_SAVE erases. At mount and at each save, the
+ * allocation window is refilled starting from the least worn block, and the free blocks much more
+ * worn than the least worn free one, or slow to program/erase (see IS25LP080D_IsSlowSector),
+ * are skipped. They are skipped again in the window of each allocator scan.
+ * Call this function before a planned power-down to save the latest counts.
+ * 
+ * @param None
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_wear_sync(void);
+
+
+/**
+ * @brief Static wear leveling service (call from the idle task).
+ * 
+ * Files never rewritten keep their blocks, so the log churn wears only the free blocks. When the
+ * wear spread exceeds CP23LFS_WEAR_STATIC erases, this function finds the closed file whose blocks
+ * are the least worn, at least CP23LFS_WEAR_STATIC erases below the average free block, and rewrites
+ * it on the most worn free blocks: its fresh blocks are freed for the new data. At most one file of
+ * at most budget blocks is relocated per call (larger files are left in place), the file search
+ * reads the metadata of the whole tree. The file path, data and attributes are unchanged.
+ * 
+ * @param budget The maximum number of blocks to relocate.
+ * @param moved The number of relocated blocks (0 = nothing to do, can be NULL).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_wear_level(uint32_t budget, uint32_t *moved);
+
+
+/**
+ * @brief Returns the wear statistics of the blocks.
+ * 
+ * @param stats The wear statistics.
+ * 
+ * @return Nothing
+ */
+void cp23lfs_wear_stats(cp23lfs_wear_t *stats);
+
+
+/**
+ * @brief Returns the RAM footprint of the module.
+ * 
+ * The static sizes of each component come with the runtime high-water marks of the file
+ * structures, the open directories and the file caches since start-up (or the last reset), to
+ * size CP23LFS_FILES_MAX to the real use. The driver RAM is not included.
+ * 
+ * @param mem The RAM footprint.
+ * @param reset Restarts the high-water marks from the current use.
+ * 
+ * @return Nothing
+ */
+void cp23lfs_mem_stats(cp23lfs_mem_t *mem, bool reset);
+
+
+/**
+ * @brief Sets the storage quota of an owner group.
+ * 
+ * The quota limits the data blocks of the group files (owner group taken from CP23LFS_ATTR_GROUP).
+ * Quotas are not stored in the file system: set them after each CP23Init().
+ * 
+ * @param group The owner group (CP23LFS_GROUP_xxx).
+ * @param limit The maximum number of data blocks (0 = no limit).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_quota_set(uint8_t group, uint32_t limit);
+
+
+/**
+ * @brief Returns the storage usage of an owner group.
+ * 
+ * Usage is kept incrementally on commit, truncate and remove, and recounted at mount, so the call
+ * costs nothing. Directories and CP23 system files are not charged to any group.
+ * 
+ * @param group The owner group (CP23LFS_GROUP_xxx).
+ * @param quota The group usage and quota.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_quota_get(uint8_t group, cp23lfs_quota_t *quota);
+
+
+/**
+ * @brief Opens or creates a file.
+ * 
+ * This function gets a file structure from the pool and opens the file with all the CP23 attributes
+ * bound to it: they are loaded at open (also for write-only opens) and committed by close/sync.
+ * Read-only opens (flags LFS_O_RDONLY only) of a file already open read-only share its open
+ * state: the metadata lookup is skipped, the attributes are copied from the first open and the
+ * reads go through its cache, each file structure keeping its own position. Shared opens take
+ * no file cache, and the first open stays open until its shared opens are closed.
+ * 
+ * @param file The opened file (NULL on failure).
+ * @param path The file path.
+ * @param flags The open flags (LFS_O_xxx).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_file_opencfg(cp23lfs_file_t *file, const char *path, int flags);
+
+
+/**
+ * @brief Opens or creates a file, waiting for a file structure if the pool is exhausted.
+ * 
+ * Like cp23lfs_file_opencfg, but when all the file structures are in use the caller is blocked
+ * by the wait hook (see cp23lfs_pool_wait_set) until a close releases one, or until the timeout.
+ * A released structure is reserved to the waiter with the highest priority (the first one
+ * among equal priorities) and the waiter is woken: opens not waiting cannot take it.
+ * 
+ * @param file The opened file (NULL on failure).
+ * @param path The file path.
+ * @param flags The open flags (LFS_O_xxx).
+ * @param timeout The wait timeout, in wait hook units (0 = no wait, CP23LFS_WAIT_FOREVER = no timeout).
+ * @param priority The waiter priority (higher first).
+ * 
+ * @return CP23LFS_OK if the operation was successful, CP23LFS_ERRORCODE(LFS_ERR_NOMEM) on timeout,
+ *         a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_file_openwait(cp23lfs_file_t *file, const char *path, int flags, uint32_t timeout, uint8_t priority);
+
+
+/**
+ * @brief Sets the hooks blocking the opens waiting for a file structure.
+ * 
+ * The wait hook blocks the calling task until the wake hook is called with the same waiter
+ * (0 to CP23LFS_WAITERS_MAX - 1) or until the timeout, e.g. with a semaphore per waiter.
+ * The wake hook is called by the close releasing a structure, before returning: it must not block.
+ * The waiter can be woken before its wait hook blocks (a semaphore keeps the wake up).
+ * The file system lock set by cp23lfs_lock_set is released while the wait hook blocks.
+ * 
+ * @param wait The wait hook (NULL = opens never wait).
+ * @param wake The wake hook.
+ * 
+ * @return Nothing
+ */
+void cp23lfs_pool_wait_set(cp23lfs_poolWait_t wait, cp23lfs_poolWake_t wake);
+
+
+/**
+ * @brief Sets the hooks of the lock serializing the file system calls.
+ * 
+ * Locking contract: the CP23LFS functions are not reentrant and do not lock. Tasks sharing the
+ * file system must serialize their calls, e.g. with a mutex taken before and released after
+ * each call. cp23lfs_file_openwait blocks inside the call: to let the other tasks close files
+ * meanwhile, it releases the lock (unlock hook) before the wait hook and takes it back (lock hook)
+ * once woken or timed out. Without hooks, the wait hook itself must release and take the lock.
+ * The hooks are called only by the task waiting, with the lock held by that task.
+ * 
+ * @param lock The lock hook, e.g. takes the mutex (NULL = calls serialized otherwise).
+ * @param unlock The unlock hook, e.g. gives the mutex.
+ * 
+ * @return Nothing
+ */
+void cp23lfs_lock_set(cp23lfs_lock_t lock, cp23lfs_lock_t unlock);
+
+
+/**
+ * @brief Returns the contention statistics of the file structures pool.
+ * 
+ * @param stats The pool statistics.
+ * @param reset true to restart the statistics.
+ * 
+ * @return Nothing
+ */
+void cp23lfs_pool_stats(cp23lfs_pool_t *stats, bool reset);
+
+
+/**
+ * @brief Closes a file.
+ * 
+ * This function commits pending data and attributes, updates the secondary indexes and
+ * releases the file structure to the pool.
+ * 
+ * @param file The file to close.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_file_close(cp23lfs_file_t file);
+
+
+/**
+ * @brief Synchronizes a file on storage.
+ * 
+ * This function commits pending data and attributes, and updates the secondary indexes.
+ * 
+ * @param file The file to synchronize.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_file_sync(cp23lfs_file_t file);
+
+
+/**
+ * @brief Reads data from a file.
+ * 
+ * @param file The file.
+ * @param buffer The buffer to store the read data.
+ * @param size The number of bytes to read.
+ * 
+ * @return The number of bytes read, or a negative LFS error code on failure.
+ */
+lfs_ssize_t cp23lfs_file_read(cp23lfs_file_t file, void *buffer, lfs_size_t size);
+
+
+/**
+ * @brief Writes data to a file.
+ * 
+ * A write growing the file is rejected with LFS_ERR_NOSPC, before writing anything, when the
+ * file owner group would exceed its quota or, for groups other than SYS, when it would use the
+ * last CP23LFS_SYS_RESERVE free blocks. The growth is reserved until the file is committed (sync or
+ * close), so the check counts the committed usage of the group plus the growth reserved by the other
+ * open files.
+ * 
+ * @param file The file.
+ * @param buffer The data to write.
+ * @param size The number of bytes to write.
+ * 
+ * @return The number of bytes written, or a negative LFS error code on failure.
+ */
+lfs_ssize_t cp23lfs_file_write(cp23lfs_file_t file, const void *buffer, lfs_size_t size);
+
+
+/**
+ * @brief Truncates or extends a file.
+ * 
+ * Extending a file is subject to the owner group quota (see cp23lfs_file_write).
+ * 
+ * @param file The file.
+ * @param size The new file size.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_file_truncate(cp23lfs_file_t file, lfs_size_t size);
+
+
+/**
+ * @brief Changes the position of a file.
+ * 
+ * @param file The file.
+ * @param off The offset.
+ * @param whence LFS_SEEK_SET, LFS_SEEK_CUR or LFS_SEEK_END.
+ * 
+ * @return The new position, or a negative LFS error code on failure.
+ */
+lfs_soff_t cp23lfs_file_seek(cp23lfs_file_t file, lfs_soff_t off, int whence);
+
+
+/**
+ * @brief Creates a directory.
+ * 
+ * @param path The directory path.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_mkdir(const char *path);
+
+
+/**
+ * @brief Removes a file or an empty directory.
+ * 
+ * @param path The entry to remove.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_remove(const char *path);
+
+
+/**
+ * @brief Renames or moves a file or a directory.
+ * 
+ * Renaming a non-empty directory invalidates the secondary indexes (see cp23lfs_index_build).
+ * 
+ * @param oldpath The entry to rename.
+ * @param newpath The new entry path.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_rename(const char *oldpath, const char *newpath);
+
+
+/**
+ * @brief Sets a custom attribute.
+ * 
+ * Types over CP23LFS_ATTR_GEN are free for the application: they are kept by the wear leveling
+ * relocation (see cp23lfs_wear_level), up to CP23LFS_CACHE_SIZE bytes.
+ * 
+ * @param path The file or directory.
+ * @param type The attribute key (CP23LFS_ATTR_xxx, or an application type over CP23LFS_ATTR_GEN).
+ * @param buffer The attribute value.
+ * @param size The attribute size.
+ * 
+ * @return CP23LFS_OK if the operation was successful, CP23LFS_ERRORCODE(LFS_ERR_NOSPC) for an
+ *         application attribute larger than CP23LFS_CACHE_SIZE, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_setattr(const char *path, uint8_t type, const void *buffer, lfs_size_t size);
+
+
+/**
+ * @brief Returns the generation of a file.
+ * 
+ * The generation changes (to a value never used by any file, even before a reset) with each commit
+ * changing the file data or attributes and with each rename, so a copy parsed from the file can be
+ * revalidated with a single metadata lookup, without opening the file. Opens that only read keep the
+ * generation. A high-water mark of the generations is stored in the CP23 system directory, updated
+ * once every 64 generations. Files never committed since the generations were introduced return 0.
+ * 
+ * @param path The file path.
+ * @param generation The file generation.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_generation(const char *path, uint32_t *generation);
+
+
+/**
+ * @brief Sets the wall clock used to time stamp the new files.
+ * 
+ * Files created without DATE and TIME get EPOCH, DATE and TIME from the clock at their first commit.
+ * 
+ * @param clock The wall clock (NULL = none).
+ * 
+ * @return Nothing
+ */
+void cp23lfs_set_clock(cp23lfs_clock_t clock);
+
+
+/**
+ * @brief Lists the files of a directory ordered by creation time.
+ * 
+ * This function reads the binary EPOCH attribute of each file (DATE and TIME are parsed only for
+ * files without it) and returns the files created in [from, to], sorted by time. When more files
+ * match than entries are available, the first maxEntries in the requested order are returned.
+ * 
+ * @param dirPath The directory.
+ * @param from The oldest creation time (seconds since 1970).
+ * @param to The newest creation time (seconds since 1970).
+ * @param order CP23LFS_ORDER_OLDEST or CP23LFS_ORDER_NEWEST.
+ * @param entries The returned entries.
+ * @param maxEntries The number of entries available.
+ * @param count The number of returned entries.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_list_bytime(const char *dirPath, uint32_t from, uint32_t to, uint8_t order, 
+                                        cp23lfs_timeEntry_t entries[], uint32_t maxEntries, uint32_t *count);
+
+
+/**
+ * @brief Opens or creates a time indexed log.
+ * 
+ * The log file is opened for appending and its sparse time index, (time stamp, offset) pairs
+ * taken every interval records, is committed together with the log data and attributes.
+ * The log context must stay allocated until cp23lfs_log_close().
+ * 
+ * @param log The log context.
+ * @param path The log file path.
+ * @param interval The records between two index entries.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_log_open(cp23lfs_log_t *log, const char *path, uint32_t interval);
+
+
+/**
+ * @brief Appends a record to a time indexed log.
+ * 
+ * @param log The log context.
+ * @param timestamp The record time stamp (never decreasing).
+ * @param record The record data.
+ * @param size The record size.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_log_write(cp23lfs_log_t *log, uint32_t timestamp, const void *record, lfs_size_t size);
+
+
+/**
+ * @brief Closes a time indexed log.
+ * 
+ * @param log The log context.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_log_close(cp23lfs_log_t *log);
+
+
+/**
+ * @brief Finds the log region holding a time range.
+ * 
+ * This function binary-searches the log time index: the records with a time stamp in [from, to]
+ * are all inside [start, end). Reading the region still requires checking the record time stamps.
+ * 
+ * @param path The log file path.
+ * @param from The first time stamp.
+ * @param to The last time stamp.
+ * @param start The region start offset.
+ * @param end The region end offset.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_log_range(const char *path, uint32_t from, uint32_t to, lfs_off_t *start, lfs_off_t *end);
+
+
+/**
+ * @brief Maps a file for random accesses.
+ * 
+ * The file content is accessed through pages of CP23LFS_MAP_PAGE bytes held in the RAM given
+ * by the caller: a page is read at its first access and replaced, least recently used first,
+ * when all the pages are in use. Maps are read-only (LFS_O_RDONLY) or writable (LFS_O_RDWR):
+ * writable maps write the changed pages back when replaced and at flush/close. LFS_O_WRONLY and
+ * LFS_O_APPEND are rejected (LFS_ERR_INVAL), since the pages are read before being changed.
+ * A read-only map covers the file size at open. A writable map covers the file size at open,
+ * or maxSize if larger: the file grows up to the end of the last range changed (the gap read
+ * as zeros), so a map of a new file (LFS_O_CREAT, LFS_O_TRUNC) needs a non zero maxSize.
+ * The map context and the pages must stay allocated until cp23lfs_map_close().
+ * 
+ * @param map The map context.
+ * @param path The file path.
+ * @param flags The open flags: LFS_O_RDONLY or LFS_O_RDWR (with LFS_O_CREAT, LFS_O_EXCL, LFS_O_TRUNC).
+ * @param pages The pages RAM (pageNum * CP23LFS_MAP_PAGE bytes).
+ * @param pageNum The number of pages (1 to CP23LFS_MAP_PAGES_MAX).
+ * @param maxSize The size a writable map can grow the file to (ignored by read-only maps).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise
+ * (LFS_ERR_INVAL for a writable map of an empty file with no maxSize, the file kept).
+ */
+cp23lfs_errorcode_t cp23lfs_map_open(cp23lfs_map_t *map, const char *path, int flags, uint8_t *pages, uint32_t pageNum,
+                                     lfs_size_t maxSize);
+
+
+/**
+ * @brief Returns the address of a mapped file range.
+ * 
+ * The range must be inside the mapped size and must not cross a page boundary (e.g.
+ * table entries aligned to their size). The address is valid until the next access to the map.
+ * 
+ * @param map The map context.
+ * @param off The range offset.
+ * @param size The range size.
+ * @param write true if the range is changed (writable maps only).
+ * 
+ * @return The range address, NULL if the range is invalid or the page cannot be filled.
+ */
+void *cp23lfs_map_get(cp23lfs_map_t *map, lfs_off_t off, lfs_size_t size, bool write);
+
+
+/**
+ * @brief Writes back the changed pages of a map and commits the file.
+ * 
+ * @param map The map context.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_map_flush(cp23lfs_map_t *map);
+
+
+/**
+ * @brief Writes back the changed pages of a map and closes the file.
+ * 
+ * @param map The map context.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_map_close(cp23lfs_map_t *map);
+
+
+/**
+ * @brief Sets the pin RAM and the pinning policy.
+ * 
+ * Pinned files are kept in the RAM given by the caller (path, attributes and content of each
+ * file): their read-only opens are served from it without accessing the memory. The files
+ * changed through the cp23 calls (commit, attribute, rename) are reloaded, the removed ones
+ * unpinned. The previous pins are dropped: call it with no pinned file open.
+ * 
+ * @param buffer The pin RAM (NULL to disable the pinning).
+ * @param size The pin RAM size.
+ * @param policy The pinning policy.
+ */
+void cp23lfs_pin_config(uint8_t *buffer, uint32_t size, const cp23lfs_pinPolicy_t *policy);
+
+
+/**
+ * @brief Pins a file.
+ * 
+ * @param path The file path.
+ * 
+ * @return CP23LFS_OK if the operation was successful (or the file already pinned), a CP23LFS error
+ *         code otherwise (LFS_ERR_FBIG: file larger than the policy maxFile, LFS_ERR_NOSPC: pin RAM
+ *         or pin entries exhausted).
+ */
+cp23lfs_errorcode_t cp23lfs_pin(const char *path);
+
+
+/**
+ * @brief Unpins a file (its RAM is released at the close of its last pinned open).
+ * 
+ * @param path The file path.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_unpin(const char *path);
+
+
+/**
+ * @brief Reads the pinned files statistics.
+ * 
+ * @param stats The statistics.
+ * @param reset true to clear the hits and loads counters.
+ */
+void cp23lfs_pin_stats(cp23lfs_pinStats_t *stats, bool reset);
+
+
+/**
+ * @brief Prepares a recursive remove.
+ * 
+ * This function initializes the context used by cp23lfs_remove_recursive_step() to delete a file
+ * or a whole directory tree. The path "/" clears the file system content (the root is kept).
+ * 
+ * @param ctx The recursive remove context.
+ * @param path The file or directory to remove.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_remove_recursive_start(cp23lfs_rmtree_t *ctx, const char *path);
+
+
+/**
+ * @brief Removes a slice of a directory tree.
+ * 
+ * This function walks the tree depth-first (no recursion, memory bounded by the context) and removes
+ * at most budget entries, so long removals can be time-sliced. Progress is reported in ctx->removed and
+ * ctx->done is set when the whole tree has been removed. The files of a directory are removed several
+ * per metadata commit (lfs_remove_files), the directories one by one.
+ * 
+ * @param ctx The recursive remove context (see cp23lfs_remove_recursive_start).
+ * @param budget Maximum number of entries to remove (0 = no limit).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_remove_recursive_step(cp23lfs_rmtree_t *ctx, uint32_t budget);
+
+
+/**
+ * @brief Removes a file or a directory tree.
+ * 
+ * Blocking version of cp23lfs_remove_recursive_start() + cp23lfs_remove_recursive_step().
+ * 
+ * @param path The file or directory to remove.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_remove_recursive(const char *path);
+
+
+/**
+ * @brief Removes several entries of the same directory.
+ * 
+ * This function removes the listed entries of dirPath in a single call: the files are removed several
+ * per metadata commit (lfs_remove_files). Missing entries are skipped, directories must be empty.
+ * 
+ * @param dirPath The parent directory.
+ * @param names The entry names (relative to dirPath).
+ * @param count The number of entries.
+ * @param removed The number of removed entries (can be NULL).
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_remove_multi(const char *dirPath, const char * const names[], uint32_t count, uint32_t *removed);
+
+
+/**
+ * @brief Finds the files matching a set of attribute conditions.
+ * 
+ * This function calls cb for each regular file under root whose attributes satisfy all the conditions.
+ * When a condition is CP23LFS_QOP_EQ on GROUP, or on a whole OWNER or COMPANY name (terminator within
+ * size, or the whole field), and the secondary indexes are valid, only the files listed in the matching
+ * index bucket are checked, otherwise the tree is scanned: both give the same result. GROUP conditions
+ * compare the owner group (LfsOwnerGroup) of the value and of the file flags.
+ * The callback must not modify the file system.
+ * 
+ * @param root The directory to search ("/" = whole file system).
+ * @param cond The conditions (all must be satisfied).
+ * @param condNum The number of conditions (0 = all files).
+ * @param cb The match callback.
+ * @param data The callback context.
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_query(const char *root, const cp23lfs_qcond_t cond[], uint32_t condNum, cp23lfs_query_cb_t cb, void *data);
+
+
+/**
+ * @brief Builds the secondary indexes.
+ * 
+ * This function scans the whole file system and (re)creates the persistent GROUP, OWNER and COMPANY
+ * indexes. Once built, the indexes are maintained by the CP23LFS functions on each commit. They must
+ * be rebuilt if a CP23LFS function fails while updating them.
+ * 
+ * @param None
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_index_build(void);
+
+
+/**
+ * @brief Removes the secondary indexes.
+ * 
+ * Queries fall back to the tree scan and commits no longer maintain the indexes.
+ * 
+ * @param None
+ * 
+ * @return CP23LFS_OK if the operation was successful, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_index_drop(void);
+
+
+/**
+ * @brief Starts the workload recorder.
+ * 
+ * The file system calls (CP23LFS_REC_xxx) are recorded in the buffer, in a compact binary form
+ * (paths as hashes), until it is full: the buffer can then be dumped from the unit and replayed
+ * (see cp23lfs_replay) on an image of the unit memory taken at the start.
+ * 
+ * @param buffer The records buffer.
+ * @param num The number of records of the buffer.
+ * @param clock The time stamp clock (NULL = no time stamps).
+ * 
+ * @return Nothing
+ */
+void cp23lfs_rec_start(cp23lfs_rec_t *buffer, uint32_t num, cp23lfs_recClock_t clock);
+
+
+/**
+ * @brief Stops the workload recorder.
+ * 
+ * @param lost The number of calls not recorded because the buffer was full (NULL if not needed).
+ * 
+ * @return The number of records.
+ */
+uint32_t cp23lfs_rec_stop(uint32_t *lost);
+
+
+/**
+ * @brief Returns the hash of a path, as recorded by the workload recorder.
+ * 
+ * @param path The path (normalized, e.g. "/dir/file").
+ * 
+ * @return The path hash.
+ */
+uint32_t cp23lfs_rec_hash(const char *path);
+
+
+/**
+ * @brief Replays a recorded workload.
+ * 
+ * The recorded calls are executed in order, back to back, so that the workload can be profiled
+ * repeatably (e.g. with the driver trace and energy estimate). The paths are resolved by the
+ * callback (e.g. from a listing of the memory image, hashed with cp23lfs_rec_hash): paths not
+ * resolved, such as the files created by the workload, are replaced by "/rp<hash>".
+ * Reads and writes use the buffer (the written data is its content), in chunks of its size.
+ * Calls failing on the image are counted, not stopped.
+ * 
+ * @param rec The records.
+ * @param num The number of records.
+ * @param resolve The path resolution callback (NULL = all paths replaced).
+ * @param buffer The data buffer.
+ * @param size The size of the buffer.
+ * @param failed The number of failed calls.
+ * 
+ * @return CP23LFS_OK if the replay was completed, a CP23LFS error code if a record is invalid.
+ */
+cp23lfs_errorcode_t cp23lfs_replay(const cp23lfs_rec_t rec[], uint32_t num, cp23lfs_replayPath_t resolve, 
+                                   void *buffer, lfs_size_t size, uint32_t *failed);
+
+
+/**
+ * @brief Measures the performance of a recorded workload.
+ * 
+ * The workload is replayed (see cp23lfs_replay) from a known memory image: the flash model is
+ * deterministic, so the metrics only change with the configuration and the library. The driver
+ * energy estimate is restarted by the measure.
+ * 
+ * @param rec The records.
+ * @param num The number of records.
+ * @param resolve The path resolution callback (NULL = all paths replaced).
+ * @param buffer The data buffer.
+ * @param size The size of the buffer.
+ * @param perf The metrics.
+ * 
+ * @return CP23LFS_OK if the replay was completed, a CP23LFS error code otherwise.
+ */
+cp23lfs_errorcode_t cp23lfs_perf_run(const cp23lfs_rec_t rec[], uint32_t num, cp23lfs_replayPath_t resolve, 
+                                     void *buffer, lfs_size_t size, cp23lfs_perf_t *perf);
+
+
+/**
+ * @brief Compares the performance of a workload with a stored baseline.
+ * 
+ * A metric regresses when it exceeds the baseline by more than the threshold: each regression
+ * is reported with LFS_WARN (baseline, measure and change), so a benchmark target can fail on a
+ * non zero result and print the diff.
+ * 
+ * @param base The baseline metrics.
+ * @param perf The measured metrics.
+ * @param threshold The allowed increase (percent of the baseline).
+ * 
+ * @return The regressed metrics (bit mask of CP23LFS_PERF_xxx, 0 = no regression).
+ */
+uint32_t cp23lfs_perf_check(const cp23lfs_perf_t *base, const cp23lfs_perf_t *perf, uint32_t threshold);
+
+
+#ifdef CP23LFS_STACK_CHECK
+/**
+ * @brief Starts a stack measure.
+ * 
+ * CP23LFS_STACK_PAINT bytes of stack below the caller frame are filled with a pattern: the
+ * caller stack must have them available (e.g. a test task with a large stack). The stack is
+ * assumed to grow downwards.
+ * 
+ * @param None
+ * @return Nothing
+ */
+void cp23lfs_stack_mark(void);
+
+
+/**
+ * @brief Returns the stack used since cp23lfs_stack_mark.
+ * 
+ * @param None
+ * @return The peak stack (bytes) below the cp23lfs_stack_mark caller frame.
+ */
+uint32_t cp23lfs_stack_used(void);
+
+
+/**
+ * @brief Checks the stack used since cp23lfs_stack_mark against the budget of a cp23 call.
+ * 
+ * The calls made since cp23lfs_stack_mark are flagged, and reported with LFS_WARN, when their
+ * peak stack is over CP23LFS_STACK_BUDGET. The measure includes the interrupts served during
+ * the calls. The worst-case paths (metadata splits, multi-block files, recursive removals, wear
+ * leveling) are driven by the host test test/test_stack.c, on the flash model.
+ * 
+ * @param measure The measure of the calls.
+ * @param name The measured calls (report name).
+ * 
+ * @return true if the peak stack is over the budget.
+ */
+bool cp23lfs_stack_check(cp23lfs_stack_t *measure, const char *name);
+#endif
+
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LITTLEFS_HEADER */
+
+/**
+  * @}
+*/
  
\ No newline at end of file
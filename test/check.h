@@ -0,0 +1,18 @@
+/**
+  *******************************************************************************
+  * @file           : check.h
+  * @brief          : Checks of the host tests (a failed check makes the test exit with 1)
+  ********************************************************************************
+*/
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int check_failed;
+
+#define CHECK(cond)         do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); check_failed++; } } while (0)
+#define CHECK_OK(call)      CHECK((call) == CP23LFS_OK)
+#define CHECK_DONE()        (printf("%s: %s\n", __FILE__, (check_failed) ? "FAILED" : "ok"), (check_failed) ? 1 : 0)
+
+#endif
@@ -0,0 +1,330 @@
+/**
+  *******************************************************************************
+  * @file           : flash_sim.c
+  * @brief          : Modelled IS25LP080D on the SPI1 line, for the host tests
+  ********************************************************************************
+*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "spi.h"
+#include "swtimer.h"
+#include "emulator.h"
+#include "flash_sim.h"
+
+#define SIM_BYTE_NS         160u            /* One byte at 50 MHz */
+#define SIM_PROG_NS         200000u         /* Page program, datasheet typical */
+#define SIM_SE_NS           70000000u       /* Sector erase, datasheet typical */
+#define SIM_BE32_NS         140000000u      /* 32K block erase, datasheet typical */
+#define SIM_BE_NS           170000000u      /* 64K block erase, datasheet typical */
+#define SIM_CLOCK_STEPS     8u              /* Clock steps of sim_clock_hook */
+#define SIM_VCC_MV          3300u           /* Supply voltage */
+#define SIM_READ_UA         8000u           /* Active read current, datasheet typical */
+#define SIM_WRITE_UA        12000u          /* Program/erase current, datasheet typical */
+#define SIM_STANDBY_UA      5u              /* Standby current, datasheet typical */
+#define SIM_POWERDOWN_UA    1u              /* Deep power-down current, datasheet typical */
+
+sim_t sim;
+
+static uint8_t simCmd;                      /* Command of the current chip select assertion */
+static uint32_t simAddr;                    /* Address of the command */
+static uint32_t simBytes;                   /* Bytes transferred in the assertion */
+static bool simWel;                         /* Write enable latch */
+static bool simWelCmd;                      /* Write enable latch at the command start */
+static bool simStuck;                       /* Bus stuck until a reset */
+static bool simResetEnable;                 /* Reset enabled (RSTEN received) */
+static uint64_t simBusyUntil;               /* End of the program/erase in progress */
+static uint64_t simPowerDownAt;             /* Start of the deep power-down */
+static sim_t simMark;                       /* Times at the last energy reset */
+
+
+void sim_init(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    memset(sim.mem, 0xFF, sizeof(sim.mem));
+    sim.readMaxStep = SIM_CLOCK_STEPS;
+    sim.fastMaxStep = SIM_CLOCK_STEPS;
+    simWel = false;
+    simStuck = false;
+    simResetEnable = false;
+    simBusyUntil = 0u;
+    simPowerDownAt = 0u;
+    simMark = sim;
+}
+
+
+uint32_t sim_clock_us(void)
+{
+    return (uint32_t)(sim.ns / 1000u);
+}
+
+
+void sim_energy(sim_energy_t *energy, bool reset)
+{
+    uint64_t powerDownNs = sim.powerDownNs + ((sim.powerDown) ? (sim.ns - simPowerDownAt) : 0u);
+    uint64_t timeUs = (sim.ns - simMark.ns) / 1000u;
+    uint64_t busUs = (sim.busNs - simMark.busNs) / 1000u;
+    uint64_t programUs = (sim.programNs - simMark.programNs) / 1000u;
+    uint64_t eraseUs = (sim.eraseNs - simMark.eraseNs) / 1000u;
+    uint64_t powerDownUs = (powerDownNs - simMark.powerDownNs) / 1000u;
+    uint64_t activeUs = busUs + programUs + eraseUs + powerDownUs;
+    uint64_t standbyUs = (timeUs > activeUs) ? (timeUs - activeUs) : 0u;        /* Program/erase still running */
+
+    energy->busUj = (uint32_t)((busUs * SIM_VCC_MV * SIM_READ_UA) / 1000000000u);
+    energy->programUj = (uint32_t)((programUs * SIM_VCC_MV * SIM_WRITE_UA) / 1000000000u);
+    energy->eraseUj = (uint32_t)((eraseUs * SIM_VCC_MV * SIM_WRITE_UA) / 1000000000u);
+    energy->standbyUj = (uint32_t)((standbyUs * SIM_VCC_MV * SIM_STANDBY_UA) / 1000000000u);
+    energy->powerDownUj = (uint32_t)((powerDownUs * SIM_VCC_MV * SIM_POWERDOWN_UA) / 1000000000u);
+    energy->totalUj = (uint32_t)((((busUs * SIM_READ_UA) + ((programUs + eraseUs) * SIM_WRITE_UA) + (standbyUs * SIM_STANDBY_UA) + 
+                                   (powerDownUs * SIM_POWERDOWN_UA)) * SIM_VCC_MV) / 1000000000u);
+    energy->timeUs = (uint32_t)timeUs;
+    if (reset)
+    {
+        simMark = sim;
+        simMark.powerDownNs = powerDownNs;
+    }
+}
+
+
+bool sim_clock_hook(uint32_t step)
+{
+    if (step >= SIM_CLOCK_STEPS)
+    {
+        return false;
+    }
+    sim.clockStep = step;
+    return true;
+}
+
+
+static uint8_t SimSfdp(uint32_t addr)
+{
+    static const uint8_t header[4] = {'S', 'F', 'D', 'P'};
+
+    return (addr < 4u) ? header[addr] : (uint8_t)(addr * 37u + 11u);
+}
+
+
+static void SimErase(uint32_t size, uint64_t ns)
+{
+    uint32_t base = simAddr & ~(size - 1u) & (SIM_SIZE - 1u);
+    uint32_t sector;
+
+    memset(&(sim.mem[base]), 0xFF, size);
+    for (sector = base / 4096u ; sector < (base + size) / 4096u ; sector++)
+    {
+        sim.sectorErases[sector]++;
+    }
+    sim.eraseNs += ns;
+    simBusyUntil = sim.ns + ns;
+}
+
+
+void SPIn_Init(uint8_t id)
+{
+    (void)id;
+}
+
+
+void SPI_CS_Enable(uint8_t id)
+{
+    (void)id;
+    sim.cs = true;
+    simCmd = 0u;
+    simAddr = 0u;
+    simBytes = 0u;
+}
+
+
+void SPI_CS_Disable(uint8_t id)
+{
+    bool busy = (sim.ns < simBusyUntil);
+    bool write = (simCmd == 0x02) || (simCmd == 0x20) || (simCmd == 0x52) || (simCmd == 0xD8);
+    uint64_t factor;
+
+    (void)id;
+    sim.cs = false;
+    if (simBytes == 0u)
+    {
+        return;
+    }
+    sim.cmds[simCmd]++;
+    if (sim.powerDown)
+    {
+        if (simCmd == 0xAB)
+        {
+            sim.powerDown = false;          /* Only RDP wakes the memory up */
+            sim.powerDownNs += sim.ns - simPowerDownAt;
+        }
+        return;
+    }
+    if ((simCmd == 0x99) && (simResetEnable))
+    {
+        simStuck = false;
+        simWel = false;
+        simBusyUntil = 0u;
+    }
+    simResetEnable = (simCmd == 0x66);
+    if ((simStuck) || (busy))
+    {
+        return;
+    }
+    if (simCmd == 0x06)
+    {
+        simWel = true;
+    }
+    else if (simCmd == 0x04)
+    {
+        simWel = false;
+    }
+    else if (simCmd == 0xB9)
+    {
+        sim.powerDown = true;
+        simPowerDownAt = sim.ns;
+    }
+    else if ((write) && (simWelCmd) && (sim.stuckCmds > 0u))
+    {
+        sim.stuckCmds--;
+        simStuck = true;                    /* Command lost, no memory driving the bus */
+    }
+    else if ((write) && (simWelCmd) && (simBytes >= 4u))
+    {
+        factor = ((sim.slowFactor > 0u) && (((simAddr & (SIM_SIZE - 1u)) / 4096u) == sim.slowSector)) ? sim.slowFactor : 1u;
+        if (simCmd == 0x02)
+        {
+            sim.programs++;
+            sim.programNs += factor * SIM_PROG_NS;
+            simBusyUntil = sim.ns + (factor * SIM_PROG_NS);
+        }
+        else
+        {
+            SimErase((simCmd == 0x20) ? 4096u : ((simCmd == 0x52) ? 32768u : 65536u), 
+                     factor * ((simCmd == 0x20) ? SIM_SE_NS : ((simCmd == 0x52) ? SIM_BE32_NS : SIM_BE_NS)));
+        }
+        simWel = false;
+    }
+}
+
+
+bool SPI_Transmit(uint8_t id, void *data, uint32_t size)
+{
+    uint8_t const *byte = (uint8_t const *)data;
+    uint32_t addr;
+    uint32_t i;
+
+    (void)id;
+    for (i = 0 ; i < size ; i++, simBytes++)
+    {
+        sim.busNs += (sim.ns >= simBusyUntil) ? SIM_BYTE_NS : 0u;     /* Busy: the program/erase current */
+        sim.ns += SIM_BYTE_NS;
+        if (simBytes == 0u)
+        {
+            simCmd = byte[i];
+            simWelCmd = simWel && (sim.ns >= simBusyUntil) && (!simStuck) && (!sim.powerDown);
+        }
+        else if (simBytes < 4u)
+        {
+            simAddr = (simAddr << 8) | byte[i];
+        }
+        else if ((simCmd == 0x02) && (simWelCmd) && (sim.stuckCmds == 0u))
+        {
+            /* Program: data wraps in the page, bits can only be cleared */
+            addr = ((simAddr & ~0xFFu) | ((simAddr + simBytes - 4u) & 0xFFu)) & (SIM_SIZE - 1u);
+            sim.badPrograms += ((byte[i] & ~sim.mem[addr]) != 0u) ? 1u : 0u;
+            sim.mem[addr] &= byte[i];
+        }
+    }
+    return true;
+}
+
+
+bool SPI_Receive(uint8_t id, void *data, uint32_t size)
+{
+    uint8_t *byte = (uint8_t *)data;
+    uint32_t i;
+
+    (void)id;
+    for (i = 0 ; i < size ; i++, simBytes++)
+    {
+        sim.busNs += (sim.ns >= simBusyUntil) ? SIM_BYTE_NS : 0u;     /* Busy: the program/erase current */
+        sim.ns += SIM_BYTE_NS;
+        if (sim.powerDown)
+        {
+            byte[i] = 0xFF;                 /* No output in deep power-down */
+        }
+        else if ((simStuck) || ((simCmd == 0x05) && (sim.glitchReads > 0u)))
+        {
+            sim.glitchReads -= (sim.glitchReads > 0u) ? 1u : 0u;
+            byte[i] = 0xFF;
+        }
+        else if (simCmd == 0x05)
+        {
+            if (sim.ns < simBusyUntil)
+            {
+                sim.ns += ((simBusyUntil - sim.ns) < (SIM_POLL_US * 1000u)) ? (simBusyUntil - sim.ns) : (SIM_POLL_US * 1000u);
+            }
+            byte[i] = (uint8_t)((sim.ns < simBusyUntil) ? 0x03u : ((simWel) ? 0x02u : 0x00u));    /* WEL cleared at the end of the operation */
+        }
+        else if (simCmd == 0x03)
+        {
+            byte[i] = sim.mem[(simAddr + simBytes - 4u) & (SIM_SIZE - 1u)] ^ ((sim.clockStep > sim.readMaxStep) ? 0x10u : 0x00u);
+        }
+        else if (simCmd == 0x0B)
+        {
+            byte[i] = sim.mem[(simAddr + simBytes - 5u) & (SIM_SIZE - 1u)] ^ ((sim.clockStep > sim.fastMaxStep) ? 0x10u : 0x00u);
+        }
+        else if (simCmd == 0x5A)
+        {
+            byte[i] = SimSfdp((simAddr + simBytes - 5u) & 0xFFu) ^ ((sim.clockStep > sim.fastMaxStep) ? 0x10u : 0x00u);
+        }
+        else
+        {
+            byte[i] = 0xFF;
+        }
+    }
+    return true;
+}
+
+
+void LoadSWTimer(swtimer_t *timer)
+{
+    *timer = sim_clock_us();
+}
+
+
+bool SWTimerTimeout(swtimer_t *timer, uint32_t value, swunit_t unit, void *arg)
+{
+    uint32_t us = (unit == uSec) ? value : ((unit == mSec) ? (value * 1000u) : (value * 1000000u));
+
+    (void)arg;
+    sim.ns += 1000u;                        /* The polling loop itself takes time */
+    return ((uint32_t)(sim_clock_us() - *timer) >= us);
+}
+
+
+void RTT_Printf(int code, ...)
+{
+    va_list args;
+    const char *format;
+
+    sim.events++;
+    if ((sim.verbose) && (code != RTT_EC_IS25LP080D_TIMEOUT))
+    {
+        va_start(args, code);
+        format = va_arg(args, const char *);
+        printf("RTT %d: ", code);
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+    }
+}
+
+
+void ManageEventError(int code, bool set, uint32_t info)
+{
+    (void)set;
+    if (sim.verbose)
+    {
+        printf("event %d (%lu)\n", code, (unsigned long)info);
+    }
+}
@@ -0,0 +1,87 @@
+/**
+  *******************************************************************************
+  * @file           : flash_sim.h
+  * @brief          : Modelled IS25LP080D on the SPI1 line, for the host tests
+  *
+  *     The model decodes the commands used by the driver (READ, FAST READ, PP, SE, BE32, BE, RDSR, WREN,
+  *     WRDI, RSTEN/RST, RDSFDP, DP/RDP), keeps the memory content with the NOR program semantic
+  *     (bits only cleared) and runs on a virtual time: every byte takes the 50 MHz SPI time,
+  *     program and erase keep the memory busy for the datasheet typical times, every status poll
+  *     lets SIM_POLL_US elapse. The driver software timers use the same virtual time, over which
+  *     sim_energy integrates the supply current of the memory state (transfer, program, erase,
+  *     standby or deep power-down).
+  ********************************************************************************
+*/
+#ifndef FLASH_SIM_H
+#define FLASH_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_SIZE            (1u << 20)      /* Memory size (8 Mbit) */
+#define SIM_SECTORS         256u            /* 4K sectors */
+#define SIM_POLL_US         500u            /* Virtual time between two status polls */
+
+typedef struct
+{
+    uint8_t mem[SIM_SIZE];                  /* Memory content */
+    uint64_t ns;                            /* Virtual time (nSec) */
+    uint64_t eraseNs;                       /* Time spent erasing */
+    uint64_t programNs;                     /* Time spent programming */
+    uint64_t busNs;                         /* Time spent transferring bytes */
+    uint64_t powerDownNs;                   /* Time spent in deep power-down (ended periods) */
+    uint32_t cmds[256];                     /* Commands received, per opcode */
+    uint32_t sectorErases[SIM_SECTORS];     /* Erases per sector (block erases count on their sectors) */
+    uint32_t programs;                      /* Page programs executed */
+    uint32_t badPrograms;                   /* Programs clearing bits of a not erased byte that the data wants set */
+    uint32_t stuckCmds;                     /* Fault: next program/erase commands leaving the bus stuck (0xFF) until a reset */
+    uint32_t glitchReads;                   /* Fault: next status reads returning 0xFF */
+    uint32_t slowSector;                    /* Fault: sector whose programs and erases take slowFactor times longer */
+    uint32_t slowFactor;                    /* Fault: duration factor of the slow sector (0 = no slow sector) */
+    uint32_t clockStep;                     /* SPI clock step (set through sim_clock_hook) */
+    uint32_t readMaxStep;                   /* Fastest clock step reading READ (0x03) data correctly */
+    uint32_t fastMaxStep;                   /* Fastest clock step reading FAST READ (0x0B) and SFDP data correctly */
+    bool cs;                                /* Chip select asserted */
+    bool powerDown;                         /* Deep power-down (only RDP accepted) */
+    uint32_t events;                        /* LFS warnings/errors and driver events */
+    bool verbose;                           /* Print the events */
+} sim_t;
+
+typedef struct
+{
+    uint32_t busUj;                         /* Transfers */
+    uint32_t programUj;                     /* Programs */
+    uint32_t eraseUj;                       /* Erases */
+    uint32_t standbyUj;                     /* Standby (selected or not, not busy) */
+    uint32_t powerDownUj;                   /* Deep power-down */
+    uint32_t totalUj;                       /* Total */
+    uint32_t timeUs;                        /* Virtual time elapsed */
+} sim_energy_t;                             /* Energy of the memory over the virtual time */
+
+extern sim_t sim;
+
+/**
+ * @brief Erases the whole model and clears its counters and faults.
+ */
+void sim_init(void);
+
+/**
+ * @brief Virtual time in uSec (trace and recorder clock).
+ */
+uint32_t sim_clock_us(void);
+
+/**
+ * @brief Energy of the memory since the last reset (or sim_init), per state.
+ *
+ * The datasheet typical currents at 3.3 V are integrated over the virtual time: transfers at the
+ * read current, programs and erases at the program/erase current for their whole duration, deep
+ * power-down at its current and the rest of the time at the standby current.
+ */
+void sim_energy(sim_energy_t *energy, bool reset);
+
+/**
+ * @brief SPI clock hook for IS25LP080D_SetClockTuning (steps 0 to 7).
+ */
+bool sim_clock_hook(uint32_t step);
+
+#endif
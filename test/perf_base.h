@@ -0,0 +1,15 @@
+/**
+  *******************************************************************************
+  * @file           : perf_base.h
+  * @brief          : Performance baseline of test_perf.c (host build, flash model)
+  *
+  *     Metrics in the order of CP23LFS_PERF_xxx. The RAM metric is the size of the host
+  *     build (64-bit pointers), not of the target.
+  ********************************************************************************
+*/
+#ifndef PERF_BASE_H
+#define PERF_BASE_H
+
+#define PERF_BASE   {2596320u, 375756u, 431u, 35u, 11648u, 0u}
+
+#endif /* PERF_BASE_H */
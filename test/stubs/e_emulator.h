@@ -0,0 +1,3 @@
+/* Host stub of the firmware e_emulator.h */
+#pragma once
+#include "emulator.h"
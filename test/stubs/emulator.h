@@ -0,0 +1,14 @@
+/* Host stub of the firmware emulator.h (event and RTT codes) */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RTT_EC_IS25LP080D_TIMEOUT   1
+#define EC_IS25LP080D_TIMEOUT       1
+#define RTT_EC_LITTLEFS_WARNING     2
+#define EC_LITTLEFS_WARNING         2
+#define RTT_EC_LITTLEFS_ERROR       3
+#define EC_LITTLEFS_ERROR           3
+
+void RTT_Printf(int code, ...);
+void ManageEventError(int code, bool set, uint32_t info);
@@ -0,0 +1,5 @@
+/* Host stub of the firmware errorcodes.h */
+#pragma once
+#include "emulator.h"
+
+#define CP23LFS_ERRORCODE_OFFSET    1000
@@ -0,0 +1,2 @@
+/* Host stub of gpio.h */
+#pragma once
@@ -0,0 +1,2 @@
+/* Host stub of safeheap.h (LFS_NO_MALLOC build) */
+#pragma once
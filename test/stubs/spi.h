@@ -0,0 +1,12 @@
+/* Host stub of spi.h: the SPI line is served by the modelled flash (flash_sim.c) */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SPI1_ID     0
+
+void SPIn_Init(uint8_t id);
+bool SPI_Transmit(uint8_t id, void *data, uint32_t size);
+bool SPI_Receive(uint8_t id, void *data, uint32_t size);
+void SPI_CS_Enable(uint8_t id);
+void SPI_CS_Disable(uint8_t id);
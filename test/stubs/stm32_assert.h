@@ -0,0 +1,5 @@
+/* Host stub of stm32_assert.h */
+#pragma once
+#include <assert.h>
+
+#define assert_param(expr)  assert(expr)
@@ -0,0 +1,15 @@
+/* Host stub of swtimer.h: timers run on the virtual time of the modelled flash (flash_sim.c) */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t swtimer_t;
+typedef enum
+{
+    uSec,
+    mSec,
+    Sec
+} swunit_t;
+
+void LoadSWTimer(swtimer_t *timer);
+bool SWTimerTimeout(swtimer_t *timer, uint32_t value, swunit_t unit, void *arg);
@@ -0,0 +1,18 @@
+/* Host stub of the firmware utilities.h (only what the memory driver and littlefs.c use) */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NOT_USED(x)     ((void)(x))
+
+typedef union
+{
+    uint32_t w;
+    uint8_t b[4];
+} split32_t;
+
+#define SPLIT_T0        0
+#define SPLIT_T1        1
+#define SPLIT_T2        2
+#define SPLIT_T3        3
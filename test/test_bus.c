@@ -0,0 +1,105 @@
+/**
+  *******************************************************************************
+  * @file           : test_bus.c
+  * @brief          : SPI bus sharing (IS25LP080D_SetBusSharing, IS25LP080D_GetMaxBusHold)
+  *
+  *     With a small maxChunk and a counting arbitration hook: reads are split in chunks, each
+  *     with its own read command; programs crossing pages are split at the page boundaries and
+  *     every maxChunk bytes, the data landing at its address (no wrap inside a page); every chip
+  *     select assertion, status polls included, is inside an acquire/release pair of the hook;
+  *     the worst-case bus hold is one command with maxChunk data bytes. Without sharing, a
+  *     program crossing a page takes one page program per page.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define CHUNK       64u                                         /* Max data bytes per chip select assertion */
+#define READ_SIZE   1000u
+#define PROG_ADDR   (8u * 4096u + 200u)                         /* Program crossing a page boundary */
+#define PROG_SIZE   300u
+
+static uint8_t data[READ_SIZE];
+static uint8_t buffer[READ_SIZE];
+static uint32_t acquires;
+static uint32_t releases;
+static uint32_t misuses;                                        /* Unpaired calls, or calls with the chip select asserted */
+
+
+static void Hook(bool acquire)
+{
+    misuses += (sim.cs) ? 1u : 0u;
+    if (acquire)
+    {
+        misuses += (acquires != releases) ? 1u : 0u;
+        acquires++;
+    }
+    else
+    {
+        releases++;
+        misuses += (acquires != releases) ? 1u : 0u;
+    }
+}
+
+
+static uint32_t Reads(void)
+{
+    return sim.cmds[0x03] + sim.cmds[0x0B];
+}
+
+
+int main(void)
+{
+    uint32_t commands;
+    uint32_t programs;
+    uint32_t reads;
+    uint32_t n;
+
+    for (n = 0 ; n < READ_SIZE ; n++)
+    {
+        data[n] = (uint8_t)(n * 7u);
+    }
+    sim_init();
+    IS25LP080D_Init();
+    IS25LP080D_SetEraseDeferral(false);
+    CHECK(IS25LP080D_Erase(NULL, 0u, 4096u) == 0);
+    CHECK(IS25LP080D_Program(NULL, 0u, data, READ_SIZE) == 0);
+    CHECK(IS25LP080D_Erase(NULL, PROG_ADDR & ~4095u, 4096u) == 0);
+
+    /* Without sharing: one page program per page crossed, whole reads */
+    programs = sim.programs;
+    CHECK(IS25LP080D_Program(NULL, PROG_ADDR - 4096u, data, PROG_SIZE) == 0);
+    CHECK(sim.programs == (programs + 2u));
+    CHECK(memcmp(&sim.mem[PROG_ADDR - 4096u], data, PROG_SIZE) == 0);
+    (void)IS25LP080D_GetMaxBusHold(true);
+    reads = Reads();
+    CHECK(IS25LP080D_Read(NULL, 0u, buffer, READ_SIZE) == 0);
+    CHECK((Reads() == (reads + 1u)) && (memcmp(buffer, data, READ_SIZE) == 0));
+    CHECK(IS25LP080D_GetMaxBusHold(true) == (5u + READ_SIZE));
+
+    /* Chunked read */
+    IS25LP080D_SetBusSharing(CHUNK, Hook);
+    memset(buffer, 0, sizeof(buffer));
+    reads = Reads();
+    CHECK(IS25LP080D_Read(NULL, 0u, buffer, READ_SIZE) == 0);
+    CHECK(Reads() == (reads + ((READ_SIZE + CHUNK - 1u) / CHUNK)));
+    CHECK(memcmp(buffer, data, READ_SIZE) == 0);
+    CHECK(IS25LP080D_GetMaxBusHold(true) == (5u + CHUNK));      /* FAST READ command, address and dummy byte */
+    CHECK((acquires == Reads() - reads) && (releases == acquires));
+
+    /* Program crossing a page: 56 bytes to the page end, then 64 byte chunks */
+    programs = sim.programs;
+    commands = acquires;
+    CHECK(IS25LP080D_Program(NULL, PROG_ADDR, data, PROG_SIZE) == 0);
+    CHECK(sim.programs == (programs + 1u + ((PROG_SIZE - (256u - (PROG_ADDR % 256u)) + CHUNK - 1u) / CHUNK)));
+    CHECK(IS25LP080D_GetMaxBusHold(true) == (4u + CHUNK));      /* PP command and address */
+    CHECK(memcmp(&sim.mem[PROG_ADDR], data, PROG_SIZE) == 0);
+    printf("program: %lu page programs, %lu hook pairs (write enables and status polls included)\n",
+           (unsigned long)(sim.programs - programs), (unsigned long)(acquires - commands));
+    CHECK((acquires - commands) == (3u * (sim.programs - programs)));   /* Write enable, program and its status poll */
+    CHECK((releases == acquires) && (misuses == 0u));
+    IS25LP080D_SetBusSharing(0u, NULL);
+    return CHECK_DONE();
+}
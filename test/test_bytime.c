@@ -0,0 +1,122 @@
+/**
+  *******************************************************************************
+  * @file           : test_bytime.c
+  * @brief          : Time ordered listing (cp23lfs_list_bytime)
+  *
+  *     Creates files with creation times out of the name order, two of them at the same time,
+  *     and a sub-directory. Checks both orders over the whole time range and over ranges with
+  *     bounds on, just inside and just outside the file times (both bounds included), a single
+  *     time, an empty range, entries fewer than the matching files (the first ones in the
+  *     requested order), the names and sizes returned, and the errors of a missing directory and
+  *     of a file path, which leave no directory open.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define FILES       8u
+#define ALL         0xFFFFFFFFu
+
+typedef struct
+{
+    uint32_t from;
+    uint32_t to;
+    uint8_t order;
+    uint32_t maxEntries;
+    uint32_t count;
+    uint32_t epoch[FILES];                                      /* Expected times, in the listing order */
+}range_t;
+
+static const uint32_t epochs[FILES] = {1000u, 1500u, 1200u, 2000u, 1200u, 900u, 3000u, 1999u};
+
+static const range_t ranges[] =
+{
+    {0u, ALL, CP23LFS_ORDER_OLDEST, FILES, 8u, {900u, 1000u, 1200u, 1200u, 1500u, 1999u, 2000u, 3000u}},
+    {0u, ALL, CP23LFS_ORDER_NEWEST, FILES, 8u, {3000u, 2000u, 1999u, 1500u, 1200u, 1200u, 1000u, 900u}},
+    {1200u, 2000u, CP23LFS_ORDER_OLDEST, FILES, 5u, {1200u, 1200u, 1500u, 1999u, 2000u}},   /* On the file times */
+    {1200u, 2000u, CP23LFS_ORDER_NEWEST, FILES, 5u, {2000u, 1999u, 1500u, 1200u, 1200u}},
+    {1201u, 1999u, CP23LFS_ORDER_OLDEST, FILES, 2u, {1500u, 1999u}},                        /* Just inside them */
+    {1199u, 2001u, CP23LFS_ORDER_OLDEST, FILES, 5u, {1200u, 1200u, 1500u, 1999u, 2000u}},   /* Just outside them */
+    {900u, 900u, CP23LFS_ORDER_OLDEST, FILES, 1u, {900u}},                                  /* First time only */
+    {3000u, ALL, CP23LFS_ORDER_NEWEST, FILES, 1u, {3000u}},                                 /* Last time only */
+    {1200u, 1200u, CP23LFS_ORDER_NEWEST, FILES, 2u, {1200u, 1200u}},                        /* Two files at one time */
+    {2001u, 2999u, CP23LFS_ORDER_OLDEST, FILES, 0u, {0u}},                                  /* Between two times */
+    {0u, 899u, CP23LFS_ORDER_OLDEST, FILES, 0u, {0u}},                                      /* Before the first time */
+    {2000u, 1200u, CP23LFS_ORDER_OLDEST, FILES, 0u, {0u}},                                  /* From after to */
+    {0u, ALL, CP23LFS_ORDER_OLDEST, 3u, 3u, {900u, 1000u, 1200u}},                          /* Fewer entries: oldest ones */
+    {0u, ALL, CP23LFS_ORDER_NEWEST, 3u, 3u, {3000u, 2000u, 1999u}},                         /* Fewer entries: newest ones */
+    {1000u, 2000u, CP23LFS_ORDER_NEWEST, 4u, 4u, {2000u, 1999u, 1500u, 1200u}},
+    {0u, ALL, CP23LFS_ORDER_NEWEST, 0u, 0u, {0u}},                                          /* No entry */
+};
+
+static uint32_t now;
+
+
+static uint32_t Clock(void)
+{
+    return now;
+}
+
+
+int main(void)
+{
+    cp23lfs_timeEntry_t entries[FILES + 1u];
+    cp23lfs_mem_t mem;
+    cp23lfs_file_t file;
+    uint8_t data[FILES * 10u];
+    char path[16];
+    uint32_t count;
+    uint32_t cnt;
+    uint32_t n;
+    uint32_t k;
+
+    memset(data, 0x5A, sizeof(data));
+    sim_init();
+    CHECK_OK(CP23Init());
+    cp23lfs_set_clock(Clock);
+    CHECK_OK(cp23lfs_mkdir("/t"));
+    CHECK_OK(cp23lfs_mkdir("/t/sub"));                          /* Not listed */
+    for (n = 0 ; n < FILES ; n++)
+    {
+        now = epochs[n];
+        snprintf(path, sizeof(path), "/t/f%lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT));
+        CHECK(cp23lfs_file_write(file, data, n * 10u) == (lfs_ssize_t)(n * 10u));
+        CHECK_OK(cp23lfs_file_close(file));
+    }
+    now = 5000u;
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/t/sub/g", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK_OK(cp23lfs_file_close(file));
+
+    for (cnt = 0 ; cnt < (sizeof(ranges) / sizeof(ranges[0])) ; cnt++)
+    {
+        memset(entries, 0xA5, sizeof(entries));
+        CHECK_OK(cp23lfs_list_bytime("t/", ranges[cnt].from, ranges[cnt].to, ranges[cnt].order,
+                                     entries, ranges[cnt].maxEntries, &count));
+        CHECK(count == ranges[cnt].count);
+        for (k = 0 ; (k < count) && (k < FILES) ; k++)
+        {
+            /* The entry name gives the file written: its time and size */
+            n = (uint32_t)(entries[k].name[1] - '0');
+            CHECK((entries[k].name[0] == 'f') && (entries[k].name[2] == '\0') && (n < FILES));
+            CHECK((entries[k].epoch == ranges[cnt].epoch[k]) && (n < FILES) && (epochs[n % FILES] == entries[k].epoch));
+            CHECK(entries[k].size == (n * 10u));
+        }
+        CHECK(entries[count].epoch == 0xA5A5A5A5u);             /* Nothing written after the entries */
+    }
+    CHECK_OK(cp23lfs_list_bytime("/t", 0u, ALL, CP23LFS_ORDER_OLDEST, entries, FILES, &count));
+    CHECK((count == FILES) && (strcmp(entries[2].name, entries[3].name) != 0));
+
+    CHECK(cp23lfs_list_bytime("/none", 0u, ALL, CP23LFS_ORDER_OLDEST, entries, FILES, &count) ==
+          CP23LFS_ERRORCODE(LFS_ERR_NOENT));
+    CHECK(count == 0u);
+    CHECK(cp23lfs_list_bytime("/t/f1", 0u, ALL, CP23LFS_ORDER_OLDEST, entries, FILES, &count) ==
+          CP23LFS_ERRORCODE(LFS_ERR_NOTDIR));
+    cp23lfs_mem_stats(&mem, false);
+    CHECK(mem.dirsUsed == 0u);                                  /* No directory left open, or closed twice */
+    printf("%lu files, %lu ranges checked\n", (unsigned long)FILES, (unsigned long)cnt);
+    return CHECK_DONE();
+}
@@ -0,0 +1,69 @@
+/**
+  *******************************************************************************
+  * @file           : test_clock.c
+  * @brief          : SPI clock tuning (IS25LP080D_SetClockTuning, IS25LP080D_ClockTune)
+  *
+  *     The model reads READ (0x03) data correctly up to a slower clock step than FAST READ
+  *     (0x0B) and SFDP data. Checks that the clock settles on the fastest step of the SFDP
+  *     reads and that the files written and read at this clock are correct, the data reads
+  *     having the timing validated by the tuning.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define READ_MAX    2u
+#define FAST_MAX    5u
+#define FILES       8u
+
+static uint8_t data[3000];
+static uint8_t buffer[3000];
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    uint32_t n;
+    char path[16];
+
+    for (n = 0 ; n < sizeof(data) ; n++)
+    {
+        data[n] = (uint8_t)(n * 7u);
+    }
+    sim_init();
+    sim.readMaxStep = READ_MAX;
+    sim.fastMaxStep = FAST_MAX;
+    IS25LP080D_SetClockTuning(sim_clock_hook, 7u);
+    CHECK_OK(CP23Init());
+    printf("clock step %lu (READ max %u, FAST READ/SFDP max %u)\n", (unsigned long)IS25LP080D_GetClockStep(), READ_MAX, FAST_MAX);
+    CHECK(IS25LP080D_GetClockStep() == FAST_MAX);
+
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/c%lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+        CHECK(cp23lfs_file_write(file, data, sizeof(data) - n) == (lfs_ssize_t)(sizeof(data) - n));
+        CHECK_OK(cp23lfs_file_close(file));
+    }
+
+    /* Read back at the tuned clock, then after a remount */
+    for (n = 0 ; n < (2u * FILES) ; n++)
+    {
+        if (n == FILES)
+        {
+            CHECK_OK(CP23Init());
+        }
+        snprintf(path, sizeof(path), "/c%lu", (unsigned long)(n % FILES));
+        memset(buffer, 0, sizeof(buffer));
+        CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_RDONLY));
+        CHECK(cp23lfs_file_read(file, buffer, sizeof(buffer)) == (lfs_ssize_t)(sizeof(data) - (n % FILES)));
+        CHECK(memcmp(buffer, data, sizeof(data) - (n % FILES)) == 0);
+        CHECK_OK(cp23lfs_file_close(file));
+    }
+    CHECK(sim.cmds[0x0B] > 0u);
+    CHECK(IS25LP080D_GetClockStep() == FAST_MAX);
+    return CHECK_DONE();
+}
@@ -0,0 +1,153 @@
+/**
+  *******************************************************************************
+  * @file           : test_energy.c
+  * @brief          : Energy estimate of the memory operations (IS25LP080D_GetEnergy)
+  *
+  *     Writes one 96 KB file with single sector erases and with the erase deferral (see
+  *     IS25LP080D_SetEraseDeferral), then reads it back. Checks that the estimate counts the
+  *     programs and erases executed by the modelled flash, that the deferral erases no sector
+  *     LFS did not ask for (LFS programs each block right after erasing it: nothing to merge),
+  *     and that reading costs much less than writing. Each workload is also reported with the
+  *     energy the flash model integrates over its virtual time (sim_energy), standby included:
+  *     the driver estimate must match its transfer, program and erase terms. A queued aligned
+  *     64K range is merged into one block erase, which saves energy. Last, an idle second costs
+  *     less in deep power-down than in standby.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "spi.h"
+#include "check.h"
+
+#define FILE_SIZE   (96u * 1024u)
+#define CHUNK       512u
+#define IDLE_NS     1000000000u                                 /* Idle period (1 second) */
+
+static uint8_t data[CHUNK];
+
+
+/* Reports the model energy of a workload and checks the driver estimate against it */
+static void Report(const char *name, const IS25LP080D_energy_t *energy)
+{
+    sim_energy_t model;
+
+    sim_energy(&model, true);
+    printf("%s, model: %lu uJ in %lu ms (bus %lu, program %lu, erase %lu, standby %lu)\n", name, (unsigned long)model.totalUj,
+           (unsigned long)(model.timeUs / 1000u), (unsigned long)model.busUj, (unsigned long)model.programUj,
+           (unsigned long)model.eraseUj, (unsigned long)model.standbyUj);
+    CHECK((energy->programUj == model.programUj) && (energy->eraseUj == model.eraseUj));
+    CHECK((energy->busUj >= model.busUj) && (energy->busUj <= (model.busUj + 1u + (model.busUj / 20u))));
+}
+
+
+/* Sends a single byte command to the memory */
+static void Command(uint8_t opcode)
+{
+    SPI_CS_Enable(SPI1_ID);
+    CHECK(SPI_Transmit(SPI1_ID, &opcode, 1u));
+    SPI_CS_Disable(SPI1_ID);
+}
+
+
+static uint32_t Write(bool merge, uint32_t *sectors)
+{
+    IS25LP080D_energy_t energy;
+    sim_energy_t model;
+    cp23lfs_file_t file;
+    uint32_t programs;
+    uint32_t off;
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    IS25LP080D_SetEraseDeferral(merge);
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+    sim_energy(&model, true);
+    programs = sim.programs;
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/e", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    for (off = 0 ; off < FILE_SIZE ; off += CHUNK)
+    {
+        CHECK(cp23lfs_file_write(file, data, CHUNK) == (lfs_ssize_t)CHUNK);
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+    printf("write, %s: %lu programs, %lu/%lu/%lu sector/32K/64K erases, %lu uJ (bus %lu, program %lu, erase %lu)\n",
+           (merge) ? "deferred erases" : "single erases", (unsigned long)energy.programs, (unsigned long)energy.erases[0],
+           (unsigned long)energy.erases[1], (unsigned long)energy.erases[2], (unsigned long)energy.totalUj,
+           (unsigned long)energy.busUj, (unsigned long)energy.programUj, (unsigned long)energy.eraseUj);
+    CHECK(energy.programs == (sim.programs - programs));
+    Report((merge) ? "write, deferred erases" : "write, single erases", &energy);
+    *sectors = energy.erases[0] + (8u * energy.erases[1]) + (16u * energy.erases[2]);
+    return energy.totalUj;
+}
+
+
+int main(void)
+{
+    IS25LP080D_energy_t energy;
+    sim_energy_t model;
+    cp23lfs_file_t file;
+    uint32_t single;
+    uint32_t merged;
+    uint32_t sectors[2];
+    uint32_t off;
+
+    memset(data, 0xA5, sizeof(data));
+    single = Write(false, &(sectors[0]));
+    merged = Write(true, &(sectors[1]));
+    CHECK(sectors[1] == sectors[0]);
+    CHECK(merged <= single);
+
+    /* Read back */
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/e", LFS_O_RDONLY));
+    for (off = 0 ; off < FILE_SIZE ; off += CHUNK)
+    {
+        CHECK(cp23lfs_file_read(file, data, CHUNK) == (lfs_ssize_t)CHUNK);
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+    IS25LP080D_GetEnergy(&energy, true);
+    printf("read: %lu uJ\n", (unsigned long)energy.totalUj);
+    Report("read", &energy);
+    CHECK((energy.programs == 0u) && (energy.totalUj < (merged / 10u)));
+
+    /* Aligned 64K range queued sector by sector: one block erase */
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+    sim_energy(&model, true);
+    for (off = 0 ; off < (16u * 4096u) ; off += 4096u)
+    {
+        CHECK(IS25LP080D_Erase(NULL, (64u * 4096u) + off, 4096u) == 0);
+    }
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+    merged = energy.eraseUj;
+    CHECK((energy.erases[0] == 0u) && (energy.erases[2] == 1u));
+    IS25LP080D_SetEraseDeferral(false);
+    for (off = 0 ; off < (16u * 4096u) ; off += 4096u)
+    {
+        CHECK(IS25LP080D_Erase(NULL, (64u * 4096u) + off, 4096u) == 0);
+    }
+    IS25LP080D_GetEnergy(&energy, true);
+    single = energy.eraseUj;
+    printf("64K range: %lu uJ merged, %lu uJ as 16 sector erases\n", (unsigned long)merged, (unsigned long)single);
+    CHECK((energy.erases[0] == 16u) && ((4u * merged) < single));
+
+    /* Idle second in standby, then in deep power-down (DP, RDP) */
+    sim_energy(&model, true);
+    sim.ns += IDLE_NS;
+    sim_energy(&model, true);
+    single = model.standbyUj;
+    Command(0xB9);
+    sim.ns += IDLE_NS;
+    Command(0xAB);
+    sim_energy(&model, true);
+    merged = model.powerDownUj;
+    printf("idle second: %lu uJ in standby, %lu uJ in deep power-down\n", (unsigned long)single, (unsigned long)merged);
+    CHECK((model.powerDownUj > 0u) && (model.powerDownUj < single) && (model.standbyUj == 0u));
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/e", LFS_O_RDONLY));                /* Memory awake */
+    CHECK_OK(cp23lfs_file_close(file));
+    return CHECK_DONE();
+}
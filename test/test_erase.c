@@ -0,0 +1,134 @@
+/**
+  *******************************************************************************
+  * @file           : test_erase.c
+  * @brief          : Queued sector erases merged into block erases (IS25LP080D_SetEraseDeferral)
+  *
+  *     Rewrites four 96 KB files six times, with single sector erases and with the erase deferral,
+  *     checks that the deferral erases no more (only the erases issued by LFS are merged) and
+  *     reads the files back after a remount.
+  *     Then checks that a queued erase failing on the memory stays queued: the program of its
+  *     sector fails, and succeeds on the erased sector once the memory recovers.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define FILES       4u
+#define FILE_SIZE   (96u * 1024u)
+#define REWRITES    6u
+#define CHUNK       512u
+
+static uint8_t data[CHUNK];
+
+
+static void Fill(uint32_t file, uint32_t pass, uint32_t off)
+{
+    uint32_t i;
+
+    for (i = 0 ; i < CHUNK ; i++)
+    {
+        data[i] = (uint8_t)((file * 31u) + (pass * 7u) + ((off + i) * 13u));
+    }
+}
+
+
+static uint64_t Workload(bool merge, uint32_t *erases)
+{
+    cp23lfs_file_t file;
+    char path[8];
+    uint8_t back[CHUNK];
+    uint32_t pass;
+    uint32_t n;
+    uint32_t off;
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    IS25LP080D_SetEraseDeferral(merge);
+    sim.eraseNs = 0u;
+    *erases = 0u;
+    for (n = 0 ; n < SIM_SECTORS ; n++)
+    {
+        *erases -= sim.sectorErases[n];
+    }
+    for (pass = 0 ; pass < REWRITES ; pass++)
+    {
+        for (n = 0 ; n < FILES ; n++)
+        {
+            snprintf(path, sizeof(path), "/f%lu", (unsigned long)n);
+            CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+            for (off = 0 ; off < FILE_SIZE ; off += CHUNK)
+            {
+                Fill(n, pass, off);
+                CHECK(cp23lfs_file_write(file, data, CHUNK) == (lfs_ssize_t)CHUNK);
+            }
+            CHECK_OK(cp23lfs_file_close(file));
+        }
+    }
+    for (n = 0 ; n < SIM_SECTORS ; n++)
+    {
+        *erases += sim.sectorErases[n];
+    }
+    /* Remount and read the last pass back */
+    CHECK_OK(CP23Init());
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/f%lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_RDONLY));
+        for (off = 0 ; off < FILE_SIZE ; off += CHUNK)
+        {
+            Fill(n, REWRITES - 1u, off);
+            CHECK((cp23lfs_file_read(file, back, CHUNK) == (lfs_ssize_t)CHUNK) && (memcmp(back, data, CHUNK) == 0));
+        }
+        CHECK_OK(cp23lfs_file_close(file));
+    }
+    CHECK(sim.badPrograms == 0u);
+    return sim.eraseNs;
+}
+
+
+static void FailedErase(void)
+{
+    uint8_t page[256];
+    uint8_t back[256];
+    uint32_t addr = 16u * 4096u;
+    uint32_t sector;
+
+    sim_init();
+    IS25LP080D_Init();
+    IS25LP080D_SetEraseDeferral(true);
+    memset(page, 0x0F, sizeof(page));
+    CHECK(IS25LP080D_Program(NULL, addr, page, sizeof(page)) == 0);
+    /* Sectors 16..31 queued (one 64K erase), the memory loses the erase command (and its two retries) twice */
+    for (sector = 16u ; sector < 32u ; sector++)
+    {
+        CHECK(IS25LP080D_Erase(NULL, sector * 4096u, 4096u) == 0);
+    }
+    sim.stuckCmds = 6u;
+    memset(page, 0xF0, sizeof(page));
+    CHECK(IS25LP080D_Program(NULL, addr, page, sizeof(page)) != 0);
+    CHECK(sim.mem[addr] == 0x0F);                       /* Nothing programmed over the old data */
+    CHECK(IS25LP080D_Read(NULL, addr + 4096u, back, sizeof(back)) != 0);    /* Still queued */
+    /* The memory answers again: the queue is retried, the sector is programmed erased */
+    CHECK(IS25LP080D_Program(NULL, addr, page, sizeof(page)) == 0);
+    CHECK((IS25LP080D_Read(NULL, addr, back, sizeof(back)) == 0) && (memcmp(back, page, sizeof(page)) == 0));
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    CHECK(sim.badPrograms == 0u);
+}
+
+
+int main(void)
+{
+    uint32_t erases[2];
+    uint64_t single = Workload(false, &(erases[0]));
+    uint64_t merged = Workload(true, &(erases[1]));
+
+    printf("single sector erases: %lu sectors, %.1f s; deferred: %lu sectors, %.1f s\n", (unsigned long)erases[0],
+           (double)single / 1e9, (unsigned long)erases[1], (double)merged / 1e9);
+    CHECK(erases[1] == erases[0]);
+    CHECK(merged <= single);
+    FailedErase();
+    return CHECK_DONE();
+}
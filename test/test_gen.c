@@ -0,0 +1,84 @@
+/**
+  *******************************************************************************
+  * @file           : test_gen.c
+  * @brief          : File generations (cp23lfs_generation)
+  *
+  *     Checks that the generation changes only with the commits changing the file data or
+  *     attributes (not with opens that only read), and that a generation is never used
+  *     again, even after the file holding the highest one is removed and the system restarts.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+
+static uint32_t Gen(const char *path)
+{
+    uint32_t generation = 0u;
+
+    CHECK_OK(cp23lfs_generation(path, &generation));
+    return generation;
+}
+
+
+static void Make(const char *path, const char *data)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    CHECK(cp23lfs_file_write(file, data, strlen(data)) == (lfs_ssize_t)strlen(data));
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    uint32_t generation;
+    uint32_t last;
+    uint32_t n;
+    char buffer[8];
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    Make("/a", "a");
+    Make("/b", "b");
+    generation = Gen("/b");
+    CHECK((generation != 0u) && (generation > Gen("/a")));
+
+    /* Opens that only read keep the generation */
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/b", LFS_O_RDWR));
+    CHECK(cp23lfs_file_read(file, buffer, 1u) == 1);
+    CHECK_OK(cp23lfs_file_sync(file));
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/b", LFS_O_WRONLY));
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK(Gen("/b") == generation);
+
+    /* Data and attribute changes bump it */
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/b", LFS_O_RDWR));
+    CHECK(cp23lfs_file_write(file, "x", 1u) == 1);
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK(Gen("/b") > generation);
+    generation = Gen("/b");
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/b", LFS_O_WRONLY));
+    strcpy((char *)(file->owner), "me");
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK(Gen("/b") > generation);
+
+    /* The highest generation is not used again after a remove and a restart */
+    for (n = 0 ; n < 100u ; n++)
+    {
+        Make("/c", "c");
+    }
+    last = Gen("/c");
+    CHECK_OK(cp23lfs_remove("/c"));
+    CHECK_OK(CP23Init());
+    Make("/c", "other");
+    printf("generation %lu removed, %lu after the restart\n", (unsigned long)last, (unsigned long)Gen("/c"));
+    CHECK(Gen("/c") > last);
+    return CHECK_DONE();
+}
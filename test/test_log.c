@@ -0,0 +1,99 @@
+/**
+  *******************************************************************************
+  * @file           : test_log.c
+  * @brief          : Time indexed logs (cp23lfs_log_write, cp23lfs_log_range)
+  *
+  *     Writes records across several index intervals and checks the regions found for time
+  *     ranges starting and ending on, just before and just after the indexed time stamps: every
+  *     record of the range is inside the region, which starts and ends at the expected index
+  *     entries. The log path is given unnormalized to the range search, and a path longer than
+  *     CP23LFS_PATH_MAX is refused as by the other calls.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define RECORDS     20u
+#define INTERVAL    4u                                          /* Records between two index entries */
+#define STEP        10u                                         /* Time stamp step between two records */
+
+typedef struct
+{
+    uint32_t timestamp;
+    uint32_t value;
+}record_t;
+
+typedef struct
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t start;                                             /* Expected region (record numbers) */
+    uint32_t end;
+}range_t;
+
+static const range_t ranges[] =
+{
+    { 40u,  80u,  0u, 12u},                                     /* On the index time stamps */
+    { 41u,  79u,  4u,  8u},                                     /* Just after and just before them */
+    { 39u,  81u,  0u, 12u},                                     /* Just before and just after them */
+    {  0u,  0u,   0u,  4u},                                     /* First record */
+    {190u, 500u, 16u, RECORDS},                                 /* Last record and past the log end */
+    {500u, 600u, 16u, RECORDS},                                 /* After the log: no record */
+};
+
+
+int main(void)
+{
+    cp23lfs_log_t log;
+    cp23lfs_file_t file;
+    record_t records[RECORDS];
+    char longPath[CP23LFS_PATH_MAX + 2u];
+    lfs_off_t start;
+    lfs_off_t end;
+    uint32_t outside;
+    uint32_t cnt;
+    uint32_t n;
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_mkdir("/logs"));
+    CHECK_OK(cp23lfs_log_open(&log, "/logs/l", INTERVAL));
+    for (n = 0 ; n < RECORDS ; n++)
+    {
+        records[n].timestamp = n * STEP;
+        records[n].value = n;
+        CHECK_OK(cp23lfs_log_write(&log, records[n].timestamp, &records[n], sizeof(record_t)));
+    }
+    CHECK_OK(cp23lfs_log_close(&log));
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/logs/l", LFS_O_RDONLY));
+    CHECK(cp23lfs_file_read(file, records, sizeof(records)) == (lfs_ssize_t)sizeof(records));
+    CHECK_OK(cp23lfs_file_close(file));
+
+    for (cnt = 0 ; cnt < (sizeof(ranges) / sizeof(ranges[0])) ; cnt++)
+    {
+        CHECK_OK(cp23lfs_log_range("logs/./x/..//l", ranges[cnt].from, ranges[cnt].to, &start, &end));
+        CHECK(start == (ranges[cnt].start * sizeof(record_t)));
+        CHECK(end == (ranges[cnt].end * sizeof(record_t)));
+        for (n = 0, outside = 0u ; n < RECORDS ; n++)
+        {
+            if ((records[n].timestamp >= ranges[cnt].from) && (records[n].timestamp <= ranges[cnt].to) &&
+                (((n * sizeof(record_t)) < start) || (((n + 1u) * sizeof(record_t)) > end)))
+            {
+                outside++;
+            }
+        }
+        CHECK(outside == 0u);
+    }
+    CHECK(cp23lfs_log_range("/logs/none", 0u, 10u, &start, &end) == CP23LFS_ERRORCODE(LFS_ERR_NOENT));
+    for (n = 0 ; n < (CP23LFS_PATH_MAX + 1u) ; n += 2u)
+    {
+        memcpy(&longPath[n], "/a", 2u);
+    }
+    longPath[CP23LFS_PATH_MAX + 1u] = '\0';
+    CHECK(cp23lfs_log_range(longPath, 0u, 10u, &start, &end) == CP23LFS_ERRORCODE(LFS_ERR_NAMETOOLONG));
+    printf("%lu records, %lu ranges checked\n", (unsigned long)RECORDS, (unsigned long)cnt);
+    return CHECK_DONE();
+}
@@ -0,0 +1,108 @@
+/**
+  *******************************************************************************
+  * @file           : test_map.c
+  * @brief          : File mappings (cp23lfs_map_open, cp23lfs_map_get)
+  *
+  *     Checks the accepted open flags (write-only and append maps are rejected, since the pages
+  *     are read before being changed), and that the pages changed through a writable map are
+  *     written back, keeping the rest of the file, while read-only maps refuse writes, and that
+  *     a writable map of a new file grows it up to the last range changed, inside its size limit.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define SIZE        (3u * CP23LFS_MAP_PAGE)
+#define LIMIT       (2u * CP23LFS_MAP_PAGE)                     /* Size limit of the new file map */
+#define GROWN       (CP23LFS_MAP_PAGE + 8u)                     /* New file size: end of the last range changed */
+
+static uint8_t pages[2u * CP23LFS_MAP_PAGE];
+static uint8_t data[SIZE];
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    cp23lfs_map_t map;
+    uint8_t *page;
+    uint32_t errors;
+    uint32_t n;
+
+    for (n = 0 ; n < SIZE ; n++)
+    {
+        data[n] = (uint8_t)n;
+    }
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/m", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(file, data, SIZE) == (lfs_ssize_t)SIZE);
+    CHECK_OK(cp23lfs_file_close(file));
+
+    /* Open flags */
+    CHECK(cp23lfs_map_open(&map, "/m", LFS_O_WRONLY, pages, 2u, 0u) == CP23LFS_ERRORCODE(LFS_ERR_INVAL));
+    CHECK(cp23lfs_map_open(&map, "/m", LFS_O_RDWR | LFS_O_APPEND, pages, 2u, 0u) == CP23LFS_ERRORCODE(LFS_ERR_INVAL));
+    CHECK(cp23lfs_map_open(&map, "/new", LFS_O_WRONLY | LFS_O_CREAT, pages, 2u, 0u) == CP23LFS_ERRORCODE(LFS_ERR_INVAL));
+
+    /* Read-only map */
+    CHECK_OK(cp23lfs_map_open(&map, "/m", LFS_O_RDONLY, pages, 2u, 0u));
+    page = cp23lfs_map_get(&map, CP23LFS_MAP_PAGE + 4u, 4u, false);
+    CHECK((page != NULL) && (memcmp(page, &data[CP23LFS_MAP_PAGE + 4u], 4u) == 0));
+    CHECK(cp23lfs_map_get(&map, 0u, 4u, true) == NULL);
+    CHECK_OK(cp23lfs_map_close(&map));
+
+    /* Writable map: changes written back through the page replacements and the close */
+    CHECK_OK(cp23lfs_map_open(&map, "/m", LFS_O_RDWR, pages, 2u, 0u));
+    for (n = 0 ; n < 3u ; n++)
+    {
+        page = cp23lfs_map_get(&map, (n * CP23LFS_MAP_PAGE) + 1u, 1u, true);
+        CHECK(page != NULL);
+        if (page)
+        {
+            *page = 0xEEu;
+            data[(n * CP23LFS_MAP_PAGE) + 1u] = 0xEEu;
+        }
+    }
+    CHECK_OK(cp23lfs_map_close(&map));
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/m", LFS_O_RDONLY));
+    CHECK(cp23lfs_file_read(file, pages, sizeof(pages)) == (lfs_ssize_t)sizeof(pages));
+    CHECK(memcmp(pages, data, sizeof(pages)) == 0);
+    CHECK(file->size == SIZE);
+    CHECK_OK(cp23lfs_file_close(file));
+
+    /* New file: rejected with no size limit, grown up to the last range changed otherwise */
+    CHECK(cp23lfs_map_open(&map, "/new", LFS_O_RDWR | LFS_O_CREAT, pages, 1u, 0u) == CP23LFS_ERRORCODE(LFS_ERR_INVAL));
+    CHECK_OK(cp23lfs_map_open(&map, "/new", LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC, pages, 1u, LIMIT));
+    CHECK(cp23lfs_map_get(&map, LIMIT - 4u, 4u, false) != NULL);
+    CHECK(cp23lfs_map_get(&map, LIMIT, 4u, true) == NULL);                  /* Past the limit */
+    page = cp23lfs_map_get(&map, 0u, 4u, true);
+    CHECK(page != NULL);
+    if (page)
+    {
+        memcpy(page, "head", 4u);
+    }
+    page = cp23lfs_map_get(&map, GROWN - 4u, 4u, false);                    /* Replaces the first page */
+    CHECK((page != NULL) && (memcmp(page, "\0\0\0\0", 4u) == 0));
+    CHECK_OK(cp23lfs_map_flush(&map));
+    CHECK(map.file->size == 4u);
+    page = cp23lfs_map_get(&map, GROWN - 4u, 4u, true);
+    CHECK(page != NULL);
+    if (page)
+    {
+        memcpy(page, "tail", 4u);
+    }
+    CHECK_OK(cp23lfs_map_close(&map));
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/new", LFS_O_RDONLY));
+    memset(pages, 0xFF, sizeof(pages));
+    CHECK(cp23lfs_file_read(file, pages, sizeof(pages)) == (lfs_ssize_t)GROWN);
+    CHECK((memcmp(pages, "head", 4u) == 0) && (memcmp(&pages[GROWN - 4u], "tail", 4u) == 0));
+    for (n = 4u, errors = 0u ; n < (GROWN - 4u) ; n++)
+    {
+        errors += (pages[n] != 0u) ? 1u : 0u;                               /* Gap read as zeros */
+    }
+    CHECK(errors == 0u);
+    CHECK_OK(cp23lfs_file_close(file));
+    return CHECK_DONE();
+}
@@ -0,0 +1,54 @@
+/**
+  *******************************************************************************
+  * @file           : test_mount.c
+  * @brief          : First start format of CP23Init
+  *
+  *     Checks that a blank memory is formatted and mounted, and that a memory whose superblocks
+  *     cannot be mounted is left untouched (no erase, no program, the error returned), so
+  *     that the files are found again once the superblocks read correctly.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define PAIR_SIZE   (2u * 4096u)                                /* Superblock pair (blocks 0 and 1) */
+
+static uint8_t image[SIM_SIZE];
+static uint8_t pair[PAIR_SIZE];
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    char buffer[8];
+    uint32_t programs;
+
+    /* Blank memory: formatted */
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/keep", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    CHECK(cp23lfs_file_write(file, "data", 4) == 4);
+    CHECK_OK(cp23lfs_file_close(file));
+
+    /* Unreadable superblocks: the error is returned and nothing is written */
+    memcpy(pair, sim.mem, PAIR_SIZE);
+    memset(sim.mem, 0x00, PAIR_SIZE);
+    memcpy(image, sim.mem, SIM_SIZE);
+    programs = sim.programs;
+    CHECK(CP23Init() != CP23LFS_OK);
+    CHECK(sim.programs == programs);
+    CHECK(memcmp(image, sim.mem, SIM_SIZE) == 0);
+    printf("corrupt superblocks: not formatted\n");
+
+    /* Superblocks back: the file is still there */
+    memcpy(sim.mem, pair, PAIR_SIZE);
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/keep", LFS_O_RDONLY));
+    CHECK(cp23lfs_file_read(file, buffer, sizeof(buffer)) == 4);
+    CHECK(memcmp(buffer, "data", 4) == 0);
+    CHECK_OK(cp23lfs_file_close(file));
+    return CHECK_DONE();
+}
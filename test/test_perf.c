@@ -0,0 +1,126 @@
+/**
+  *******************************************************************************
+  * @file           : test_perf.c
+  * @brief          : Performance regression check (cp23lfs_perf_run, cp23lfs_perf_check)
+  *
+  *     Records a sensor log workload (directory, appends, syncs, reads, seeks, truncate,
+  *     rename and remove), replays it on a blank image and compares the metrics with the
+  *     baseline of perf_base.h: the run fails when a metric exceeds it by more than
+  *     THRESHOLD percent. The flash model is deterministic, so the metrics only change with
+  *     the library; after an intended change, copy the printed metrics into perf_base.h. The
+  *     energy the flash model integrates over each run (sim_energy) is reported, not checked.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+#include "perf_base.h"
+
+#define FILES       8u
+#define APPENDS     24u
+#define RECORDS     1024u
+#define THRESHOLD   2u                                          /* Allowed increase (percent) */
+
+static cp23lfs_rec_t rec[RECORDS];
+static uint8_t data[512];
+
+
+static void Energy(const char *name)
+{
+    sim_energy_t energy;
+
+    sim_energy(&energy, true);
+    printf("%s energy: %lu uJ in %lu ms (bus %lu, program %lu, erase %lu, standby %lu, power-down %lu)\n", name,
+           (unsigned long)energy.totalUj, (unsigned long)(energy.timeUs / 1000u), (unsigned long)energy.busUj,
+           (unsigned long)energy.programUj, (unsigned long)energy.eraseUj, (unsigned long)energy.standbyUj,
+           (unsigned long)energy.powerDownUj);
+}
+
+
+static void Blank(void)
+{
+    sim_energy_t energy;
+    uint32_t n;
+
+    sim_init();
+    for (n = 0 ; n < IS25LP080D_SECTOR_COUNT ; n++)
+    {
+        IS25LP080D_SetEraseCount(n, 0u);
+    }
+    CHECK_OK(CP23Init());
+    sim_energy(&energy, true);                                  /* Energy of the run only */
+}
+
+
+static void Workload(void)
+{
+    cp23lfs_file_t file[FILES];
+    char path[32];
+    uint32_t n;
+    uint32_t i;
+
+    CHECK_OK(cp23lfs_mkdir("/log"));
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/log/s%lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_file_opencfg(&file[n], path, LFS_O_RDWR | LFS_O_CREAT));
+    }
+    for (i = 0 ; i < APPENDS ; i++)
+    {
+        for (n = 0 ; n < FILES ; n++)
+        {
+            CHECK(cp23lfs_file_write(file[n], data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        }
+        if ((i % 8u) == 7u)
+        {
+            CHECK_OK(cp23lfs_file_sync(file[i % FILES]));
+        }
+    }
+    for (n = 0 ; n < FILES ; n++)
+    {
+        CHECK(cp23lfs_file_seek(file[n], (lfs_soff_t)(n * sizeof(data)), LFS_SEEK_SET) >= 0);
+        CHECK(cp23lfs_file_read(file[n], data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    }
+    CHECK_OK(cp23lfs_file_truncate(file[0], sizeof(data)));
+    for (n = 0 ; n < FILES ; n++)
+    {
+        CHECK_OK(cp23lfs_file_close(file[n]));
+    }
+    CHECK_OK(cp23lfs_rename("/log/s1", "/log/old"));
+    CHECK_OK(cp23lfs_remove("/log/s2"));
+}
+
+
+int main(void)
+{
+    static char const * const name[CP23LFS_PERF_NUM] = {"TIME", "BUS", "PROG", "ERASE", "RAM", "FAILED"};
+    cp23lfs_perf_t base = {PERF_BASE};
+    cp23lfs_perf_t perf;
+    uint32_t lost = 0u;
+    uint32_t num;
+    uint32_t n;
+
+    memset(data, 'P', sizeof(data));
+    Blank();
+    cp23lfs_rec_start(rec, RECORDS, NULL);
+    Workload();
+    num = cp23lfs_rec_stop(&lost);
+    CHECK((num > 0u) && (lost == 0u));
+    Energy("recorded workload");
+
+    /* Replay on the same blank image */
+    Blank();
+    CHECK_OK(cp23lfs_perf_run(rec, num, NULL, data, sizeof(data), &perf));
+    Energy("replay");
+    printf("%lu records, metrics (baseline):", (unsigned long)num);
+    for (n = 0 ; n < CP23LFS_PERF_NUM ; n++)
+    {
+        printf(" %s %lu (%lu)", name[n], (unsigned long)perf.metric[n], (unsigned long)base.metric[n]);
+    }
+    printf("\n");
+    CHECK(perf.metric[CP23LFS_PERF_FAILED] == 0u);
+    CHECK(cp23lfs_perf_check(&base, &perf, THRESHOLD) == 0u);
+    return CHECK_DONE();
+}
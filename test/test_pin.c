@@ -0,0 +1,118 @@
+/**
+  *******************************************************************************
+  * @file           : test_pin.c
+  * @brief          : Pinned files (cp23lfs_pin_config, cp23lfs_pin, cp23lfs_unpin)
+  *
+  *     Checks that the opens of a pinned file are served from the pin RAM without reading the
+  *     memory, that a commit reloads the pinned copy while an open keeps reading the old one
+  *     until its close, that an unpinned file keeps its RAM until its last pinned close, and that
+  *     a file no longer fitting the policy is unpinned without cutting the open reading it.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define PIN_RAM     2048u
+#define MAX_FILE    256u
+
+static uint8_t pinRam[PIN_RAM];
+static char big[MAX_FILE + 1u];
+
+
+static uint32_t Reads(void)
+{
+    return sim.cmds[0x03] + sim.cmds[0x0B];
+}
+
+
+static void Write(const char *path, const char *data, uint32_t size)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    CHECK(cp23lfs_file_write(file, data, size) == (lfs_ssize_t)size);
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+/* Reads a whole file, returns the memory reads it took */
+static uint32_t ReadAll(const char *path, const char *expect, uint32_t size)
+{
+    cp23lfs_file_t file;
+    char buffer[MAX_FILE + 8u];
+    uint32_t reads = Reads();
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_RDONLY));
+    CHECK(cp23lfs_file_read(file, buffer, sizeof(buffer)) == (lfs_ssize_t)size);
+    CHECK(memcmp(buffer, expect, size) == 0);
+    CHECK_OK(cp23lfs_file_close(file));
+    return Reads() - reads;
+}
+
+
+int main(void)
+{
+    cp23lfs_pinPolicy_t policy = {MAX_FILE, 0u};
+    cp23lfs_pinStats_t stats;
+    cp23lfs_file_t reader;
+    char buffer[16];
+    uint32_t used;
+    uint32_t reads;
+
+    memset(big, 'B', sizeof(big));
+    sim_init();
+    CHECK_OK(CP23Init());
+    cp23lfs_pin_config(pinRam, sizeof(pinRam), &policy);
+    Write("/p", "version one", 11u);
+
+    /* Hit: served from the pin RAM */
+    CHECK_OK(cp23lfs_pin("/p"));
+    CHECK(ReadAll("/p", "version one", 11u) == 0u);
+    cp23lfs_pin_stats(&stats, true);
+    CHECK((stats.pins == 1u) && (stats.hits == 1u) && (stats.loads == 1u));
+    used = stats.used;
+
+    /* Refresh on write: the open reading keeps the old copy until its close */
+    CHECK_OK(cp23lfs_file_opencfg(&reader, "/p", LFS_O_RDONLY));
+    CHECK(cp23lfs_file_read(reader, buffer, 8u) == 8);
+    Write("/p", "version TWO", 11u);
+    CHECK(ReadAll("/p", "version TWO", 11u) == 0u);
+    reads = Reads();
+    CHECK(cp23lfs_file_read(reader, &(buffer[8]), 8u) == 3);
+    CHECK((Reads() == reads) && (memcmp(buffer, "version one", 11u) == 0));
+    cp23lfs_pin_stats(&stats, true);
+    CHECK((stats.pins == 1u) && (stats.loads == 1u) && (stats.used == (2u * used)));
+    CHECK_OK(cp23lfs_file_close(reader));
+    cp23lfs_pin_stats(&stats, true);
+    CHECK(stats.used == used);
+
+    /* Unpinned while open: the RAM is released at the last pinned close */
+    CHECK_OK(cp23lfs_file_opencfg(&reader, "/p", LFS_O_RDONLY));
+    CHECK_OK(cp23lfs_unpin("/p"));
+    CHECK(cp23lfs_file_read(reader, buffer, sizeof(buffer)) == 11);
+    CHECK(memcmp(buffer, "version TWO", 11u) == 0);
+    cp23lfs_pin_stats(&stats, true);
+    CHECK((stats.pins == 0u) && (stats.used == used));
+    CHECK_OK(cp23lfs_file_close(reader));
+    cp23lfs_pin_stats(&stats, true);
+    CHECK(stats.used == 0u);
+    CHECK(ReadAll("/p", "version TWO", 11u) > 0u);
+
+    /* Failed reload (file over the policy): unpinned, the open reading keeps the old copy */
+    CHECK_OK(cp23lfs_pin("/p"));
+    CHECK_OK(cp23lfs_file_opencfg(&reader, "/p", LFS_O_RDONLY));
+    Write("/p", big, sizeof(big));
+    cp23lfs_pin_stats(&stats, true);
+    CHECK((stats.pins == 0u) && (stats.loads == 1u));
+    CHECK(cp23lfs_file_read(reader, buffer, sizeof(buffer)) == 11);
+    CHECK(memcmp(buffer, "version TWO", 11u) == 0);
+    CHECK_OK(cp23lfs_file_close(reader));
+    cp23lfs_pin_stats(&stats, true);
+    CHECK(stats.used == 0u);
+    CHECK(ReadAll("/p", big, sizeof(big)) > 0u);
+    printf("pin: %lu bytes per copy, reload kept the old copy for its open\n", (unsigned long)used);
+    return CHECK_DONE();
+}
@@ -0,0 +1,105 @@
+/**
+  *******************************************************************************
+  * @file           : test_pool.c
+  * @brief          : Opens waiting for a file structure (cp23lfs_file_openwait, cp23lfs_lock_set)
+  *
+  *     The wait hook stands for the other tasks: it runs while the waiter is blocked and closes
+  *     a file. Checks that the file system lock is released while the waiter is blocked and taken
+  *     back after, that the structure is free when the waiter is woken, that the woken waiter gets
+  *     it, and that a waiter not woken times out.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define OPEN_MAX    32u
+
+static cp23lfs_file_t open[OPEN_MAX];
+static uint32_t openNum = 0u;
+static bool locked = false;
+static bool woken = false;
+static uint32_t waits = 0u;
+
+
+static void Lock(void)
+{
+    CHECK(!locked);
+    locked = true;
+}
+
+
+static void Unlock(void)
+{
+    CHECK(locked);
+    locked = false;
+}
+
+
+/* Other task: takes the lock and closes a file, or lets the waiter time out */
+static bool Wait(uint8_t waiter, uint32_t timeout)
+{
+    waits++;
+    CHECK(!locked);
+    if (timeout == 1u)
+    {
+        return false;
+    }
+    Lock();
+    CHECK_OK(cp23lfs_file_close(open[--openNum]));
+    Unlock();
+    return woken;
+}
+
+
+static void Wake(uint8_t waiter)
+{
+    CHECK(!(open[openNum]->system.allocated));          /* Closed structure released before the wake up */
+    woken = true;
+}
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    cp23lfs_pool_t stats;
+    char path[16];
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    cp23lfs_pool_wait_set(Wait, Wake);
+    cp23lfs_lock_set(Lock, Unlock);
+    Lock();
+
+    /* Exhaust the pool */
+    for (openNum = 0 ; openNum < OPEN_MAX ; openNum++)
+    {
+        snprintf(path, sizeof(path), "/f%lu", (unsigned long)openNum);
+        if (cp23lfs_file_opencfg(&(open[openNum]), path, LFS_O_WRONLY | LFS_O_CREAT) != CP23LFS_OK)
+        {
+            break;
+        }
+    }
+    CHECK((openNum > 0u) && (openNum < OPEN_MAX));
+
+    /* Timeout */
+    CHECK(cp23lfs_file_openwait(&file, "/w", LFS_O_WRONLY | LFS_O_CREAT, 1u, 0u) == CP23LFS_ERRORCODE(LFS_ERR_NOMEM));
+    CHECK(locked);
+
+    /* Woken by a close of another task */
+    CHECK_OK(cp23lfs_file_openwait(&file, "/w", LFS_O_WRONLY | LFS_O_CREAT, CP23LFS_WAIT_FOREVER, 0u));
+    CHECK(locked);
+    CHECK(woken);
+    CHECK(waits == 2u);
+    CHECK_OK(cp23lfs_file_close(file));
+    while (openNum)
+    {
+        CHECK_OK(cp23lfs_file_close(open[--openNum]));
+    }
+    cp23lfs_pool_stats(&stats, false);
+    CHECK((stats.waits == 2u) && (stats.timeouts == 1u));
+    Unlock();
+    return CHECK_DONE();
+}
@@ -0,0 +1,97 @@
+/**
+  *******************************************************************************
+  * @file           : test_query.c
+  * @brief          : Attribute queries (cp23lfs_query) with and without the secondary indexes
+  *
+  *     Every condition must select the same files whether the tree is scanned or an index bucket
+  *     is used: owner prefixes, whole owner names and owner groups with unused flag bits set.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+typedef struct
+{
+    cp23lfs_qcond_t cond;
+    uint32_t expected;
+} query_t;
+
+static uint8_t const mnf = CP23LFS_GROUP_MNF;
+static uint8_t const mnfFlags = CP23LFS_GROUP_MNF | 0x04u;
+static uint8_t const mn32[CP23LFS_OWNER_LEN] = "MN";
+
+static query_t const query[] =
+{
+    {{CP23LFS_ATTR_OWNER, CP23LFS_QOP_EQ, 2u, "MN"}, 3u},       /* Prefix: /a, /b, /c */
+    {{CP23LFS_ATTR_OWNER, CP23LFS_QOP_EQ, 3u, "MN"}, 1u},       /* Whole name: /c */
+    {{CP23LFS_ATTR_OWNER, CP23LFS_QOP_EQ, sizeof(mn32), mn32}, 1u},
+    {{CP23LFS_ATTR_COMPANY, CP23LFS_QOP_EQ, 2u, "BP"}, 3u},
+    {{CP23LFS_ATTR_COMPANY, CP23LFS_QOP_EQ, 3u, "BP"}, 2u},
+    {{CP23LFS_ATTR_GROUP, CP23LFS_QOP_EQ, 1u, &mnf}, 2u},       /* /b, /d (flags bit 2 set) */
+    {{CP23LFS_ATTR_GROUP, CP23LFS_QOP_EQ, 1u, &mnfFlags}, 2u},
+    {{CP23LFS_ATTR_GROUP, CP23LFS_QOP_NE, 1u, &mnf}, 2u},
+};
+
+
+static void Make(const char *path, const char *owner, const char *company, uint8_t flags)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    memset(file->owner, 0, sizeof(file->owner));
+    memset(file->company, 0, sizeof(file->company));
+    memcpy(file->owner, owner, strlen(owner));
+    memcpy(file->company, company, strlen(company));
+    file->flags = flags;
+    CHECK(cp23lfs_file_write(file, path, strlen(path)) == (lfs_ssize_t)strlen(path));
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+static bool Count(void *data, const char *path, const struct lfs_info *info)
+{
+    (*(uint32_t *)data)++;
+    return true;
+}
+
+
+static uint32_t Run(const cp23lfs_qcond_t *cond)
+{
+    uint32_t num = 0u;
+
+    CHECK_OK(cp23lfs_query("/", cond, 1u, Count, &num));
+    return num;
+}
+
+
+int main(void)
+{
+    uint32_t scan;
+    uint32_t index;
+    uint32_t n;
+
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_mkdir("/x"));
+    Make("/a", "MNF", "BPX", CP23LFS_GROUP_USER);
+    Make("/b", "MNX", "BP", CP23LFS_GROUP_MNF);
+    Make("/c", "MN", "BP", CP23LFS_GROUP_BP);
+    Make("/x/d", "OEM", "OEM", CP23LFS_GROUP_MNF | 0x04u);
+    for (n = 0 ; n < (sizeof(query) / sizeof(query[0])) ; n++)
+    {
+        CHECK_OK(cp23lfs_index_drop());
+        scan = Run(&(query[n].cond));
+        CHECK_OK(cp23lfs_index_build());
+        index = Run(&(query[n].cond));
+        if ((scan != query[n].expected) || (index != query[n].expected))
+        {
+            printf("query %lu: %lu files scanning, %lu with the index, %lu expected\n", (unsigned long)n, 
+                   (unsigned long)scan, (unsigned long)index, (unsigned long)query[n].expected);
+        }
+        CHECK((scan == query[n].expected) && (index == query[n].expected));
+    }
+    return CHECK_DONE();
+}
@@ -0,0 +1,124 @@
+/**
+  *******************************************************************************
+  * @file           : test_quota.c
+  * @brief          : Owner group quotas with concurrent writers (cp23lfs_quota_set, cp23lfs_file_write)
+  *
+  *     Checks that the uncommitted growth of the open files of a group counts in its quota:
+  *     two writers of the same group cannot exceed the limit together, the growth reserved
+  *     by a file is released by its commit, and the other groups are not charged. The check
+  *     is incremental: a growing write does not read the other files.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define LIMIT       4u
+#define FILES       40u
+
+static uint8_t data[4096];
+
+
+static uint32_t Reads(void)
+{
+    return sim.cmds[0x03] + sim.cmds[0x0B];
+}
+
+
+static uint32_t Blocks(uint8_t group)
+{
+    cp23lfs_quota_t quota;
+
+    CHECK_OK(cp23lfs_quota_get(group, &quota));
+    return quota.blocks;
+}
+
+
+int main(void)
+{
+    cp23lfs_file_t file1;
+    cp23lfs_file_t file2;
+    cp23lfs_file_t other;
+    uint32_t written = 0u;
+    uint32_t reads;
+    uint32_t n;
+    char path[16];
+
+    memset(data, 'Q', sizeof(data));
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_quota_set(CP23LFS_GROUP_USER, LIMIT));
+
+    /* Two writers of the same group, interleaved */
+    CHECK_OK(cp23lfs_file_opencfg(&file1, "/q1", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK_OK(cp23lfs_file_opencfg(&file2, "/q2", LFS_O_WRONLY | LFS_O_CREAT));
+    for (n = 0 ; n < LIMIT ; n++)
+    {
+        written += (cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        written += (cp23lfs_file_write(file2, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    }
+    CHECK(cp23lfs_file_write(file2, data, 1u) == LFS_ERR_NOSPC);
+    CHECK_OK(cp23lfs_file_close(file1));
+    CHECK_OK(cp23lfs_file_close(file2));
+    printf("group limit %lu blocks: %lu block writes accepted, %lu blocks used\n", (unsigned long)LIMIT,
+           (unsigned long)written, (unsigned long)Blocks(CP23LFS_GROUP_USER));
+    CHECK(Blocks(CP23LFS_GROUP_USER) <= LIMIT);
+
+    /* Growth released by the commit: the committed block and 3 reserved ones fill the quota */
+    CHECK_OK(cp23lfs_remove("/q1"));
+    CHECK_OK(cp23lfs_remove("/q2"));
+    CHECK(Blocks(CP23LFS_GROUP_USER) == 0u);
+    CHECK_OK(cp23lfs_file_opencfg(&file1, "/q3", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK_OK(cp23lfs_file_sync(file1));
+    CHECK(Blocks(CP23LFS_GROUP_USER) == 1u);
+    CHECK_OK(cp23lfs_file_opencfg(&file2, "/q4", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(file2, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK(cp23lfs_file_write(file2, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK(cp23lfs_file_write(file1, data, 1u) == LFS_ERR_NOSPC);
+    CHECK_OK(cp23lfs_file_close(file1));
+    CHECK_OK(cp23lfs_file_close(file2));
+    CHECK(Blocks(CP23LFS_GROUP_USER) == LIMIT);
+    CHECK_OK(cp23lfs_remove("/q4"));
+
+    /* Another group is not charged with the reserved growth */
+    CHECK_OK(cp23lfs_file_opencfg(&file1, "/q5", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK_OK(cp23lfs_file_opencfg(&other, "/g1", LFS_O_WRONLY | LFS_O_CREAT));
+    other->flags = CP23LFS_GROUP_MNF;
+    while (cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data))
+    {
+    }
+    CHECK(cp23lfs_file_write(other, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK(cp23lfs_file_write(other, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK_OK(cp23lfs_file_close(file1));
+    CHECK_OK(cp23lfs_file_close(other));
+    CHECK(Blocks(CP23LFS_GROUP_USER) <= LIMIT);
+    CHECK(Blocks(CP23LFS_GROUP_MNF) == 3u);
+
+    /* Growing writes after metadata changes: no traversal of the files */
+    CHECK_OK(cp23lfs_quota_set(CP23LFS_GROUP_USER, 0u));
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/f%02lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_file_opencfg(&file1, path, LFS_O_WRONLY | LFS_O_CREAT));
+        CHECK(cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        CHECK(cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        CHECK_OK(cp23lfs_file_close(file1));
+    }
+    CHECK_OK(cp23lfs_quota_set(CP23LFS_GROUP_USER, 200u));
+    CHECK_OK(cp23lfs_file_opencfg(&file1, "/w", LFS_O_WRONLY | LFS_O_CREAT));
+    reads = Reads();
+    CHECK(cp23lfs_file_write(file1, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    reads = Reads() - reads;
+    CHECK_OK(cp23lfs_file_close(file1));
+    printf("growing write after %lu files: %lu reads\n", (unsigned long)FILES, (unsigned long)reads);
+    CHECK(reads < FILES);
+
+    /* Same usage after a remount */
+    n = Blocks(CP23LFS_GROUP_USER);
+    CHECK_OK(CP23Init());
+    CHECK(Blocks(CP23LFS_GROUP_USER) == n);
+    return CHECK_DONE();
+}
@@ -0,0 +1,120 @@
+/**
+  *******************************************************************************
+  * @file           : test_readcont.c
+  * @brief          : Continuation of sequential reads (IS25LP080D_SetReadContinuation)
+  *
+  *     Runs file system calls with the continuation enabled and checks that the chip select
+  *     is released at the end of each one, that the reads of a call are still continued
+  *     (fewer read commands than without the continuation) and that the data read is correct.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define SIZE        20000u
+
+static uint8_t data[SIZE];
+static uint8_t buffer[SIZE];
+static uint32_t calls = 0u;
+
+
+/* Chip select released after the call */
+static void Released(const char *name)
+{
+    if (sim.cs)
+    {
+        printf("%s: chip select left asserted\n", name);
+    }
+    CHECK(!sim.cs);
+    calls++;
+}
+
+
+/* Read commands of a whole file read */
+static uint32_t ReadAll(const char *path)
+{
+    cp23lfs_file_t file;
+    uint32_t cmds;
+
+    memset(buffer, 0, sizeof(buffer));
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_RDONLY));
+    Released("open");
+    cmds = sim.cmds[0x0B];
+    CHECK(cp23lfs_file_read(file, buffer, SIZE) == (lfs_ssize_t)SIZE);
+    Released("read");
+    cmds = sim.cmds[0x0B] - cmds;
+    CHECK_OK(cp23lfs_file_close(file));
+    Released("close");
+    CHECK(memcmp(buffer, data, SIZE) == 0);
+    return cmds;
+}
+
+
+int main(void)
+{
+    static const char * const names[] = {"b"};
+    cp23lfs_file_t file;
+    cp23lfs_timeEntry_t entries[4];
+    uint32_t single;
+    uint32_t continued;
+    uint32_t count;
+    uint32_t n;
+
+    for (n = 0 ; n < SIZE ; n++)
+    {
+        data[n] = (uint8_t)(n ^ (n >> 8));
+    }
+    sim_init();
+    CHECK_OK(CP23Init());
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/big", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(file, data, SIZE) == (lfs_ssize_t)SIZE);
+    CHECK_OK(cp23lfs_file_close(file));
+    single = ReadAll("/big");
+
+    IS25LP080D_SetReadContinuation(true);
+    CHECK_OK(CP23Init());
+    Released("init");
+    continued = ReadAll("/big");
+    printf("file read: %lu read commands, %lu with the continuation\n", (unsigned long)single, (unsigned long)continued);
+    CHECK(continued < single);
+
+    /* Chip select released by every call, whatever its last memory access */
+    CHECK_OK(cp23lfs_mkdir("/d"));
+    Released("mkdir");
+    for (n = 0 ; n < 4u ; n++)
+    {
+        CHECK_OK(cp23lfs_file_opencfg(&file, (n & 1u) ? "/d/a" : "/d/b", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND));
+        Released("open");
+        CHECK(cp23lfs_file_write(file, data, 700u) == 700);
+        Released("write");
+        CHECK_OK(cp23lfs_file_close(file));
+        Released("close");
+    }
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/d/a", LFS_O_RDONLY));
+    CHECK(cp23lfs_file_seek(file, 100, LFS_SEEK_SET) == 100);
+    Released("seek");
+    CHECK(cp23lfs_file_read(file, buffer, 10u) == 10);
+    Released("read");
+    CHECK_OK(cp23lfs_file_close(file));
+    CHECK_OK(cp23lfs_list_bytime("/d", 0u, 0xFFFFFFFFu, CP23LFS_ORDER_NEWEST, entries, 4u, &count));
+    Released("list bytime");
+    CHECK(cp23lfs_fs_size() > 0);
+    Released("fs size");
+    CHECK_OK(cp23lfs_fs_reconcile());
+    Released("reconcile");
+    CHECK_OK(cp23lfs_rename("/d/a", "/d/c"));
+    Released("rename");
+    CHECK_OK(cp23lfs_remove_multi("/d", names, 1u, NULL));
+    Released("remove multi");
+    CHECK_OK(cp23lfs_remove("/d/c"));
+    Released("remove");
+    CHECK_OK(cp23lfs_remove_recursive("/d"));
+    Released("rmtree");
+    CHECK(ReadAll("/big") == continued);
+    IS25LP080D_SetReadContinuation(false);
+    printf("%lu calls checked\n", (unsigned long)calls);
+    return CHECK_DONE();
+}
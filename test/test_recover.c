@@ -0,0 +1,67 @@
+/**
+  *******************************************************************************
+  * @file           : test_recover.c
+  * @brief          : Recovery of a memory losing its commands (IS25LP080D_Recover, IS25LP080D_GetResetCount)
+  *
+  *     The modelled memory loses a program or erase command and leaves the bus stuck (status
+  *     0xFF) until a software reset, as after a brown-out during a command. Checks that a single
+  *     glitch is recovered by one reset within a few status polls, instead of the busy
+  *     timeout, with the data programmed, and that a glitch that persists fails after the bounded
+  *     retries, then that the memory works again once it answers.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define ADDR        (8u * 4096u)
+#define POLLS_MAX   8u                                          /* Status polls of a recovered program (busy timeout: 4000) */
+
+static uint8_t page[256];
+static uint8_t back[256];
+
+
+int main(void)
+{
+    uint32_t resets;
+    uint32_t polls;
+    uint64_t ns;
+
+    memset(page, 0x3C, sizeof(page));
+    sim_init();
+    IS25LP080D_Init();
+    CHECK(IS25LP080D_Erase(NULL, ADDR, 4096u) == 0);
+
+    /* Single glitch: recovered by one reset, the program is sent again */
+    resets = IS25LP080D_GetResetCount();
+    polls = sim.cmds[0x05];
+    ns = sim.ns;
+    sim.stuckCmds = 1u;
+    CHECK(IS25LP080D_Program(NULL, ADDR, page, sizeof(page)) == 0);
+    polls = sim.cmds[0x05] - polls;
+    printf("single glitch: %lu resets, %lu status polls, %lu uSec\n", (unsigned long)(IS25LP080D_GetResetCount() - resets),
+           (unsigned long)polls, (unsigned long)((sim.ns - ns) / 1000u));
+    CHECK(IS25LP080D_GetResetCount() == (resets + 1u));
+    CHECK(polls <= POLLS_MAX);
+    CHECK((IS25LP080D_Read(NULL, ADDR, back, sizeof(back)) == 0) && (memcmp(back, page, sizeof(page)) == 0));
+
+    /* Persistent glitch: the operation and its retries fail, within the bounded time */
+    resets = IS25LP080D_GetResetCount();
+    polls = sim.cmds[0x05];
+    sim.stuckCmds = 100u;
+    CHECK(IS25LP080D_Erase(NULL, ADDR, 4096u) != 0);
+    polls = sim.cmds[0x05] - polls;
+    printf("persistent glitch: %lu resets, %lu status polls, %lu commands left\n", (unsigned long)(IS25LP080D_GetResetCount() - resets),
+           (unsigned long)polls, (unsigned long)sim.stuckCmds);
+    CHECK((IS25LP080D_GetResetCount() - resets) <= 3u);
+    CHECK(polls <= (3u * POLLS_MAX));
+
+    /* The memory answers again */
+    sim.stuckCmds = 0u;
+    CHECK(IS25LP080D_Erase(NULL, ADDR, 4096u) == 0);
+    CHECK((IS25LP080D_Read(NULL, ADDR, back, sizeof(back)) == 0) && (back[0] == 0xFFu));
+    CHECK(sim.badPrograms == 0u);
+    return CHECK_DONE();
+}
@@ -0,0 +1,153 @@
+/**
+  *******************************************************************************
+  * @file           : test_remove.c
+  * @brief          : Recursive and multi-entry removes (cp23lfs_remove_recursive, cp23lfs_remove_multi)
+  *
+  *     Checks that the files of a directory are removed several per metadata commit (programs
+  *     compared with one cp23lfs_remove per file), that the paths are normalized (pinned contents
+  *     dropped, whatever the path spelling), and that a time-sliced removal of a tree with
+  *     sub-directories removes every entry and leaves a consistent file system.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define FILES       64u
+
+static uint8_t pinRam[4096];
+static char names[FILES][8];
+static const char *list[FILES + 2u];
+
+
+static void Make(const char *path, uint32_t size)
+{
+    static uint8_t data[600];
+    cp23lfs_file_t file;
+
+    memset(data, (int)size, sizeof(data));
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    CHECK(cp23lfs_file_write(file, data, size) == (lfs_ssize_t)size);
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+static void MakeDir(const char *dir)
+{
+    char path[32];
+    uint32_t n;
+
+    CHECK_OK(cp23lfs_mkdir(dir));
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[n]);
+        Make(path, (n % 4u) ? 16u : 600u);
+    }
+}
+
+
+static bool Count(void *data, const char *path, const struct lfs_info *info)
+{
+    (*(uint32_t *)data)++;
+    return true;
+}
+
+
+static uint32_t Entries(const char *dir)
+{
+    uint32_t num = 0u;
+
+    CHECK_OK(cp23lfs_query(dir, NULL, 0u, Count, &num));
+    return num;
+}
+
+
+static bool Exists(const char *path)
+{
+    cp23lfs_file_t file;
+
+    if (cp23lfs_file_opencfg(&file, path, LFS_O_RDONLY) != CP23LFS_OK)
+    {
+        return false;
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+    return true;
+}
+
+
+int main(void)
+{
+    cp23lfs_pinPolicy_t policy = {256u, 0u};
+    cp23lfs_rmtree_t ctx;
+    uint32_t programs;
+    uint32_t single;
+    uint32_t removed;
+    uint32_t steps = 0u;
+    uint32_t n;
+    char path[32];
+
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(names[n], sizeof(names[n]), "f%02lu", (unsigned long)n);
+        list[n] = names[n];
+    }
+    sim_init();
+    CHECK_OK(CP23Init());
+
+    /* One remove per file */
+    MakeDir("/a");
+    programs = sim.programs;
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/a/%s", names[n]);
+        CHECK_OK(cp23lfs_remove(path));
+    }
+    single = sim.programs - programs;
+
+    /* Same files in one call, unnormalized parent, a missing and a repeated entry */
+    MakeDir("/b");
+    list[FILES] = "none";
+    list[FILES + 1u] = names[3];
+    programs = sim.programs;
+    CHECK_OK(cp23lfs_remove_multi("b/", list, FILES + 2u, &removed));
+    printf("%lu files: %lu programs removed one by one, %lu removed in one call\n", (unsigned long)FILES, 
+           (unsigned long)single, (unsigned long)(sim.programs - programs));
+    CHECK(((sim.programs - programs) * 3u) < single);
+    CHECK(removed == FILES);
+    CHECK(Entries("/b") == 0u);
+
+    /* Pinned file below an unnormalized tree root */
+    cp23lfs_pin_config(pinRam, sizeof(pinRam), &policy);
+    CHECK_OK(cp23lfs_mkdir("/d"));
+    Make("/d/p", 100u);
+    CHECK_OK(cp23lfs_pin("/d/p"));
+    CHECK(Exists("/d/p"));
+    CHECK_OK(cp23lfs_remove_recursive("d"));
+    CHECK(!Exists("/d/p"));
+
+    /* Time-sliced removal of a tree with sub-directories */
+    MakeDir("/t");
+    MakeDir("/t/s");
+    CHECK_OK(cp23lfs_mkdir("/t/s/e"));
+    Make("/t/z", 600u);
+    CHECK_OK(cp23lfs_remove_recursive_start(&ctx, "//t/"));
+    while ((!ctx.done) && (steps < 1000u))
+    {
+        CHECK_OK(cp23lfs_remove_recursive_step(&ctx, 5u));
+        steps++;
+    }
+    CHECK(ctx.removed == ((2u * FILES) + 4u));
+    CHECK(steps == ((ctx.removed + 4u) / 5u));
+    CHECK(Entries("/") == 0u);
+    CHECK_OK(cp23lfs_mkdir("/t"));                      /* Tree root removed too */
+
+    /* Consistent after a remount */
+    CHECK_OK(CP23Init());
+    CHECK(Entries("/") == 0u);
+    Make("/b/new", 600u);
+    CHECK(Exists("/b/new"));
+    CHECK(Entries("/") == 1u);
+    return CHECK_DONE();
+}
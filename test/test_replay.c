@@ -0,0 +1,146 @@
+/**
+  *******************************************************************************
+  * @file           : test_replay.c
+  * @brief          : Workload recorder and replayer (cp23lfs_rec_start, cp23lfs_replay)
+  *
+  *     Records a workload on a blank image, then replays it twice on the same blank image,
+  *     with the paths resolved from the names of the workload. Checks that both replays and
+  *     the original run give the same bus bytes, programs and erases, and the same memory
+  *     content; then that a replay with unresolved paths ("/rp<hash>") is repeatable too.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define RECORDS     512u
+
+static char const * const names[] = {"/log", "/log/a", "/log/b", "/log/c", "/log/old"};
+static cp23lfs_rec_t rec[RECORDS];
+static uint8_t data[300];
+static uint8_t image[SIM_SIZE];
+
+
+static bool Resolve(uint32_t hash, char *path)
+{
+    uint32_t n;
+
+    for (n = 0 ; n < (sizeof(names) / sizeof(names[0])) ; n++)
+    {
+        if (cp23lfs_rec_hash(names[n]) == hash)
+        {
+            strcpy(path, names[n]);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void Blank(void)
+{
+    IS25LP080D_energy_t energy;
+    uint32_t n;
+
+    sim_init();
+    for (n = 0 ; n < IS25LP080D_SECTOR_COUNT ; n++)
+    {
+        IS25LP080D_SetEraseCount(n, 0u);
+    }
+    CHECK_OK(CP23Init());
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+}
+
+
+static void Workload(void)
+{
+    cp23lfs_file_t a;
+    cp23lfs_file_t b;
+    uint32_t n;
+
+    CHECK_OK(cp23lfs_mkdir("/log"));
+    CHECK_OK(cp23lfs_file_opencfg(&a, "/log/a", LFS_O_RDWR | LFS_O_CREAT));
+    CHECK_OK(cp23lfs_file_opencfg(&b, "/log/b", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND));
+    for (n = 0 ; n < 40u ; n++)
+    {
+        CHECK(cp23lfs_file_write(a, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        CHECK(cp23lfs_file_write(b, data, 100u) == 100);
+        if ((n % 10u) == 9u)
+        {
+            CHECK_OK(cp23lfs_file_sync(b));
+        }
+    }
+    CHECK(cp23lfs_file_seek(a, 1000, LFS_SEEK_SET) == 1000);
+    CHECK(cp23lfs_file_read(a, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK_OK(cp23lfs_file_truncate(a, 5000u));
+    CHECK_OK(cp23lfs_file_close(a));
+    CHECK_OK(cp23lfs_file_close(b));
+    CHECK_OK(cp23lfs_file_opencfg(&a, "/log/c", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(a, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK_OK(cp23lfs_file_close(a));
+    CHECK_OK(cp23lfs_rename("/log/b", "/log/old"));
+    CHECK_OK(cp23lfs_remove("/log/c"));
+}
+
+
+/* Replays the records on the blank image, returns the counts */
+static IS25LP080D_energy_t Replay(uint32_t num, cp23lfs_replayPath_t resolve)
+{
+    IS25LP080D_energy_t energy;
+    uint32_t failed = 0u;
+
+    Blank();
+    CHECK_OK(cp23lfs_replay(rec, num, resolve, data, sizeof(data), &failed));
+    CHECK(failed == 0u);
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&energy, true);
+    return energy;
+}
+
+
+static bool Same(const IS25LP080D_energy_t *x, const IS25LP080D_energy_t *y)
+{
+    return ((x->busBytes == y->busBytes) && (x->programs == y->programs) && (x->erases[0] == y->erases[0]) &&
+            (x->erases[1] == y->erases[1]) && (x->erases[2] == y->erases[2]));
+}
+
+
+int main(void)
+{
+    IS25LP080D_energy_t original;
+    IS25LP080D_energy_t first;
+    IS25LP080D_energy_t second;
+    uint32_t lost = 0u;
+    uint32_t num;
+
+    memset(data, 'R', sizeof(data));
+    Blank();
+    cp23lfs_rec_start(rec, RECORDS, sim_clock_us);
+    Workload();
+    num = cp23lfs_rec_stop(&lost);
+    CHECK((num > 0u) && (lost == 0u));
+    CHECK(IS25LP080D_EraseFlush() == 0);
+    IS25LP080D_GetEnergy(&original, true);
+    memcpy(image, sim.mem, sizeof(image));
+
+    /* Resolved paths: same counts and content as the original run */
+    first = Replay(num, Resolve);
+    second = Replay(num, Resolve);
+    printf("%lu records: original %lu bus bytes, %lu programs, %lu erases; replays %lu/%lu, %lu/%lu, %lu/%lu\n",
+           (unsigned long)num, (unsigned long)original.busBytes, (unsigned long)original.programs,
+           (unsigned long)original.erases[0], (unsigned long)first.busBytes, (unsigned long)second.busBytes,
+           (unsigned long)first.programs, (unsigned long)second.programs, (unsigned long)first.erases[0],
+           (unsigned long)second.erases[0]);
+    CHECK(Same(&first, &second));
+    CHECK(Same(&first, &original));
+    CHECK(memcmp(image, sim.mem, sizeof(image)) == 0);
+
+    /* Unresolved paths: repeatable */
+    first = Replay(num, NULL);
+    second = Replay(num, NULL);
+    CHECK(Same(&first, &second));
+    return CHECK_DONE();
+}
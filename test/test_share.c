@@ -0,0 +1,106 @@
+/**
+  *******************************************************************************
+  * @file           : test_share.c
+  * @brief          : Shared read-only opens (cp23lfs_file_opencfg, cp23lfs_file_seek)
+  *
+  *     Opens the same file twice read-only: the second open shares the state of the first
+  *     one (no file cache) and each open reads and seeks at its own position. A writer then
+  *     commits a new content: the open readers keep reading the content they opened until
+  *     their close, the next read-only open reads the new content without sharing the old
+  *     opens, and the opens after it share the new one. A removed file is not opened through
+  *     a reader still open on it.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define FILE_SIZE   2000u                                       /* Over the inline size: stored in its own blocks */
+
+static uint8_t oldData[FILE_SIZE];
+static uint8_t newData[FILE_SIZE];
+
+
+static void Write(const char *path, const uint8_t *data)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC));
+    CHECK(cp23lfs_file_write(file, data, FILE_SIZE) == (lfs_ssize_t)FILE_SIZE);
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+/* Reads size bytes and checks them against the data at the offset */
+static void Read(cp23lfs_file_t file, const uint8_t *data, uint32_t off, uint32_t size)
+{
+    uint8_t buffer[64];
+
+    CHECK(cp23lfs_file_read(file, buffer, size) == (lfs_ssize_t)size);
+    CHECK(memcmp(buffer, &data[off], size) == 0);
+}
+
+
+int main(void)
+{
+    cp23lfs_file_t r1;
+    cp23lfs_file_t r2;
+    cp23lfs_file_t r3;
+    cp23lfs_file_t r4;
+    uint32_t n;
+
+    for (n = 0 ; n < FILE_SIZE ; n++)
+    {
+        oldData[n] = (uint8_t)n;
+        newData[n] = (uint8_t)(n * 3u + 1u);
+    }
+    sim_init();
+    CHECK_OK(CP23Init());
+    Write("/s", oldData);
+
+    /* Two opens of the same file: shared state, independent positions */
+    CHECK_OK(cp23lfs_file_opencfg(&r1, "/s", LFS_O_RDONLY));
+    CHECK_OK(cp23lfs_file_opencfg(&r2, "s", LFS_O_RDONLY));
+    CHECK((r2 != r1) && (r1->system.users == 1u) && (r2->system.buffer == NULL));
+    Read(r1, oldData, 0u, 10u);
+    Read(r2, oldData, 0u, 40u);
+    CHECK(cp23lfs_file_seek(r1, 600, LFS_SEEK_SET) == 600);
+    Read(r2, oldData, 40u, 8u);
+    Read(r1, oldData, 600u, 16u);
+    CHECK(cp23lfs_file_seek(r2, 1000, LFS_SEEK_CUR) == 1048);
+    CHECK(cp23lfs_file_seek(r1, -16, LFS_SEEK_CUR) == 600);
+    Read(r2, oldData, 1048u, 32u);
+    Read(r1, oldData, 600u, 4u);
+    CHECK(cp23lfs_file_seek(r2, -8, LFS_SEEK_END) == (lfs_soff_t)(FILE_SIZE - 8u));
+    Read(r2, oldData, FILE_SIZE - 8u, 8u);
+    Read(r1, oldData, 604u, 20u);
+
+    /* A writer commits: the readers keep their content, the next open does not share them */
+    Write("/s", newData);
+    Read(r1, oldData, 624u, 64u);
+    CHECK(cp23lfs_file_seek(r2, 100, LFS_SEEK_SET) == 100);
+    Read(r2, oldData, 100u, 16u);
+    CHECK_OK(cp23lfs_file_opencfg(&r3, "/s", LFS_O_RDONLY));
+    CHECK((r3->system.users == 0u) && (r1->system.users == 1u));
+    Read(r3, newData, 0u, 64u);
+    CHECK_OK(cp23lfs_file_opencfg(&r4, "/s", LFS_O_RDONLY));
+    CHECK((r3->system.users == 1u) && (r4->system.buffer == NULL));
+    Read(r4, newData, 0u, 16u);
+    Read(r1, oldData, 688u, 8u);
+    CHECK_OK(cp23lfs_file_close(r1));
+    Read(r2, oldData, 116u, 16u);
+    CHECK_OK(cp23lfs_file_close(r2));
+    Read(r3, newData, 64u, 16u);
+    Read(r4, newData, 16u, 16u);
+
+    /* A removed file: no open through the readers left on it */
+    CHECK_OK(cp23lfs_remove("/s"));
+    CHECK(cp23lfs_file_opencfg(&r1, "/s", LFS_O_RDONLY) == CP23LFS_ERRORCODE(LFS_ERR_NOENT));
+    Read(r3, newData, 80u, 16u);
+    CHECK_OK(cp23lfs_file_close(r4));
+    CHECK_OK(cp23lfs_file_close(r3));
+    printf("shared opens: independent positions, committed and removed files not shared\n");
+    return CHECK_DONE();
+}
@@ -0,0 +1,178 @@
+/**
+  *******************************************************************************
+  * @file           : test_stack.c
+  * @brief          : Stack measure of the cp23 calls (cp23lfs_stack_mark, cp23lfs_stack_check)
+  *
+  *     Checks the budget flagging on a function with a known stack use (under and over
+  *     CP23LFS_STACK_BUDGET), then drives the cp23 calls through their deep paths on a blank
+  *     flash model and reports the peak stack of each step: directory creation, metadata splits
+  *     (many files in a directory), file writes over several blocks, reads, seeks and truncation,
+  *     renames between directories, removals, recursive removal with orphans, static wear
+  *     leveling and reconciliation. The host build (64-bit, sanitizers) is not the target: the
+  *     peaks are reported, not checked against the budget. Metadata relocations (worn blocks)
+  *     cannot be forced through the calls.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define STEPS       10u
+#define DIR         "/stkprobe"
+#define FILES       64u                                         /* Files of a directory (metadata splits) */
+#define MOVES       4u                                          /* Wear level budget */
+#define BLOCK_SIZE  4096u                                       /* Block size (IS25LP080D sector) */
+
+
+/* Uses size bytes of stack */
+static uint32_t __attribute__((noinline)) Deep(uint32_t size)
+{
+    volatile uint8_t buffer[size];
+    uint32_t sum = 0u;
+    uint32_t cnt;
+
+    for (cnt = 0 ; cnt < size ; cnt++)
+    {
+        buffer[cnt] = (uint8_t)cnt;
+    }
+    for (cnt = 0 ; cnt < size ; cnt++)
+    {
+        sum += buffer[cnt];
+    }
+    return sum;
+}
+
+
+static cp23lfs_errorcode_t Step(uint32_t step)
+{
+    static char const hex[] = "0123456789abcdef";
+    uint8_t data[64];
+    char path[CP23LFS_PATH_MAX];
+    char newPath[CP23LFS_PATH_MAX];
+    uint32_t len = sizeof(DIR "/f") - 1u;
+    cp23lfs_errorcode_t retVal = CP23LFS_OK;
+    cp23lfs_file_t file;
+    uint32_t cnt;
+
+    memset(data, 0x5A, sizeof(data));
+    memcpy(path, DIR "/f", len);
+    path[len + 2u] = '\0';
+    switch (step)
+    {
+        case 0:
+            retVal = cp23lfs_mkdir(DIR);
+            if (retVal == CP23LFS_OK)
+            {
+                retVal = cp23lfs_mkdir(DIR "/sub");
+            }
+            break;
+        case 1:
+            for (cnt = 0 ; (cnt < FILES) && (retVal == CP23LFS_OK) ; cnt++)
+            {
+                path[len] = hex[cnt >> 4];
+                path[len + 1u] = hex[cnt & 0x0Fu];
+                retVal = cp23lfs_file_opencfg(&file, path, LFS_O_CREAT | LFS_O_WRONLY);
+                if (retVal == CP23LFS_OK)
+                {
+                    CHECK(cp23lfs_file_write(file, data, 16u) == 16);
+                    retVal = cp23lfs_file_close(file);
+                }
+            }
+            break;
+        case 2:
+            /* File over several blocks (CTZ skip-list) */
+            retVal = cp23lfs_file_opencfg(&file, DIR "/big", LFS_O_CREAT | LFS_O_WRONLY);
+            if (retVal == CP23LFS_OK)
+            {
+                for (cnt = 0 ; cnt < ((3u * BLOCK_SIZE) / sizeof(data)) ; cnt++)
+                {
+                    CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+                }
+                retVal = cp23lfs_file_close(file);
+            }
+            break;
+        case 3:
+            retVal = cp23lfs_file_opencfg(&file, DIR "/big", LFS_O_RDONLY);
+            if (retVal == CP23LFS_OK)
+            {
+                while (cp23lfs_file_read(file, data, sizeof(data)) > 0)
+                {
+                }
+                retVal = cp23lfs_file_close(file);
+            }
+            break;
+        case 4:
+            retVal = cp23lfs_file_opencfg(&file, DIR "/big", LFS_O_RDWR);
+            if (retVal == CP23LFS_OK)
+            {
+                CHECK(cp23lfs_file_seek(file, (lfs_soff_t)(BLOCK_SIZE + 100u), LFS_SEEK_SET) >= 0);
+                CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+                CHECK_OK(cp23lfs_file_truncate(file, 100u));
+                retVal = cp23lfs_file_close(file);
+            }
+            break;
+        case 5:
+            /* Moves between directories */
+            memcpy(newPath, DIR "/sub/f", len + 4u);
+            newPath[len + 6u] = '\0';
+            for (cnt = 0 ; (cnt < (FILES / 4u)) && (retVal == CP23LFS_OK) ; cnt++)
+            {
+                path[len] = newPath[len + 4u] = hex[cnt >> 4];
+                path[len + 1u] = newPath[len + 5u] = hex[cnt & 0x0Fu];
+                retVal = cp23lfs_rename(path, newPath);
+            }
+            break;
+        case 6:
+            for (cnt = (FILES / 4u) ; (cnt < FILES) && (retVal == CP23LFS_OK) ; cnt++)
+            {
+                path[len] = hex[cnt >> 4];
+                path[len + 1u] = hex[cnt & 0x0Fu];
+                retVal = cp23lfs_remove(path);
+            }
+            break;
+        case 7:
+            /* Directories dropped with their files (orphans) */
+            retVal = cp23lfs_remove_recursive(DIR);
+            break;
+        case 8:
+            retVal = cp23lfs_wear_level(MOVES, &cnt);
+            break;
+        default:
+            retVal = cp23lfs_fs_reconcile();
+            break;
+    }
+    return retVal;
+}
+
+
+int main(void)
+{
+    static char const * const name[STEPS] = {"mkdir", "create", "write", "read", "truncate",
+                                             "rename", "remove", "rmtree", "wear level", "reconcile"};
+    cp23lfs_stack_t measure;
+    uint32_t step;
+
+    /* Budget flagging */
+    cp23lfs_stack_mark();
+    (void)Deep(CP23LFS_STACK_BUDGET / 4u);
+    CHECK(!cp23lfs_stack_check(&measure, "under"));
+    CHECK((measure.peak >= (CP23LFS_STACK_BUDGET / 4u)) && (!measure.over) && (strcmp(measure.name, "under") == 0));
+    cp23lfs_stack_mark();
+    (void)Deep(CP23LFS_STACK_BUDGET + 256u);
+    CHECK(cp23lfs_stack_check(&measure, "over"));
+    CHECK((measure.peak >= (CP23LFS_STACK_BUDGET + 256u)) && (measure.over));
+
+    /* Deep paths, on a blank model */
+    sim_init();
+    CHECK_OK(CP23Init());
+    for (step = 0 ; step < STEPS ; step++)
+    {
+        cp23lfs_stack_mark();
+        CHECK_OK(Step(step));
+        (void)cp23lfs_stack_check(&measure, name[step]);
+        printf("%s: %lu bytes%s\n", measure.name, (unsigned long)measure.peak, (measure.over) ? " (over the budget)" : "");
+    }
+    return CHECK_DONE();
+}
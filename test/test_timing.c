@@ -0,0 +1,117 @@
+/**
+  *******************************************************************************
+  * @file           : test_timing.c
+  * @brief          : Program/erase timing statistics (IS25LP080D_GetTiming, IS25LP080D_IsSlowSector)
+  *
+  *     Runs sector erases and page programs at the datasheet typical times, then injects slow
+  *     sectors in the flash model: one erasing four times slower than the others (under the
+  *     datasheet maximum, flagged by its average), one erasing over the datasheet maximum and one
+  *     programming over it (flagged by the single operation). Checks the sector and memory
+  *     averages and maximums (status polls) and that only the slow sectors are flagged.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define SECTORS     16u                                         /* Sectors used */
+#define ERASE_POLLS ((70000u + SIM_POLL_US - 1u) / SIM_POLL_US) /* Sector erase at the typical time */
+#define TREND       5u                                          /* Slow by trend: 4 times slower */
+#define ERASE_SLOW  9u                                          /* Slow erase: over the datasheet maximum */
+#define PROG_SLOW   12u                                         /* Slow program: over the datasheet maximum */
+
+static uint8_t page[256];
+
+
+/* Erases a sector, and programs its first page */
+static void Cycle(uint32_t sector, bool program)
+{
+    CHECK(IS25LP080D_Erase(NULL, sector * IS25LP080D_SECTOR_SIZE, IS25LP080D_SECTOR_SIZE) == 0);
+    if (program)
+    {
+        CHECK(IS25LP080D_Program(NULL, sector * IS25LP080D_SECTOR_SIZE, page, sizeof(page)) == 0);
+    }
+}
+
+
+/* Polls near the expected ones (the polling loop itself takes some time) */
+static bool Near(uint32_t polls, uint32_t expect)
+{
+    return ((polls * 100u) >= (expect * 99u)) && (polls <= (expect + 1u));
+}
+
+
+int main(void)
+{
+    IS25LP080D_timing_t timing;
+    IS25LP080D_timing_t all;
+    uint32_t slow;
+    uint32_t sector;
+    uint32_t n;
+
+    memset(page, 0x5A, sizeof(page));
+    sim_init();
+    IS25LP080D_Init();
+    IS25LP080D_SetEraseDeferral(false);
+
+    /* Typical times: averages equal to the maximums, no slow sector */
+    for (sector = 0 ; sector < SECTORS ; sector++)
+    {
+        Cycle(sector, true);
+    }
+    IS25LP080D_GetTiming(0u, &timing);
+    CHECK(Near(timing.eraseAvg, ERASE_POLLS) && (timing.eraseMax == timing.eraseAvg));
+    CHECK((timing.progAvg == 1u) && (timing.progMax == 1u));
+    for (sector = 0, slow = 0u ; sector < SECTORS ; sector++)
+    {
+        slow += (IS25LP080D_IsSlowSector(sector)) ? 1u : 0u;
+    }
+    CHECK(slow == 0u);
+
+    /* Slow by trend: the sector average climbs over twice the memory one */
+    sim.slowSector = TREND;
+    sim.slowFactor = 4u;
+    Cycle(TREND, false);
+    IS25LP080D_GetTiming(TREND, &timing);
+    CHECK(Near(timing.eraseMax, 4u * ERASE_POLLS) && (timing.eraseAvg < (2u * ERASE_POLLS)));
+    CHECK(!IS25LP080D_IsSlowSector(TREND));                     /* One slow sample: not yet */
+    for (n = 1u ; n < 10u ; n++)
+    {
+        Cycle(TREND, false);
+    }
+    IS25LP080D_GetTiming(TREND, &timing);
+    IS25LP080D_GetTiming(IS25LP080D_SECTOR_ALL, &all);
+    printf("trend sector: erase avg %lu max %lu polls, memory avg %lu max %lu\n", (unsigned long)timing.eraseAvg,
+           (unsigned long)timing.eraseMax, (unsigned long)all.eraseAvg, (unsigned long)all.eraseMax);
+    CHECK((timing.eraseAvg > (2u * all.eraseAvg)) && (timing.eraseAvg < timing.eraseMax));
+    CHECK((all.eraseMax == timing.eraseMax) && (all.eraseAvg < (2u * ERASE_POLLS)));
+    CHECK(IS25LP080D_IsSlowSector(TREND));
+
+    /* Erase over the datasheet maximum: flagged at once */
+    sim.slowSector = ERASE_SLOW;
+    sim.slowFactor = 5u;
+    Cycle(ERASE_SLOW, false);
+    IS25LP080D_GetTiming(ERASE_SLOW, &timing);
+    CHECK(Near(timing.eraseMax, 5u * ERASE_POLLS));
+    CHECK(IS25LP080D_IsSlowSector(ERASE_SLOW));
+
+    /* Program over the datasheet maximum (0.8 mSec, flagged over 2 mSec): flagged at once */
+    sim.slowSector = PROG_SLOW;
+    sim.slowFactor = 12u;
+    CHECK(IS25LP080D_Program(NULL, (PROG_SLOW * IS25LP080D_SECTOR_SIZE) + sizeof(page), page, sizeof(page)) == 0);
+    IS25LP080D_GetTiming(PROG_SLOW, &timing);
+    IS25LP080D_GetTiming(IS25LP080D_SECTOR_ALL, &all);
+    printf("slow program: %lu polls, memory program avg %lu max %lu\n", (unsigned long)timing.progMax,
+           (unsigned long)all.progAvg, (unsigned long)all.progMax);
+    CHECK(Near(timing.progMax, (12u * 200u) / SIM_POLL_US) && (all.progMax == timing.progMax));
+    CHECK(IS25LP080D_IsSlowSector(PROG_SLOW));
+    sim.slowFactor = 0u;
+
+    for (sector = 0, slow = 0u ; sector < SECTORS ; sector++)
+    {
+        slow += (IS25LP080D_IsSlowSector(sector)) ? 1u : 0u;
+    }
+    CHECK(slow == 3u);
+    return CHECK_DONE();
+}
@@ -0,0 +1,109 @@
+/**
+  *******************************************************************************
+  * @file           : test_trace.c
+  * @brief          : Operation spans of the file system calls (IS25LP080D_TraceBegin, IS25LP080D_TraceEnd)
+  *
+  *     Runs the file and directory calls with the trace enabled and checks that each one ends
+  *     with its span record, and that the memory transactions recorded since the previous call
+  *     lie within it (the trace viewer nests them under the call).
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define TRACE_NUM   8192u
+
+static IS25LP080D_trace_t trace[TRACE_NUM];
+static uint32_t traceFirst = 0u;
+static uint8_t data[3000];
+
+
+/* Records of the last call (ring not wrapped: unused records have no name): its span is the last
+   record and holds the transactions before it */
+static void Span(const char *name, bool memory)
+{
+    uint32_t count;
+    uint32_t last;
+    uint32_t cnt;
+
+    for (count = traceFirst ; (count < TRACE_NUM) && (trace[count].name != NULL) ; count++)
+    {
+    }
+    CHECK((count > traceFirst) && (count < TRACE_NUM));
+    if ((count <= traceFirst) || (count >= TRACE_NUM))
+    {
+        return;
+    }
+    last = count - 1u;
+    if ((trace[last].addr != IS25LP080D_SPAN_ADDR) || (strcmp(trace[last].name, name) != 0))
+    {
+        printf("%s: last record %s\n", name, trace[last].name);
+    }
+    CHECK((trace[last].addr == IS25LP080D_SPAN_ADDR) && (strcmp(trace[last].name, name) == 0));
+    if ((memory) && (last == traceFirst))
+    {
+        printf("%s: no transaction\n", name);
+    }
+    CHECK((!memory) || (last > traceFirst));
+    for (cnt = traceFirst ; cnt < last ; cnt++)
+    {
+        CHECK((trace[cnt].start >= trace[last].start) && (trace[cnt].end <= trace[last].end));
+    }
+    traceFirst = count;
+}
+
+
+int main(void)
+{
+    static const char * const names[] = {"m1", "m2"};
+    cp23lfs_file_t file;
+    uint32_t generation;
+    uint8_t group = 2u;
+
+    memset(data, 'T', sizeof(data));
+    sim_init();
+    CHECK_OK(CP23Init());
+    IS25LP080D_SetTrace(trace, TRACE_NUM, sim_clock_us);
+
+    CHECK_OK(cp23lfs_mkdir("/d"));
+    Span("mkdir", true);
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/d/f", LFS_O_WRONLY | LFS_O_CREAT));
+    Span("open", true);
+    CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    Span("write", true);
+    CHECK_OK(cp23lfs_file_truncate(file, 2000u));
+    Span("truncate", false);
+    CHECK_OK(cp23lfs_file_sync(file));
+    Span("sync", true);
+    CHECK(cp23lfs_file_write(file, data, 10u) == 10);
+    Span("write", false);
+    CHECK_OK(cp23lfs_file_close(file));
+    Span("close", true);
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/d/f", LFS_O_RDONLY));
+    Span("open", true);
+    CHECK(cp23lfs_file_seek(file, 1000, LFS_SEEK_SET) == 1000);
+    Span("seek", false);
+    CHECK(cp23lfs_file_read(file, data, sizeof(data)) > 0);
+    Span("read", true);
+    CHECK_OK(cp23lfs_file_close(file));
+    Span("close", false);
+    CHECK_OK(cp23lfs_rename("/d/f", "/d/g"));
+    Span("rename", true);
+    CHECK_OK(cp23lfs_setattr("/d/g", CP23LFS_ATTR_GROUP, &group, sizeof(group)));
+    Span("setattr", true);
+    CHECK_OK(cp23lfs_generation("/d/g", &generation));
+    Span("generation", true);
+    CHECK_OK(cp23lfs_remove("/d/g"));
+    Span("remove", true);
+    CHECK_OK(cp23lfs_remove_multi("/d", names, 2u, NULL));
+    Span("remove multi", false);
+    CHECK_OK(cp23lfs_remove_recursive("/d"));
+    Span("rmtree", true);
+    CHECK_OK(cp23lfs_fs_reconcile());
+    Span("reconcile", true);
+    IS25LP080D_SetTrace(NULL, 0u, NULL);
+    return CHECK_DONE();
+}
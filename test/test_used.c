@@ -0,0 +1,153 @@
+/**
+  *******************************************************************************
+  * @file           : test_used.c
+  * @brief          : Blocks in use (cp23lfs_fs_size) against the file system traversal
+  *
+  *     Runs a workload of file creations, appends, inline files, renames, attributes,
+  *     directories, rewrites going around the memory (LFS window rescans) and removes (metadata
+  *     pairs dropped from a split directory), and checks after each step that the count returned
+  *     by cp23lfs_fs_size is the one recounted by cp23lfs_fs_reconcile (no drift).
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define FILES       120u
+#define FILL        150u
+
+static uint8_t data[3000];
+static uint32_t checks = 0u;
+
+
+static void Drift(const char *step)
+{
+    lfs_ssize_t used = cp23lfs_fs_size();
+
+    CHECK_OK(cp23lfs_fs_reconcile());
+    if (cp23lfs_fs_size() != used)
+    {
+        printf("%s: %ld blocks counted, %ld in use\n", step, (long)used, (long)cp23lfs_fs_size());
+    }
+    CHECK(cp23lfs_fs_size() == used);
+    checks++;
+}
+
+
+static void Write(const char *path, int flags, uint32_t size)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | flags));
+    CHECK(cp23lfs_file_write(file, data, size) == (lfs_ssize_t)size);
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+int main(void)
+{
+    cp23lfs_file_t file;
+    uint8_t group = 2u;
+    uint32_t n;
+    uint32_t k;
+    char path[32];
+    char newPath[32];
+
+    memset(data, 'B', sizeof(data));
+    sim_init();
+    CHECK_OK(CP23Init());
+    Drift("mount");
+
+    /* Directory of small and large files (metadata splits) */
+    CHECK_OK(cp23lfs_mkdir("/log"));
+    Drift("mkdir");
+    for (n = 0 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/log/file%03lu", (unsigned long)n);
+        Write(path, LFS_O_CREAT, (n % 3u) ? 40u : 3000u);
+        Drift(path);
+    }
+
+    /* Appends to a large file, growth of an inline file */
+    for (n = 0 ; n < 20u ; n++)
+    {
+        Write("/log/file000", LFS_O_APPEND, 1000u);
+        Drift("append");
+        Write("/log/file001", LFS_O_APPEND, 60u);
+        Drift("inline append");
+    }
+
+    /* Truncate, rename, attribute */
+    Write("/log/file003", LFS_O_TRUNC, 10u);
+    Drift("truncate");
+    for (n = 0 ; n < 10u ; n++)
+    {
+        snprintf(path, sizeof(path), "/log/file%03lu", (unsigned long)n);
+        snprintf(newPath, sizeof(newPath), "/ren%03lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_rename(path, newPath));
+        Drift("rename");
+    }
+    CHECK_OK(cp23lfs_setattr("/ren002", CP23LFS_ATTR_GROUP, &group, sizeof(group)));
+    Drift("setattr");
+
+    /* Directory created while another file has uncommitted data */
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/open", LFS_O_WRONLY | LFS_O_CREAT));
+    CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    CHECK_OK(cp23lfs_mkdir("/dir"));
+    CHECK_OK(cp23lfs_file_close(file));
+    Drift("mkdir with an open file");
+
+    /* Rewrites of a 24K file with the memory almost full: the allocations go around the free
+       blocks several times between two wear table saves (LFS rescans its window) */
+    CHECK_OK(cp23lfs_file_opencfg(&file, "/fill", LFS_O_WRONLY | LFS_O_CREAT));
+    for (n = 0 ; n < FILL ; n++)
+    {
+        CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+    Drift("fill");
+    for (n = 0 ; n < 100u ; n++)
+    {
+        CHECK_OK(cp23lfs_file_opencfg(&file, "/churn", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+        for (k = 0 ; k < 8u ; k++)
+        {
+            CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        }
+        CHECK_OK(cp23lfs_file_close(file));
+        Drift("rewrite");
+    }
+
+    /* Single removes from the split directory (emptied metadata pairs dropped) */
+    for (n = 10 ; n < FILES ; n++)
+    {
+        snprintf(path, sizeof(path), "/log/file%03lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_remove(path));
+        Drift("remove from the directory");
+    }
+
+    /* Removes */
+    CHECK_OK(cp23lfs_remove("/churn"));
+    CHECK_OK(cp23lfs_remove("/fill"));
+    Drift("remove large");
+    CHECK_OK(cp23lfs_remove("/ren000"));
+    Drift("remove");
+    CHECK_OK(cp23lfs_remove("/dir"));
+    Drift("remove dir");
+    CHECK_OK(cp23lfs_remove_recursive("/log"));
+    Drift("rmtree");
+    for (n = 1 ; n < 10u ; n++)
+    {
+        snprintf(path, sizeof(path), "/ren%03lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_remove(path));
+    }
+    CHECK_OK(cp23lfs_remove("/open"));
+    Drift("empty");
+
+    /* Exact after a remount */
+    CHECK_OK(CP23Init());
+    Drift("remount");
+    printf("%lu drift checks, %ld blocks in use at the end\n", (unsigned long)checks, (long)cp23lfs_fs_size());
+    return CHECK_DONE();
+}
@@ -0,0 +1,170 @@
+/**
+  *******************************************************************************
+  * @file           : test_wear.c
+  * @brief          : Allocation steered by the wear table (cp23lfs_wear_sync)
+  *
+  *     Half of the blocks are given a large erase count, as after years of use, which a remount
+  *     must keep unchanged, then a hot workload rewrites a few files. Checks that the allocation
+  *     window keeps the new erases out of the worn half, and that they are spread over all the
+  *     blocks of the other half.
+  *     Then gives the blocks an even wear gradient, so that a single free block is within
+  *     CP23LFS_WEAR_DELTA erases of the least worn one: the allocation must still favour the
+  *     least worn quarter.
+  *     Last, the free blocks are given three wear levels so that exactly two CP23LFS_WEAR_DELTA
+  *     steps leave CP23LFS_WEAR_KEEP blocks: the third level must still be skipped.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define BLOCKS      256u
+#define WORN        1000u
+#define ROUNDS      1500u
+#define GRADIENT    20u
+#define LEVEL       100u                                        /* First block of the three wear levels, 8 blocks each */
+#define LEVEL_MID   20u                                         /* Within two CP23LFS_WEAR_DELTA steps */
+#define LEVEL_HIGH  40u                                         /* Within three steps only */
+
+static uint8_t data[6000];
+static uint32_t before[BLOCKS];
+static uint8_t image[SIM_SIZE];
+
+
+static void Hot(uint32_t rounds)
+{
+    cp23lfs_file_t file;
+    char path[16];
+    uint32_t n;
+
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        before[n] = IS25LP080D_GetEraseCount(n);
+    }
+    for (n = 0 ; n < rounds ; n++)
+    {
+        snprintf(path, sizeof(path), "/hot%lu", (unsigned long)(n % 3u));
+        CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+        CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+        CHECK_OK(cp23lfs_file_close(file));
+    }
+}
+
+
+static void Write(const char *path, uint32_t blocks)
+{
+    cp23lfs_file_t file;
+    uint32_t n;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    for (n = 0 ; n < blocks ; n++)
+    {
+        CHECK(cp23lfs_file_write(file, data, 4096u) == 4096);
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+int main(void)
+{
+    uint32_t fresh = 0u;
+    uint32_t worn = 0u;
+    uint32_t unused = 0u;
+    uint32_t changed = 0u;
+    uint32_t erases;
+    uint32_t n;
+    char path[16];
+
+    memset(data, 'W', sizeof(data));
+    sim_init();
+    CHECK_OK(CP23Init());
+    for (n = BLOCKS / 2u ; n < BLOCKS ; n++)
+    {
+        IS25LP080D_SetEraseCount(n, IS25LP080D_GetEraseCount(n) + WORN);
+    }
+    CHECK_OK(cp23lfs_wear_sync());
+
+    /* Remount without reset: the stored table is already in the driver counts */
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        before[n] = IS25LP080D_GetEraseCount(n);
+    }
+    CHECK_OK(CP23Init());
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        changed += (IS25LP080D_GetEraseCount(n) != before[n]) ? 1u : 0u;
+    }
+    CHECK(changed == 0u);
+    Hot(ROUNDS);
+
+    /* New erases by half */
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        erases = IS25LP080D_GetEraseCount(n) - before[n];
+        if (n < (BLOCKS / 2u))
+        {
+            fresh += erases;
+            unused += (erases == 0u);
+        }
+        else
+        {
+            worn += erases;
+        }
+    }
+    printf("%lu erases on the fresh half (%lu blocks not erased), %lu on the worn half\n",
+           (unsigned long)fresh, (unsigned long)unused, (unsigned long)worn);
+    CHECK(worn <= ((fresh + worn) / 20u));
+    CHECK(unused <= 4u);                                        /* Metadata pairs not compacted */
+
+    /* Wear gradient: the least worn blocks are the last ones, GRADIENT erases apart */
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        IS25LP080D_SetEraseCount(n, (2u * WORN) + (GRADIENT * (BLOCKS - 1u - n)));
+    }
+    CHECK_OK(cp23lfs_wear_sync());
+    Hot(20u);
+    fresh = 0u;
+    worn = 0u;
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        erases = IS25LP080D_GetEraseCount(n) - before[n];
+        fresh += (n >= ((3u * BLOCKS) / 4u)) ? erases : 0u;
+        worn += (n < ((3u * BLOCKS) / 4u)) ? erases : 0u;
+    }
+    printf("wear gradient: %lu erases on the least worn quarter, %lu on the others\n", (unsigned long)fresh, (unsigned long)worn);
+    CHECK(worn < fresh);
+
+    /* Three wear levels: least worn, high and mid blocks in the allocation order */
+    for (n = 0 ; n < 3u ; n++)
+    {
+        snprintf(path, sizeof(path), "/hot%lu", (unsigned long)n);
+        CHECK_OK(cp23lfs_remove(path));
+    }
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        erases = 5u * WORN;
+        if ((n >= LEVEL) && (n < (LEVEL + 24u)))
+        {
+            erases = (4u * WORN) + ((n < (LEVEL + 8u)) ? 0u : ((n < (LEVEL + 16u)) ? LEVEL_HIGH : LEVEL_MID));
+        }
+        IS25LP080D_SetEraseCount(n, erases);
+        before[n] = erases;
+    }
+    CHECK_OK(cp23lfs_wear_sync());
+    memcpy(image, sim.mem, SIM_SIZE);
+    Write("/level", 10u);
+    fresh = 0u;
+    worn = 0u;
+    for (n = LEVEL ; n < (LEVEL + 24u) ; n++)
+    {
+        erases = (memcmp(&(image[n * 4096u]), &(sim.mem[n * 4096u]), 4096u) != 0) ? 1u : 0u;
+        fresh += (n >= (LEVEL + 16u)) ? erases : 0u;
+        worn += ((n >= (LEVEL + 8u)) && (n < (LEVEL + 16u))) ? erases : 0u;
+    }
+    printf("wear levels: %lu mid blocks written, %lu high ones\n", (unsigned long)fresh, (unsigned long)worn);
+    CHECK(fresh > 0u);
+    CHECK(worn == 0u);
+    return CHECK_DONE();
+}
@@ -0,0 +1,123 @@
+/**
+  *******************************************************************************
+  * @file           : test_wearlevel.c
+  * @brief          : Static wear leveling (cp23lfs_wear_level) against no leveling
+  *
+  *     Writes cold files never rewritten (calibration data), then a hot log rewriting a few
+  *     files, once without and once with the wear leveling service called every few commits.
+  *     Compares the wear of the most worn data block (the LFS metadata pairs, relocated by LFS
+  *     every block_cycles erases, are left out) and the lifetime projected from it: the leveled
+  *     run must spread the log erases over the cold blocks and wear the data blocks less.
+  *     The cold files carry an application attribute, which the relocations must keep.
+  ********************************************************************************
+*/
+#include <string.h>
+#include "littlefs.h"
+#include "IS25LP080D_driver.h"
+#include "flash_sim.h"
+#include "check.h"
+
+#define BLOCKS      256u
+#define COLD        40u
+#define ROUNDS      1500u
+#define PERIOD      10u                                         /* Commits between two wear leveling calls */
+#define BUDGET      16u
+#define METADATA    16u                                         /* Most worn blocks left out (metadata pairs) */
+#define ENDURANCE   100000u                                     /* Erase cycles of a memory sector (datasheet) */
+#define ATTR_CAL    0x40u                                       /* Application attribute of the cold files */
+
+static const char calTag[] = "calibration";
+
+static uint8_t data[6000];
+
+
+static void Write(const char *path, uint32_t chunks)
+{
+    cp23lfs_file_t file;
+
+    CHECK_OK(cp23lfs_file_opencfg(&file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC));
+    while (chunks--)
+    {
+        CHECK(cp23lfs_file_write(file, data, sizeof(data)) == (lfs_ssize_t)sizeof(data));
+    }
+    CHECK_OK(cp23lfs_file_close(file));
+}
+
+
+static bool Count(void *data, const char *path, const struct lfs_info *info)
+{
+    (*(uint32_t *)data)++;
+    return true;
+}
+
+
+/* Returns the erases of the most worn data block */
+static uint32_t Run(bool level)
+{
+    uint32_t counts[BLOCKS];
+    cp23lfs_qcond_t cond = {ATTR_CAL, CP23LFS_QOP_EQ, sizeof(calTag), calTag};
+    uint32_t moved;
+    uint32_t total = 0u;
+    uint32_t tagged = 0u;
+    uint32_t count;
+    uint32_t n;
+    uint32_t i;
+    char path[16];
+
+    sim_init();
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        IS25LP080D_SetEraseCount(n, 0u);
+    }
+    CHECK_OK(CP23Init());
+    for (n = 0 ; n < COLD ; n++)
+    {
+        snprintf(path, sizeof(path), "/cal%lu", (unsigned long)n);
+        Write(path, 3u);
+        CHECK_OK(cp23lfs_setattr(path, ATTR_CAL, calTag, sizeof(calTag)));
+    }
+    for (n = 0 ; n < ROUNDS ; n++)
+    {
+        snprintf(path, sizeof(path), "/hot%lu", (unsigned long)(n % 3u));
+        Write(path, 3u);
+        if ((level) && ((n % PERIOD) == 0u))
+        {
+            CHECK_OK(cp23lfs_wear_level(BUDGET, &moved));
+            total += moved;
+        }
+    }
+
+    /* Sort the counts down, skip the metadata pairs */
+    for (n = 0 ; n < BLOCKS ; n++)
+    {
+        counts[n] = IS25LP080D_GetEraseCount(n);
+        for (i = n ; (i > 0u) && (counts[i - 1u] < counts[i]) ; i--)
+        {
+            count = counts[i];
+            counts[i] = counts[i - 1u];
+            counts[i - 1u] = count;
+        }
+    }
+    printf("%s: most worn data block %lu erases (%lu blocks relocated), projected lifetime %lu commits\n",
+           (level) ? "leveled" : "not leveled", (unsigned long)counts[METADATA], (unsigned long)total,
+           (unsigned long)(((uint64_t)ENDURANCE * ROUNDS) / counts[METADATA]));
+    CHECK((level) || (total == 0u));
+    CHECK_OK(cp23lfs_query("/", &cond, 1u, Count, &tagged));
+    CHECK(tagged == COLD);
+    return counts[METADATA];
+}
+
+
+int main(void)
+{
+    uint32_t plain;
+    uint32_t leveled;
+
+    memset(data, 'L', sizeof(data));
+    plain = Run(false);
+    leveled = Run(true);
+    CHECK((leveled * 4u) <= (plain * 3u));
+    /* Application attributes are limited to what a relocation can copy */
+    CHECK(cp23lfs_setattr("/cal0", ATTR_CAL, data, CP23LFS_CACHE_SIZE + 1u) == CP23LFS_ERRORCODE(LFS_ERR_NOSPC));
+    return CHECK_DONE();
+}